@@ -0,0 +1,425 @@
+/**
+ * @file fresnel_bench.cc
+ * @brief Throughput and equivalence benchmark of the Fresnel kernels in OMSimFresnelKernels.hh.
+ *
+ * Evaluates the thin layer (photocathode) reflection/transmission probabilities for a sample of random but
+ * physical configurations with
+ * - the reference implementation (copy of the G4OpBoundaryProcess member functions before the kernels were extracted),
+ * - the scalar kernels,
+ * - the batch kernels,
+ * and prints evaluations per second. It also compares the cost per dielectric boundary interaction with full
+ * polarisation bookkeeping against the polarisation averaged mode (--unpolarized_boundary), and checks that the
+ * averaged transmission equals the mean over orthogonal polarisations. The mean transmissions for pure TE and TM
+ * polarisation show the error of the averaged mode for a polarised source. The transmission through a planar layer stack
+ * like the optical path into a module (water, pressure vessel glass, gel, PMT glass) is computed per angle of incidence
+ * with both modes, as light that has crossed the first interface is partially polarised. The scalar kernels must reproduce the
+ * reference bit by bit, the batch kernels within a small tolerance. The return code is non-zero if any check fails.
+ *
+ * Usage: fresnel_bench [number of samples] [repetitions]
+ * @ingroup common
+ */
+
+#include "OMSimFresnelKernels.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using Complex = std::complex<double>;
+
+namespace
+{
+  /**
+   * @brief Reference implementation, identical to the original G4OpBoundaryProcess member functions.
+   */
+  namespace Reference
+  {
+    FresnelCoefficients calculateFresnelCoefficientsComplex(Complex pComplexRindex1, Complex pComplexRindex2, Complex pCost1, Complex pCost2)
+    {
+      FresnelCoefficients lResult;
+      Complex n1Cost1 = pComplexRindex1 * pCost1;
+      Complex n2Cost2 = pComplexRindex2 * pCost2;
+      Complex n1Cost2 = pComplexRindex1 * pCost2;
+      Complex n2Cost1 = pComplexRindex2 * pCost1;
+
+      Complex denomTE = n1Cost1 + n2Cost2;
+      Complex denomTM = n1Cost2 + n2Cost1;
+
+      lResult.rTE = (n1Cost1 - n2Cost2) / denomTE;
+      lResult.tTE = 2.0 * n1Cost1 / denomTE;
+      lResult.rTM = (n2Cost1 - n1Cost2) / denomTM;
+      lResult.tTM = 2.0 * n1Cost1 / denomTM;
+      return lResult;
+    }
+
+    FresnelCoefficients threeLayerSystem(FresnelCoefficients pCoefficientsL1, FresnelCoefficients pCoefficientsL2, Complex pFactor)
+    {
+      static const Complex i(0, 1);
+      const Complex lExp2 = std::exp(2.0 * i * pFactor);
+      const Complex lExp = std::sqrt(lExp2);
+
+      FresnelCoefficients lResult;
+      lResult.rTE = (pCoefficientsL1.rTE + pCoefficientsL2.rTE * lExp2) / (1.0 + pCoefficientsL1.rTE * pCoefficientsL2.rTE * lExp2);
+      lResult.rTM = (pCoefficientsL1.rTM + pCoefficientsL2.rTM * lExp2) / (1.0 + pCoefficientsL1.rTM * pCoefficientsL2.rTM * lExp2);
+      lResult.tTE = (pCoefficientsL1.tTE * pCoefficientsL2.tTE * lExp) / (1.0 + pCoefficientsL1.rTE * pCoefficientsL2.rTE * lExp2);
+      lResult.tTM = (pCoefficientsL1.tTM * pCoefficientsL2.tTM * lExp) / (1.0 + pCoefficientsL1.rTM * pCoefficientsL2.rTM * lExp2);
+      return lResult;
+    }
+
+    OpticalLayerResult fresnel2ProbabilityComplex(FresnelCoefficients pCoefficients, double pRindex1, double pRindex2, double pImagRIndex1,
+                                                  double pImagRIndex2, Complex pCost1, Complex pCost2)
+    {
+      OpticalLayerResult lResult;
+      Complex lComplexRindex1(pRindex1, pImagRIndex1);
+      Complex lComplexRindex2(pRindex2, pImagRIndex2);
+
+      double lReflTE = std::norm(pCoefficients.rTE);
+      double lReflTM = std::norm(pCoefficients.rTM);
+
+      double prefactor = std::real((lComplexRindex2 * pCost2) / (lComplexRindex1 * pCost1));
+      double lTransTE = prefactor * std::norm(pCoefficients.tTE);
+      double lTransTM = prefactor * std::norm(pCoefficients.tTM);
+
+      lResult.Reflectivity = (lReflTE + lReflTM) * 0.5;
+      lResult.Transmittance = (lTransTE + lTransTM) * 0.5;
+      lResult.Absorption = 1.0 - lResult.Reflectivity - lResult.Transmittance;
+      return lResult;
+    }
+  }
+
+  /**
+   * @brief Inputs of a three layer system (medium 1 | thin absorbing layer | medium 2), stored as SoA.
+   */
+  struct Sample
+  {
+    FresnelKernels::ComplexSoA n1, nLayer, n2, cost1, costLayer, cost2, beta;
+
+    explicit Sample(std::size_t p_size)
+        : n1(p_size), nLayer(p_size), n2(p_size), cost1(p_size), costLayer(p_size), cost2(p_size), beta(p_size) {}
+    std::size_t size() const { return n1.size(); }
+  };
+
+  /**
+   * @brief Generates photocathode-like configurations: glass -> bialkali layer (15-30 nm) -> vacuum/glass.
+   */
+  Sample generateSample(std::size_t p_size, unsigned p_seed)
+  {
+    std::mt19937_64 engine(p_seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    auto in = [&](double p_min, double p_max)
+    { return p_min + (p_max - p_min) * uniform(engine); };
+
+    Sample sample(p_size);
+    const Complex one(1.0, 0.0);
+    for (std::size_t k = 0; k < p_size; ++k)
+    {
+      const Complex n1(in(1.45, 1.55), in(0., 1e-6));
+      const Complex nLayer(in(2.0, 3.0), in(0.5, 1.8));
+      const Complex n2(in(1.0, 1.5), 0.);
+      const double cost1 = in(0.05, 1.0);
+      const double sint1 = std::sqrt(1. - cost1 * cost1);
+      const Complex sintLayer = n1 * sint1 / nLayer;
+      const Complex sint2 = n1 * sint1 / n2;
+      const Complex costLayer = std::sqrt(one - sintLayer * sintLayer);
+      const Complex cost2 = std::sqrt(one - sint2 * sint2);
+      const double wavelength = in(300., 650.); // nm
+      const double thickness = in(15., 30.);    // nm
+      const double k0 = 2. * M_PI / wavelength;
+
+      sample.n1.set(k, n1);
+      sample.nLayer.set(k, nLayer);
+      sample.n2.set(k, n2);
+      sample.cost1.set(k, Complex(cost1, 0.));
+      sample.costLayer.set(k, costLayer);
+      sample.cost2.set(k, cost2);
+      sample.beta.set(k, k0 * nLayer * thickness * costLayer);
+    }
+    return sample;
+  }
+
+  struct Vec3
+  {
+    double x, y, z;
+    Vec3 operator+(const Vec3 &o) const { return {x + o.x, y + o.y, z + o.z}; }
+    Vec3 operator-(const Vec3 &o) const { return {x - o.x, y - o.y, z - o.z}; }
+    Vec3 operator*(double a) const { return {a * x, a * y, a * z}; }
+    double dot(const Vec3 &o) const { return x * o.x + y * o.y + z * o.z; }
+    Vec3 cross(const Vec3 &o) const { return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x}; }
+    Vec3 unit() const { return *this * (1.0 / std::sqrt(dot(*this))); }
+  };
+
+  /**
+   * @brief Photons hitting a dielectric interface (normal +z), e.g. gel -> glass or glass -> air.
+   */
+  struct DielectricSample
+  {
+    std::vector<Vec3> momentum, polarization;
+    std::vector<double> n1, n2;
+  };
+
+  DielectricSample generateDielectricSample(std::size_t p_size, unsigned p_seed)
+  {
+    std::mt19937_64 engine(p_seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    DielectricSample sample;
+    for (std::size_t k = 0; k < p_size; ++k)
+    {
+      const double cost = uniform(engine);
+      const double sint = std::sqrt(1. - cost * cost);
+      const double phi = 2. * M_PI * uniform(engine);
+      const Vec3 momentum{sint * std::cos(phi), sint * std::sin(phi), -cost};
+      const Vec3 helper = std::abs(momentum.x) < 0.9 ? Vec3{1, 0, 0} : Vec3{0, 1, 0};
+      const Vec3 e1 = momentum.cross(helper).unit();
+      const Vec3 e2 = momentum.cross(e1);
+      const double psi = 2. * M_PI * uniform(engine);
+      sample.momentum.push_back(momentum);
+      sample.polarization.push_back(e1 * std::cos(psi) + e2 * std::sin(psi));
+      sample.n1.push_back(1.0 + 0.6 * uniform(engine));
+      sample.n2.push_back(1.0 + 0.6 * uniform(engine));
+    }
+    return sample;
+  }
+
+  /**
+   * @brief Cosines at the interface, cost2 < 0 flags total internal reflection.
+   */
+  inline void snell(const Vec3 &p_momentum, double p_n1, double p_n2, double &p_cost1, double &p_sint1, double &p_cost2)
+  {
+    const Vec3 normal{0, 0, 1};
+    p_cost1 = -p_momentum.dot(normal);
+    p_sint1 = std::sqrt(std::max(0., 1. - p_cost1 * p_cost1));
+    const double sint2 = p_sint1 * p_n1 / p_n2;
+    p_cost2 = sint2 < 1.0 ? std::sqrt(1. - sint2 * sint2) : -1.;
+  }
+
+  /**
+   * @brief Transmission probability through parallel planar interfaces for linear polarisation at angle psi to the plane
+   * of incidence, with the polarisation of the transmitted photon updated after each interface (default mode).
+   * @param p_indices Refractive indices of the layers, starting with the incident medium.
+   * @param p_sint Sine of the incident angle in the first medium.
+   */
+  double polarizedStackTransmission(const std::vector<double> &p_indices, double p_sint, double p_psi)
+  {
+    double transmission = 1, E1Perp = std::cos(p_psi), E1Parl = std::sin(p_psi);
+    for (std::size_t i = 0; i + 1 < p_indices.size(); ++i)
+    {
+      const double sint1 = p_sint * p_indices[0] / p_indices[i], sint2 = p_sint * p_indices[0] / p_indices[i + 1];
+      if (sint2 >= 1.)
+        return 0.;
+      const DielectricAmplitudes amplitudes = FresnelKernels::dielectricAmplitudes(p_indices[i], p_indices[i + 1], std::sqrt(1. - sint1 * sint1),
+                                                                                   std::sqrt(1. - sint2 * sint2), E1Perp, E1Parl);
+      transmission *= amplitudes.transCoeff;
+      E1Perp = amplitudes.E2Perp / std::sqrt(amplitudes.E2Total);
+      E1Parl = amplitudes.E2Parl / std::sqrt(amplitudes.E2Total);
+    }
+    return transmission;
+  }
+
+  /**
+   * @brief Transmission probability through parallel planar interfaces with the polarisation averaged probability at each
+   * interface (--unpolarized_boundary).
+   */
+  double unpolarizedStackTransmission(const std::vector<double> &p_indices, double p_sint)
+  {
+    double transmission = 1;
+    for (std::size_t i = 0; i + 1 < p_indices.size(); ++i)
+    {
+      const double sint1 = p_sint * p_indices[0] / p_indices[i], sint2 = p_sint * p_indices[0] / p_indices[i + 1];
+      if (sint2 >= 1.)
+        return 0.;
+      transmission *= FresnelKernels::unpolarizedTransmission(p_indices[i], p_indices[i + 1], std::sqrt(1. - sint1 * sint1), std::sqrt(1. - sint2 * sint2));
+    }
+    return transmission;
+  }
+
+  template <typename Function>
+  double measureRate(std::size_t p_evaluations, std::size_t p_repetitions, Function &&p_function)
+  {
+    double best = 0;
+    for (std::size_t r = 0; r < p_repetitions; ++r)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      p_function();
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      best = std::max(best, p_evaluations / elapsed.count());
+    }
+    return best;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const std::size_t samples = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  const std::size_t repetitions = argc > 2 ? std::stoul(argv[2]) : 5;
+  const double batchTolerance = 1e-9;
+
+  const Sample sample = generateSample(samples, 12345);
+
+  std::vector<OpticalLayerResult> referenceResults(samples), scalarResults(samples);
+  FresnelKernels::FresnelCoefficientsSoA batch1TL, batchTL2, batch1TL2;
+  FresnelKernels::ComplexSoA batchExp2, batchExp1;
+  FresnelKernels::OpticalLayerResultSoA batchResults;
+
+  auto runReference = [&]()
+  {
+    for (std::size_t k = 0; k < samples; ++k)
+    {
+      const FresnelCoefficients c1TL = Reference::calculateFresnelCoefficientsComplex(sample.n1.get(k), sample.nLayer.get(k), sample.cost1.get(k), sample.costLayer.get(k));
+      const FresnelCoefficients cTL2 = Reference::calculateFresnelCoefficientsComplex(sample.nLayer.get(k), sample.n2.get(k), sample.costLayer.get(k), sample.cost2.get(k));
+      const FresnelCoefficients c1TL2 = Reference::threeLayerSystem(c1TL, cTL2, sample.beta.get(k));
+      referenceResults[k] = Reference::fresnel2ProbabilityComplex(c1TL2, sample.n1.re[k], sample.n2.re[k], sample.n1.im[k], sample.n2.im[k],
+                                                                  sample.cost1.get(k), sample.cost2.get(k));
+    }
+  };
+
+  auto runScalar = [&]()
+  {
+    for (std::size_t k = 0; k < samples; ++k)
+    {
+      const FresnelCoefficients c1TL = FresnelKernels::fresnelCoefficients(sample.n1.get(k), sample.nLayer.get(k), sample.cost1.get(k), sample.costLayer.get(k));
+      const FresnelCoefficients cTL2 = FresnelKernels::fresnelCoefficients(sample.nLayer.get(k), sample.n2.get(k), sample.costLayer.get(k), sample.cost2.get(k));
+      const FresnelCoefficients c1TL2 = FresnelKernels::threeLayerSystem(c1TL, cTL2, sample.beta.get(k));
+      scalarResults[k] = FresnelKernels::fresnelToProbability(c1TL2, sample.n1.get(k), sample.n2.get(k), sample.cost1.get(k), sample.cost2.get(k));
+    }
+  };
+
+  auto runBatch = [&]()
+  {
+    FresnelKernels::fresnelCoefficientsBatch(sample.n1, sample.nLayer, sample.cost1, sample.costLayer, batch1TL);
+    FresnelKernels::fresnelCoefficientsBatch(sample.nLayer, sample.n2, sample.costLayer, sample.cost2, batchTL2);
+    FresnelKernels::threeLayerSystemBatch(batch1TL, batchTL2, sample.beta, batchExp2, batchExp1, batch1TL2);
+    FresnelKernels::fresnelToProbabilityBatch(batch1TL2, sample.n1, sample.n2, sample.cost1, sample.cost2, batchResults);
+  };
+
+  const double referenceRate = measureRate(samples, repetitions, runReference);
+  const double scalarRate = measureRate(samples, repetitions, runScalar);
+  const double batchRate = measureRate(samples, repetitions, runBatch);
+
+  std::size_t scalarMismatches = 0;
+  double maxBatchDeviation = 0;
+  for (std::size_t k = 0; k < samples; ++k)
+  {
+    const OpticalLayerResult &ref = referenceResults[k];
+    const OpticalLayerResult &scalar = scalarResults[k];
+    if (scalar.Reflectivity != ref.Reflectivity || scalar.Transmittance != ref.Transmittance || scalar.Absorption != ref.Absorption)
+      ++scalarMismatches;
+
+    maxBatchDeviation = std::max({maxBatchDeviation,
+                                  std::abs(batchResults.reflectivity[k] - ref.Reflectivity),
+                                  std::abs(batchResults.transmittance[k] - ref.Transmittance),
+                                  std::abs(batchResults.absorption[k] - ref.Absorption)});
+  }
+
+  // Dielectric interface: full amplitude and polarisation bookkeeping (default) vs polarisation averaged probability (--unpolarized_boundary)
+  const DielectricSample dielectric = generateDielectricSample(samples, 54321);
+  const Vec3 normal{0, 0, 1};
+  double polarizedSink = 0, unpolarizedSink = 0;
+  auto runPolarized = [&]()
+  {
+    double sum = 0;
+    for (std::size_t k = 0; k < samples; ++k)
+    {
+      double cost1, sint1, cost2;
+      snell(dielectric.momentum[k], dielectric.n1[k], dielectric.n2[k], cost1, sint1, cost2);
+      if (cost2 < 0 || sint1 <= 0)
+        continue;
+      const Vec3 &pol = dielectric.polarization[k];
+      const Vec3 aTrans = dielectric.momentum[k].cross(normal).unit();
+      const double E1Perp = pol.dot(aTrans);
+      const double E1Parl = std::sqrt((pol - aTrans * E1Perp).dot(pol - aTrans * E1Perp));
+      const DielectricAmplitudes amplitudes = FresnelKernels::dielectricAmplitudes(dielectric.n1[k], dielectric.n2[k], cost1, cost2, E1Perp, E1Parl);
+      const double alpha = cost1 - cost2 * (dielectric.n2[k] / dielectric.n1[k]);
+      const Vec3 newMomentum = (dielectric.momentum[k] + normal * alpha).unit();
+      const Vec3 aParal = newMomentum.cross(aTrans).unit();
+      const double E2Abs = std::sqrt(amplitudes.E2Total);
+      const Vec3 newPolarization = (aParal * (amplitudes.E2Parl / E2Abs) + aTrans * (amplitudes.E2Perp / E2Abs)).unit();
+      sum += amplitudes.transCoeff + newPolarization.z;
+    }
+    polarizedSink = sum;
+  };
+  auto runUnpolarized = [&]()
+  {
+    double sum = 0;
+    for (std::size_t k = 0; k < samples; ++k)
+    {
+      double cost1, sint1, cost2;
+      snell(dielectric.momentum[k], dielectric.n1[k], dielectric.n2[k], cost1, sint1, cost2);
+      if (cost2 < 0 || sint1 <= 0)
+        continue;
+      const double transCoeff = FresnelKernels::unpolarizedTransmission(dielectric.n1[k], dielectric.n2[k], cost1, cost2);
+      const double alpha = cost1 - cost2 * (dielectric.n2[k] / dielectric.n1[k]);
+      const Vec3 newMomentum = (dielectric.momentum[k] + normal * alpha).unit();
+      const Vec3 &pol = dielectric.polarization[k];
+      const Vec3 newPolarization = (pol - newMomentum * pol.dot(newMomentum)).unit();
+      sum += transCoeff + newPolarization.z;
+    }
+    unpolarizedSink = sum;
+  };
+  const double polarizedRate = measureRate(samples, repetitions, runPolarized);
+  const double unpolarizedRate = measureRate(samples, repetitions, runUnpolarized);
+
+  // For linear polarisation at angle psi, T(psi) = T_TE cos^2 psi + T_TM sin^2 psi, so the mean of two orthogonal
+  // polarisations must equal the averaged probability. The unpolarised mode is unbiased for unpolarised light.
+  double maxAveragingDeviation = 0, meanPolarizedTransmission = 0, meanUnpolarizedTransmission = 0, meanTETransmission = 0, meanTMTransmission = 0;
+  std::size_t transmitted = 0;
+  for (std::size_t k = 0; k < samples; ++k)
+  {
+    double cost1, sint1, cost2;
+    snell(dielectric.momentum[k], dielectric.n1[k], dielectric.n2[k], cost1, sint1, cost2);
+    if (cost2 < 0)
+      continue;
+    const Vec3 &pol = dielectric.polarization[k];
+    const double E1Perp = sint1 > 0 ? pol.dot(dielectric.momentum[k].cross(normal).unit()) : 0.;
+    const double E1Parl = std::sqrt(std::max(0., 1. - E1Perp * E1Perp));
+    const double t1 = FresnelKernels::dielectricAmplitudes(dielectric.n1[k], dielectric.n2[k], cost1, cost2, E1Perp, E1Parl).transCoeff;
+    const double t2 = FresnelKernels::dielectricAmplitudes(dielectric.n1[k], dielectric.n2[k], cost1, cost2, E1Parl, E1Perp).transCoeff;
+    const double averaged = FresnelKernels::unpolarizedTransmission(dielectric.n1[k], dielectric.n2[k], cost1, cost2);
+    maxAveragingDeviation = std::max(maxAveragingDeviation, std::abs(0.5 * (t1 + t2) - averaged));
+    meanPolarizedTransmission += t1;
+    meanUnpolarizedTransmission += averaged;
+    meanTETransmission += FresnelKernels::dielectricAmplitudes(dielectric.n1[k], dielectric.n2[k], cost1, cost2, 1., 0.).transCoeff;
+    meanTMTransmission += FresnelKernels::dielectricAmplitudes(dielectric.n1[k], dielectric.n2[k], cost1, cost2, 0., 1.).transCoeff;
+    ++transmitted;
+  }
+  meanPolarizedTransmission /= std::max<std::size_t>(transmitted, 1);
+  meanUnpolarizedTransmission /= std::max<std::size_t>(transmitted, 1);
+  meanTETransmission /= std::max<std::size_t>(transmitted, 1);
+  meanTMTransmission /= std::max<std::size_t>(transmitted, 1);
+
+  std::printf("Fresnel thin layer kernels, %zu samples, best of %zu repetitions\n", samples, repetitions);
+  std::printf("  %-10s %14.4e evaluations/s\n", "reference", referenceRate);
+  std::printf("  %-10s %14.4e evaluations/s (x%.2f)\n", "scalar", scalarRate, scalarRate / referenceRate);
+  std::printf("  %-10s %14.4e evaluations/s (x%.2f)\n", "batch", batchRate, batchRate / referenceRate);
+  std::printf("Scalar kernel mismatches w.r.t. reference: %zu\n", scalarMismatches);
+  std::printf("Batch kernel max. absolute deviation w.r.t. reference: %.3e (tolerance %.1e)\n", maxBatchDeviation, batchTolerance);
+
+  std::printf("Dielectric interface, per boundary interaction (checksums %.3f / %.3f)\n", polarizedSink, unpolarizedSink);
+  std::printf("  %-12s %14.4e interactions/s\n", "polarised", polarizedRate);
+  std::printf("  %-12s %14.4e interactions/s (x%.2f)\n", "unpolarised", unpolarizedRate, unpolarizedRate / polarizedRate);
+  std::printf("Mean transmission for random linear polarisation %.6f, polarisation averaged %.6f\n", meanPolarizedTransmission, meanUnpolarizedTransmission);
+  std::printf("Mean transmission for TE (s) polarisation %.6f, TM (p) polarisation %.6f\n", meanTETransmission, meanTMTransmission);
+  std::printf("Averaging identity max. deviation: %.3e (tolerance %.1e)\n", maxAveragingDeviation, batchTolerance);
+
+  // Planar stack water -> pressure vessel glass -> gel -> PMT glass; averaged over the linear polarisation angle
+  const std::vector<double> stack{1.33, 1.48, 1.40, 1.48};
+  const std::size_t polarisationAngles = 3600;
+  std::printf("Stack transmission water/glass/gel/glass, unpolarised light, per angle of incidence in water\n");
+  std::printf("  %6s %12s %12s %12s\n", "angle", "polarised", "averaged", "rel. diff.");
+  for (double angle : {0., 30., 45., 60., 70., 75., 80., 85., 88.})
+  {
+    const double sint = std::sin(angle * M_PI / 180.);
+    double polarized = 0;
+    for (std::size_t j = 0; j < polarisationAngles; ++j)
+      polarized += polarizedStackTransmission(stack, sint, M_PI * (j + 0.5) / polarisationAngles);
+    polarized /= polarisationAngles;
+    const double averaged = unpolarizedStackTransmission(stack, sint);
+    std::printf("  %6.1f %12.6f %12.6f %12.2e\n", angle, polarized, averaged, (averaged - polarized) / polarized);
+  }
+
+  const bool passed = scalarMismatches == 0 && maxBatchDeviation <= batchTolerance && maxAveragingDeviation <= batchTolerance;
+  std::printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -24,6 +24,7 @@
 #include <G4UIExecutive.hh>
 
 #include <boost/program_options.hpp>
+#include <functional>
 
 namespace po = boost::program_options;
 
@@ -47,7 +48,7 @@ public:
 
     void initialiseSimulation(OMSimDetectorConstruction *pDetectorConstruction);
     void configureLogger();
-    bool handleArguments(int pArgumentCount, char *pArgumentVector[]);
+    bool handleArguments(int pArgumentCount, char *pArgumentVector[], const std::function<void(OMSimCommandArgsTable &)> &pDeriveArguments = nullptr);
     void startVisualisation();
 
     G4Navigator *getNavigator() { return m_navigator.get(); };
@@ -58,7 +59,7 @@ private:
     void initialLoggerConfiguration();
     int determineNumberOfThreads();
     po::variables_map parseArguments(int pArgumentCount, char *pArgumentVector[]);
-    void setUserArgumentsToArgTable(po::variables_map pVariablesMap);
+    void setUserArgumentsToArgTable(po::variables_map pVariablesMap, const std::function<void(OMSimCommandArgsTable &)> &pDeriveArguments);
     void setGeneralOptions();
 
     std::unique_ptr<G4MTRunManager> m_runManager;
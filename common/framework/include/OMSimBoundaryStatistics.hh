@@ -0,0 +1,93 @@
+/**
+ * @file OMSimBoundaryStatistics.hh
+ * @brief Counters of optical boundary interactions for profiling.
+ * @ingroup common
+ */
+
+#pragma once
+
+#include "OMSimOpBoundaryProcess.hh"
+
+#include <G4AutoLock.hh>
+#include <G4Material.hh>
+#include <G4Threading.hh>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+
+/**
+ * @class OMSimBoundaryStatistics
+ * @brief Counts optical boundary interactions per model, material pair and outcome, and samples their cost.
+ *
+ * Enabled with the argument `--boundary_stats`. Each call of G4OpBoundaryProcess::PostStepDoIt is counted in
+ * thread local counters (no locks during the run), grouped by OpBoundaryModel and by the pair of materials of the step.
+ * The cost (CPU cycles on x86, otherwise nanoseconds) is measured for one out of k_samplePeriod calls.
+ *
+ * At the end of each run the workers merge their counters (see OMSimRunAction::EndOfRunAction) and the master
+ * writes the accumulated statistics to "<output_file>_boundary_stats.json".
+ * The global instance pattern is used; its lifecycle is managed by the OMSim class.
+ * @ingroup common
+ */
+class OMSimBoundaryStatistics
+{
+public:
+    static constexpr std::uint64_t k_samplePeriod = 16;
+    static constexpr std::size_t k_numberOfModels = static_cast<std::size_t>(OpBoundaryModel::Count);
+    static constexpr std::size_t k_numberOfStatuses = static_cast<std::size_t>(CoatedDielectricFrustratedTransmission) + 1;
+
+    static void init();
+    static void shutdown();
+    static OMSimBoundaryStatistics &getInstance();
+    static bool isEnabled();
+
+    std::uint64_t startCall();
+    void endCall(std::uint64_t p_costStart, OpBoundaryModel p_model, G4OpBoundaryProcessStatus p_status,
+                 const G4Material *p_material1, const G4Material *p_material2);
+
+    void mergeThreadData();
+    void endOfRun();
+    void writeToJson(const std::string &p_fileName);
+
+private:
+    OMSimBoundaryStatistics(const std::string &p_outputFileName) : m_outputFileName(p_outputFileName){};
+    ~OMSimBoundaryStatistics() = default;
+    OMSimBoundaryStatistics(const OMSimBoundaryStatistics &) = delete;
+    OMSimBoundaryStatistics &operator=(const OMSimBoundaryStatistics &) = delete;
+
+    struct CostCounters
+    {
+        std::uint64_t calls = 0;
+        std::uint64_t sampledCalls = 0;
+        std::uint64_t sampledCost = 0;
+    };
+    struct ModelCounters : CostCounters
+    {
+        std::array<std::uint64_t, k_numberOfStatuses> statuses{};
+    };
+    using PairKey = std::tuple<const G4Material *, const G4Material *, OpBoundaryModel>;
+    using NamedPairKey = std::tuple<std::string, std::string, OpBoundaryModel>;
+
+    struct ThreadLocalData
+    {
+        std::array<ModelCounters, k_numberOfModels> models{};
+        std::map<PairKey, CostCounters> materialPairs;
+        std::uint64_t callCounter = 0;
+    };
+
+    std::string m_outputFileName;
+    std::uint64_t m_runs = 0;
+    std::array<ModelCounters, k_numberOfModels> m_models{};
+    std::map<NamedPairKey, CostCounters> m_materialPairs;
+
+    static G4Mutex m_mutex;
+    G4ThreadLocal static ThreadLocalData *m_threadData;
+};
+
+inline OMSimBoundaryStatistics *g_boundaryStatistics = nullptr;
+
+/**
+ * @return true if the statistics were requested (the instance exists); cheap check done for every boundary call.
+ */
+inline bool OMSimBoundaryStatistics::isEnabled() { return g_boundaryStatistics != nullptr; }
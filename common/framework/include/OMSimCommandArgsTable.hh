@@ -22,6 +22,29 @@
         {                                                              \
             outputFile << boost::any_cast<TYPE>(VARIANT);                 \
         }                                                              \
+        isWritten = true;                                              \
+    }
+
+/**
+ * @brief Writes a key-value pair to a JSON file as an array if the value is a std::vector<TYPE>.
+ * @note This macro is used inside the `OMSimCommandArgsTable::writeToJson()` method.
+ */
+#define WRITE_ARRAY_TO_JSON_IF_TYPE_MATCHES(VARIANT, TYPE)                                     \
+    if (type == typeid(std::vector<TYPE>))                                                     \
+    {                                                                                          \
+        outputFile << "\t\"" << kv.first << "\": [";                                           \
+        const std::vector<TYPE> &values = boost::any_cast<const std::vector<TYPE> &>(VARIANT); \
+        for (size_t i = 0; i < values.size(); ++i)                                             \
+        {                                                                                      \
+            if (i != 0)                                                                        \
+                outputFile << ", ";                                                            \
+            if (typeid(TYPE) == typeid(std::string))                                           \
+                outputFile << "\"" << values[i] << "\"";                                       \
+            else                                                                               \
+                outputFile << values[i];                                                       \
+        }                                                                                      \
+        outputFile << "]";                                                                     \
+        isWritten = true;                                                                      \
     }
 
 #include "OMSimLogger.hh"
@@ -30,6 +53,7 @@
 #include <boost/any.hpp>
 #include <sys/time.h>
 #include <map>
+#include <vector>
 
 // Forward declaration of the class
 class OMSimCommandArgsTable;
@@ -70,6 +94,7 @@ public:
     void setParameter(const Key &p_key, const Value &p_value);
     bool keyExists(const Key &p_key); 
     void writeToJson(std::string p_fileName);
+    void setDefaultSeed();
     void finalize();
     
     /**
@@ -84,6 +84,8 @@ public:
     HitStats getMergedHitsOfModule(int pModuleIndex = 0);
     HitStats getSingleThreadHitsOfModule(int pModuleIndex = 0);
     bool areThereHitsInModuleSingleThread(int pModuleIndex = 0);
+    std::map<G4int, HitStats> extractSingleThreadHits();
+    G4int getNumberOfPMTs(int pModuleIndex = 0);
     void sortHitStatsByTime(HitStats &pHits);
     std::vector<int> calculateMultiplicity(const G4double pTimeWindow, int pModuleNumber = 0);
     G4int getNextDetectorIndex() { return ++m_currentIndex; }
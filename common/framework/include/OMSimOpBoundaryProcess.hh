@@ -62,6 +62,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #pragma once
+#include "OMSimFresnelKernels.hh"
 #include "G4OpticalPhoton.hh"
 #include "G4OpticalSurface.hh"
 #include "G4RandomTools.hh"
@@ -69,43 +70,67 @@
 #include "G4VUserTrackInformation.hh"
 #include <G4AutoLock.hh>
 #include <G4Threading.hh>
-
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+/**
+ * @class PhotonMaterialTracking
+ * @brief Track information holding the most recent materials crossed by an optical photon.
+ *
+ * Only the last few materials are needed by the thin-layer model (see PhotocathodeCoatedComplex), so the
+ * history is stored in a fixed-capacity inline ring instead of a growing vector. Instances are recycled
+ * through PhotonMaterialTrackingPool.
+ */
 class PhotonMaterialTracking : public G4VUserTrackInformation
 {
 public:
+    static constexpr std::size_t k_historyCapacity = 4;
+
     PhotonMaterialTracking() : G4VUserTrackInformation() {}
     virtual ~PhotonMaterialTracking() {}
 
     void addVolume(G4MaterialPropertiesTable* mpt) {
-        if (mVolumeHistory.empty() || mpt != mVolumeHistory.back()) {
-            mVolumeHistory.push_back(mpt);
+        if (m_size == 0 || mpt != getNthPreviousVolume(0)) {
+            m_history[m_size % k_historyCapacity] = mpt;
+            ++m_size;
         }
     }
-    
-    G4MaterialPropertiesTable* getNthPreviousVolume(G4int n) {
-        if (n < mVolumeHistory.size())
-            return mVolumeHistory[mVolumeHistory.size() - 1 - n];
+
+    G4MaterialPropertiesTable* getNthPreviousVolume(G4int n) const {
+        if (n >= 0 && static_cast<std::size_t>(n) < std::min(m_size, k_historyCapacity))
+            return m_history[(m_size - 1 - n) % k_historyCapacity];
         return nullptr;
     }
 
-    G4int getVolumeHistorySize() const { return mVolumeHistory.size(); }
+    /** @return Number of recorded materials (can be larger than the number of stored ones). */
+    G4int getVolumeHistorySize() const { return static_cast<G4int>(m_size); }
+
+    void reset() { m_size = 0; }
 
 private:
-    std::vector<G4MaterialPropertiesTable*> mVolumeHistory;
+    std::array<G4MaterialPropertiesTable*, k_historyCapacity> m_history{};
+    std::size_t m_size = 0;
 };
 
-struct OpticalLayerResult
-{
-  G4double Reflectivity;
-  G4double Transmittance;
-  G4double Absorption;
-};
-struct FresnelCoefficients
+/**
+ * @class PhotonMaterialTrackingPool
+ * @brief Per-thread free list of PhotonMaterialTracking objects.
+ *
+ * The boundary process acquires an object when a photon first reaches a boundary, and OMSimTrackingAction
+ * gives it back when the track dies, so no allocation is needed for the following photons of the thread.
+ * Objects that are not released are deleted by G4Track as usual, as the pool only owns the free ones.
+ */
+class PhotonMaterialTrackingPool
 {
-  G4complex rTE;
-  G4complex rTM;
-  G4complex tTE;
-  G4complex tTM;
+public:
+    static PhotonMaterialTracking* acquire();
+    static void release(const G4Track* p_track);
+
+private:
+    static constexpr std::size_t k_maxPooled = 1024;
+    static thread_local std::vector<std::unique_ptr<PhotonMaterialTracking>> m_freeList;
 };
 
 enum G4OpBoundaryProcessStatus
@@ -155,6 +180,22 @@ enum G4OpBoundaryProcessStatus
   CoatedDielectricFrustratedTransmission
 };
 
+/**
+ * @brief Model that handled a boundary interaction, used to group the counters of OMSimBoundaryStatistics.
+ */
+enum class OpBoundaryModel
+{
+  None,               ///< No model invoked (not at a boundary, step too small, missing RINDEX...)
+  DielectricGlisur,   ///< dielectric_dielectric with glisur model (also the default without optical surface)
+  DielectricUnified,  ///< dielectric_dielectric with unified model
+  DielectricMetal,    ///< dielectric_metal
+  LUT,                ///< dielectric_LUT
+  DAVIS,              ///< dielectric_LUTDAVIS
+  Dichroic,           ///< dielectric_dichroic
+  CoatedPhotocathode, ///< coated, thin layer photocathode (PhotocathodeCoatedComplex)
+  Count
+};
+
 class G4OpBoundaryProcess : public G4VDiscreteProcess
 {
 public:
@@ -174,7 +215,8 @@ public:
 
   G4VParticleChange *PostStepDoIt(const G4Track &aTrack,
                                   const G4Step &aStep) override;
-  // This is the method implementing boundary processes.
+  // This is the method implementing boundary processes. If OMSimBoundaryStatistics
+  // is enabled, each call is counted (and its cost sampled) around BoundaryDoIt.
 
   virtual G4OpBoundaryProcessStatus GetStatus() const;
   // Returns the current status.
@@ -188,12 +230,21 @@ public:
 
   void SetVerboseLevel(G4int);
 
+  void SetUnpolarized(G4bool p_unpolarized) { fUnpolarized = p_unpolarized; }
+  // If true, dielectric and photocathode boundaries use polarisation averaged Fresnel
+  // probabilities and the outgoing polarisation is only kept transverse, not recomputed.
+  G4bool GetUnpolarized() const { return fUnpolarized; }
+
 private:
   G4OpBoundaryProcess(const G4OpBoundaryProcess &right) = delete;
   G4OpBoundaryProcess &operator=(const G4OpBoundaryProcess &right) = delete;
 
   G4bool G4BooleanRand(const G4double prob) const;
 
+  G4VParticleChange *BoundaryDoIt(const G4Track &aTrack, const G4Step &aStep);
+
+  OpBoundaryModel StatisticsModel(G4SurfaceType p_type) const;
+
   G4ThreeVector GetFacetNormal(const G4ThreeVector &Momentum,
                                const G4ThreeVector &Normal) const;
   G4Mutex boundaryProcessMutex; 
@@ -218,25 +269,14 @@ private:
                            G4double ImaginaryRindex);
   // Returns the Reflectivity on a metallic surface
 
-  FresnelCoefficients ThreeLayerSystem(FresnelCoefficients pCoefficientsL1, FresnelCoefficients pCoefficientsL2, G4complex pFactor);
-
   G4OpBoundaryProcessStatus getStatus(OpticalLayerResult pResults);
 
+  G4ThreeVector TransversePolarization(const G4ThreeVector &p_polarization, const G4ThreeVector &p_momentum) const;
+  // Component of p_polarization perpendicular to p_momentum (unpolarised mode)
+
   // complex angle functions
   OpticalLayerResult CalculateThinLayerCoefficientsComplex(G4double sinTL, G4double wavelength,
                                                            G4complex cost1, G4complex cost2, G4Track pTrack);
-  FresnelCoefficients CalculateFresnelCoefficientsComplex(G4complex pComplexRindex1,
-                                                          G4complex pComplexRindex2,
-                                                          G4complex pCost1,
-                                                          G4complex pCost2);
-
-  OpticalLayerResult Fresnel2ProbabilityComplex(FresnelCoefficients pCoefficients,
-                                                G4double pRindex1,
-                                                G4double pRindex2,
-                                                G4double pImagRIndex1,
-                                                G4double pImagRIndex2,
-                                                G4complex pCost1,
-                                                G4complex pCost2);
 
   void CalculateReflectivity();
 
@@ -313,6 +353,10 @@ private:
   size_t idx_coatedabslength = 0;
 
   G4bool fInvokeSD;
+
+  G4bool fUnpolarized = false;
+
+  OpBoundaryModel fStatisticsModel = OpBoundaryModel::None;
 };
 
 ////////////////////
@@ -0,0 +1,178 @@
+/**
+ * @file OMSimPhotonBeamGenerator.hh
+ * @brief Native optical photon beam generator with a typed configuration, used instead of the G4GeneralParticleSource.
+ * @ingroup common
+ */
+
+#pragma once
+
+#include <G4AutoLock.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4ThreeVector.hh>
+#include <G4VUserPrimaryGeneratorAction.hh>
+
+#include <atomic>
+#include <vector>
+
+class G4Event;
+
+/**
+ * @brief Shape of the emitting surface of the beam.
+ */
+enum class BeamShape
+{
+    Point,    ///< All photons start at the centre.
+    Disc,     ///< Uniform on a disc of BeamConfiguration::radius.
+    Rectangle ///< Uniform on a rectangle of half lengths BeamConfiguration::halfX, BeamConfiguration::halfY.
+};
+
+/**
+ * @brief Angular distribution of the photons with respect to the beam axis.
+ */
+enum class BeamAngularDistribution
+{
+    Collimated,  ///< All photons along the beam axis (GPS beam2d with sigma 0).
+    Gaussian,    ///< Polar angle Gaussian distributed with BeamConfiguration::sigmaAngle (GPS beam1d).
+    Focused,     ///< Towards BeamConfiguration::focusPoint (GPS focused).
+    ThetaProfile ///< Polar angle from a tabulated profile (GPS user with a theta histogram).
+};
+
+/**
+ * @brief Bounding volume of everything photons can interact with, used to skip photons that can not reach it.
+ *
+ * A photon is culled if its straight line misses the sphere or the cylinder (axis along z). Only valid if the world
+ * medium does not scatter (see OMSimDetectorConstruction::getBoundingVolume). Lengths in Geant4 units.
+ */
+struct BeamCullVolume
+{
+    G4ThreeVector centre;            ///< Centre of the sphere and the cylinder.
+    G4double sphereRadius = 0;       ///< Radius of the sphere, 0 to skip the sphere test.
+    G4double cylinderRadius = 0;     ///< Radius of the cylinder, 0 to skip the cylinder test.
+    G4double cylinderHalfHeight = 0; ///< Half height of the cylinder.
+
+    bool isEnabled() const { return sphereRadius > 0 || cylinderRadius > 0; };
+};
+
+/**
+ * @brief Typed configuration of OMSimPhotonBeamGenerator.
+ *
+ * The source plane is spanned by rot1 and rot2, which are orthonormalised as in the GPS. Photons are emitted along the
+ * beam axis -(rot1 x rot2), the same convention as the GPS with equal /gps/pos/rot and /gps/ang/rot axes.
+ * Lengths and angles in Geant4 units.
+ */
+struct BeamConfiguration
+{
+    BeamShape shape = BeamShape::Point;
+    G4ThreeVector centre;                        ///< Centre of the source.
+    G4ThreeVector rot1 = G4ThreeVector(1, 0, 0); ///< First axis of the source plane.
+    G4ThreeVector rot2 = G4ThreeVector(0, 1, 0); ///< Second axis of the source plane.
+    G4double radius = 0;                         ///< Radius of BeamShape::Disc.
+    G4double halfX = 0;                          ///< Half length of BeamShape::Rectangle along rot1.
+    G4double halfY = 0;                          ///< Half length of BeamShape::Rectangle along rot2.
+    G4double sigmaPosition = 0;                  ///< Gaussian smearing of the start position along each plane axis (GPS pos/sigma_r).
+
+    BeamAngularDistribution angular = BeamAngularDistribution::Collimated;
+    G4double sigmaAngle = 0;             ///< Sigma of the polar angle for BeamAngularDistribution::Gaussian.
+    G4ThreeVector focusPoint;            ///< Target point of BeamAngularDistribution::Focused.
+    std::vector<G4double> thetaProfileX; ///< Polar angle bin upper edges in rad, first entry is the lower edge (GPS /gps/hist/point convention).
+    std::vector<G4double> thetaProfileY; ///< Weight of each bin of thetaProfileX.
+    G4double maxTheta = CLHEP::pi;       ///< The tabulated profile is truncated at this polar angle.
+
+    G4double energy = 1239.84193 / 400. * eV; ///< Photon energy.
+    std::vector<G4double> wavelengthList;      ///< If not empty, each photon gets one of these wavelengths (length units) with equal probability (overrides energy).
+    std::vector<G4double> wavelengthSpectrumX; ///< If not empty, wavelengths (length units) are drawn from this piecewise linear spectrum (overrides energy and wavelengthList).
+    std::vector<G4double> wavelengthSpectrumY; ///< Spectral density at wavelengthSpectrumX.
+
+    BeamCullVolume cullVolume; ///< Photons missing this volume are counted but not tracked (disabled by default).
+
+    G4int footprintRings = 0;                     ///< Equal-area rings of the footprint cells of BeamShape::Disc, 0 to sample the disc without cells.
+    G4int footprintSectors = 0;                   ///< Sectors of each footprint ring.
+    std::vector<G4double> footprintProbabilities; ///< [ring * footprintSectors + sector] positive probability to sample each cell, empty for uniform sampling.
+};
+
+/**
+ * @class OMSimPhotonBeamGenerator
+ * @brief Generates optical photons from a disc, rectangle or point source with analytic sampling.
+ *
+ * The configuration is set with setConfiguration (normally on the master between runs, e.g. AngularScan::configureScan)
+ * and copied by each worker's generator at the next event, so no UI commands are parsed or broadcast. A generator can also
+ * move its beam for single events with setBeamGeometry, which is how multi-direction scans place the beam per event.
+ * While an OMSimScanQueue plan is running, each event uses the beam of its scan point instead.
+ * Unlike the GPS (whose source data is shared between threads), no lock is taken during generation.
+ *
+ * With --photons_per_event K, each event gets K independent photons (one primary vertex each), which amortises the per-event
+ * overhead of Geant4 (event allocation, stacking, user event actions). Photon counts (numevents, scan photons) stay photon
+ * counts; use getNumberOfEvents to convert them to the number of events of /run/beamOn.
+ *
+ * If the configuration has a BeamCullVolume, photons whose straight line misses it are not added to the event. They are
+ * still simulated photons (the normalisation does not change), so the energies of the culled photons of the last event of
+ * each thread are kept for the analysis (getCulledEnergies).
+ *
+ * A disc beam can be divided into footprint cells of equal area. All photons of an event then start in one cell, drawn
+ * with the probabilities of the configuration (importance sampling), and the event gets the weight
+ * (1 / number of cells) / probability, so that weighted tallies estimate the same quantities as a uniform beam.
+ * Without probabilities the cells are drawn uniformly (weight 1), which is how the hits per cell of a pilot run are recorded.
+ *
+ * Photons get a random polarisation perpendicular to their momentum.
+ * Studies derive their OMSimPrimaryGeneratorAction from this class.
+ * @ingroup common
+ */
+class OMSimPhotonBeamGenerator : public G4VUserPrimaryGeneratorAction
+{
+public:
+    OMSimPhotonBeamGenerator();
+    ~OMSimPhotonBeamGenerator() override = default;
+
+    void GeneratePrimaries(G4Event *p_event) override;
+
+    static void setConfiguration(const BeamConfiguration &p_configuration);
+    static BeamConfiguration getConfiguration();
+    static G4int getPhotonsPerEvent();
+    static void setPhotonsPerEvent(G4int p_photonsPerEvent);
+    static G4int getNumberOfEvents(G4long p_photons = -1);
+    static G4long getNumberOfCulledPhotons() { return m_culledPhotons.load(); };
+    static void resetNumberOfCulledPhotons() { m_culledPhotons.store(0); };
+    static bool missesCullVolume(const BeamCullVolume &p_volume, const G4ThreeVector &p_position, const G4ThreeVector &p_direction);
+
+    const std::vector<G4double> &getCulledEnergies() const { return m_culledEnergies; };
+
+    void setBeamGeometry(const G4ThreeVector &p_centre, const G4ThreeVector &p_rot1, const G4ThreeVector &p_rot2);
+    void setFootprintProbabilities(const std::vector<G4double> &p_probabilities);
+    G4int getEventCell() const { return m_eventCell; };
+    G4double getEventWeight() const { return m_eventWeight; };
+
+private:
+    void updateConfiguration();
+    void applyScanPoint(G4int p_point);
+    void calculateFrame();
+    void calculateThetaProfile();
+    void calculateSpectrum();
+    void calculateFootprint();
+    void sampleFootprintCell();
+    G4double sampleEnergy();
+    G4ThreeVector samplePosition();
+    G4ThreeVector sampleDirection(const G4ThreeVector &p_position);
+    G4double sampleProfileTheta();
+    G4ThreeVector toGlobal(G4double p_theta, G4double p_phi);
+
+    BeamConfiguration m_configuration; ///< Configuration of this thread.
+    unsigned int m_version = 0;        ///< Version of the global configuration copied to m_configuration.
+    G4int m_photonsPerEvent;
+    G4int m_scanPoint = -1;            ///< Scan point (see OMSimScanQueue) whose beam is in m_configuration, -1 if none.
+    G4ThreeVector m_axis1;
+    G4ThreeVector m_axis2;
+    G4ThreeVector m_axis3;
+    std::vector<G4double> m_profileCDF; ///< Normalised cumulative weights at thetaProfileX.
+    G4double m_profileMaxCDF = 1;       ///< Cumulative weight at maxTheta.
+    std::vector<G4double> m_spectrumCDF; ///< Normalised cumulative integral of the wavelength spectrum at wavelengthSpectrumX.
+    std::vector<G4double> m_culledEnergies; ///< Energies of the photons of the last event that were culled.
+    std::vector<G4double> m_footprintCDF;   ///< Normalised cumulative footprint probabilities, empty for equal probabilities.
+    G4int m_eventCell = -1;                 ///< Footprint cell of the last event, -1 if the beam has no footprint cells.
+    G4double m_eventWeight = 1;             ///< Importance weight of the last event.
+
+    static BeamConfiguration m_globalConfiguration;
+    static std::atomic<unsigned int> m_globalVersion;
+    static std::atomic<G4long> m_culledPhotons; ///< Culled photons of all threads since the last reset.
+    static std::atomic<G4int> m_photonsPerEventOverride; ///< Photons per event set with setPhotonsPerEvent, 0 if not set.
+    static G4Mutex m_mutex;
+};
@@ -0,0 +1,60 @@
+/**
+ * @file OMSimScanJournal.hh
+ * @brief Journal of completed scan points, used to resume interrupted scans.
+ * @ingroup common
+ */
+
+#pragma once
+
+#include "globals.hh"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @class OMSimScanJournal
+ * @brief Records which points of a scan were completed, so that an interrupted job can be resumed with `--resume`.
+ *
+ * After each completed point, the number of completed points, the size of the output file and the state of the random engine
+ * are written to "<output_file>_<scan name>_journal.txt". The file is first written to a temporary file and then renamed, so a
+ * job killed at any moment leaves either the previous or the new record.
+ *
+ * When resuming, the output file is truncated to the recorded size (dropping a partially written row) and the random engine is
+ * restored. The runs of the master draw the event seeds from this engine, so the remaining points give the same output as an
+ * uninterrupted job.
+ *
+ * Typical use:
+ * @code
+ * OMSimScanJournal journal("angular_scan", outputFileName, numberOfPoints);
+ * if (!journal.isResuming()) analysisManager.writeHeader(...);
+ * journal.recordStart();
+ * for (std::size_t i = 0; i < numberOfPoints; i++)
+ * {
+ *     if (journal.isCompleted(i)) continue;
+ *     // run and write point i
+ *     journal.recordCompleted(i);
+ * }
+ * @endcode
+ * @ingroup common
+ */
+class OMSimScanJournal
+{
+public:
+    OMSimScanJournal(const std::string &p_scanName, const std::string &p_outputFileName, std::size_t p_numberOfPoints);
+
+    bool isResuming() const { return m_resuming; };
+    bool isCompleted(std::size_t p_point) const { return p_point < m_completedPoints; };
+    void recordStart();
+    void recordCompleted(std::size_t p_point);
+
+private:
+    void read();
+    void write();
+
+    std::string m_scanName;
+    std::string m_outputFileName;
+    std::string m_journalFileName;
+    std::size_t m_numberOfPoints;
+    std::size_t m_completedPoints = 0;
+    bool m_resuming = false;
+};
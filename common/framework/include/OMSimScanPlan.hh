@@ -0,0 +1,69 @@
+/**
+ * @file OMSimScanPlan.hh
+ * @brief Declarative description of the points of a scan, read from a json file.
+ * @ingroup common
+ */
+
+#pragma once
+
+#include "globals.hh"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One point of a scan plan: values of the source parameters and number of photons.
+ */
+struct ScanPoint
+{
+    std::map<std::string, G4double> parameters; ///< Parameter name -> value, in the units of the plan file.
+    G4int photons = 0;                          ///< Number of photons (events) of this point.
+
+    G4double get(const std::string &p_name) const;
+    G4double get(const std::string &p_name, G4double p_default) const;
+};
+
+/**
+ * @class OMSimScanPlan
+ * @brief Reads the points of a scan from a json file, so that studies do not hard code their loops around /run/beamOn.
+ *
+ * Three designs are supported:
+ * @code
+ * {"design": "grid", "photons": 100000,
+ *  "parameters": {"theta": {"start": 0, "stop": 180, "step": 10}, "phi": [0, 45, 90]}}
+ *
+ * {"design": "list", "photons": 100000,
+ *  "points": [{"theta": 0, "phi": 0}, {"theta": 90, "phi": 45, "photons": 500000}]}
+ *
+ * {"design": "random", "points": 200, "photons": 100000,
+ *  "parameters": {"theta": {"min": 0, "max": 180}, "phi": {"min": 0, "max": 360}}}
+ * @endcode
+ * A grid is the Cartesian product of the value lists (ranges exclude "stop", as Tools::arange), with the first parameter varying
+ * slowest. Random points are drawn uniformly from the master random engine, so they are reproducible with --seed.
+ * "photons" defaults to numevents. The meaning and units of the parameters are defined by the study running the plan.
+ * @ingroup common
+ */
+class OMSimScanPlan
+{
+public:
+    OMSimScanPlan(const std::string &p_fileName);
+
+    std::size_t getNumberOfPoints() const { return m_points.size(); };
+    const ScanPoint &getPoint(std::size_t p_index) const { return m_points.at(p_index); };
+    const std::vector<ScanPoint> &getPoints() const { return m_points; };
+    const std::vector<std::string> &getParameterNames() const { return m_parameterNames; };
+
+private:
+    void readGrid(const boost::property_tree::ptree &p_tree);
+    void readList(const boost::property_tree::ptree &p_tree);
+    void readRandom(const boost::property_tree::ptree &p_tree);
+    std::vector<G4double> readValues(const std::string &p_name, const boost::property_tree::ptree &p_node);
+
+    std::string m_fileName;
+    G4int m_photons;
+    std::vector<std::string> m_parameterNames;
+    std::vector<ScanPoint> m_points;
+};
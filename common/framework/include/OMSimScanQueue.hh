@@ -0,0 +1,76 @@
+/**
+ * @file OMSimScanQueue.hh
+ * @brief Runs all points of a scan plan in a single run, streaming the result of each point as soon as it is complete.
+ * @ingroup common
+ */
+
+#pragma once
+
+#include "OMSimHitManager.hh"
+#include "OMSimPhotonBeamGenerator.hh"
+#include "OMSimScanPlan.hh"
+
+#include <G4AutoLock.hh>
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <memory>
+
+class G4Event;
+
+/**
+ * @brief Hits of one scan point in module 0.
+ */
+struct ScanPointTally
+{
+    std::vector<double> weightedHits; ///< [PMT] hits weighted with detection probability, last entry is the module total.
+    double countedHits = 0;           ///< Number of hits (unweighted) in the module.
+};
+
+/**
+ * @class OMSimScanQueue
+ * @brief Work queue running the points of an OMSimScanPlan as event batches of one run.
+ *
+ * The events of the run are assigned to the points in order (the events of the photons of point 0, then point 1, ...) and the
+ * Geant4 event loop hands them out to the workers in batches (/run/eventModulo), so no thread waits at the end of a point
+ * and there is no per-point run overhead. OMSimPhotonBeamGenerator switches to the beam of the point of each event.
+ *
+ * The study's event action passes the hits of each event to endOfEvent, which adds them to a thread local tally of the
+ * point. When the last event of a point ends, the tallies of all threads are summed and the point is written with the
+ * study's writer; points are written in plan order, as soon as they and all points before them are complete.
+ * @ingroup common
+ */
+class OMSimScanQueue
+{
+public:
+    /**
+     * @brief Writes the result of one point. Called under a lock from the thread completing the point.
+     */
+    using PointWriter = std::function<void(std::ostream &p_output, const ScanPoint &p_point, const ScanPointTally &p_tally)>;
+
+    static void run(const OMSimScanPlan &p_plan, const std::vector<BeamConfiguration> &p_beams, G4int p_numberOfPMTs,
+                    const std::string &p_outputFileName, const PointWriter &p_writer);
+    static bool isRunning() { return !m_eventOffsets.empty(); };
+    static G4int getPointOfEvent(G4int p_eventID);
+    static const BeamConfiguration &getBeam(G4int p_point) { return m_beams->at(p_point); };
+    static void endOfEvent(const G4Event *p_event, const HitStats *p_moduleHits);
+
+private:
+    static void writeCompletedPoints();
+
+    static const OMSimScanPlan *m_plan;
+    static const std::vector<BeamConfiguration> *m_beams;
+    static PointWriter m_writer;
+    static std::ofstream m_output;
+    static G4int m_numberOfPMTs;
+    static std::size_t m_nextPoint;                                           ///< First point not yet written
+    static unsigned int m_generation;                                         ///< Counts the runs, to reset the thread tallies of a new run
+    static std::vector<G4int> m_eventOffsets;                                 ///< Cumulative number of events up to and including each point, empty if no plan is running
+    static std::vector<G4int> m_pointEvents;                                  ///< [point] events of the point (photons / photons per event)
+    static std::unique_ptr<std::atomic<G4int>[]> m_finishedEvents;            ///< [point] events that ended
+    static std::vector<std::unique_ptr<std::vector<ScanPointTally>>> m_threadTallies; ///< [thread][point], owned here so the completing thread can sum them
+    G4ThreadLocal static std::vector<ScanPointTally> *m_threadTally;          ///< Tallies of the calling thread
+    G4ThreadLocal static unsigned int m_threadGeneration;
+    static G4Mutex m_mutex;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "OMSimOpBoundaryProcess.hh"
 #include <G4UserTrackingAction.hh>
 
 class OMSimTrackingAction : public G4UserTrackingAction
@@ -9,8 +10,7 @@ class OMSimTrackingAction : public G4UserTrackingAction
 		~OMSimTrackingAction(){};
 	
 		void PreUserTrackingAction(const G4Track*){};
-		void PostUserTrackingAction(const G4Track*){};
+		void PostUserTrackingAction(const G4Track* p_track){ PhotonMaterialTrackingPool::release(p_track); };
 		
 	private:
 };
-
@@ -9,6 +9,7 @@
  */
 
 #include "OMSim.hh"
+#include "OMSimBoundaryStatistics.hh"
 #include "OMSimTools.hh"
 #include "OMSimLogger.hh"
 #include "OMSimActionInitialization.hh"
@@ -35,6 +36,7 @@ void OMSim::setGeneralOptions()
     ("log_level", po::value<std::string>()->default_value("info"), "Granularity of logger, defaults to info [trace, debug, info, warn, error, critical, off]")
     ("output_file,o", po::value<std::string>()->default_value("output"), "filename for output")
     ("numevents,n", po::value<G4int>()->default_value(0), "number of events")
+    ("photons_per_event", po::value<G4int>()->default_value(1), "number of independent photons generated per event by the optical photon beams; numevents and the scan photon numbers stay photon counts and must be multiples of it")
     ("visual,v", po::bool_switch()->default_value(false), "shows visualization of module after run")
     ("save_args", po::bool_switch()->default_value(true), "if true a json file with the args and seed is saved")
     ("seed", po::value<long>(), "seed for random engine. If none is given a seed from CPU time is used")
@@ -43,6 +45,9 @@ void OMSim::setGeneralOptions()
     ("simple_PMT", po::bool_switch(), "if given, simulate simple PMT")
     ("QE_file", po::value<std::string>()->default_value("default"), "file path for custom QE file (file should contain two columns separated by tab, QE should not be in %!)")
     ("efficiency_cut", po::bool_switch(), "if given, the photons will be deleted if they don't pass QE")
+    ("unpolarized_boundary", po::bool_switch(), "if given, optical boundaries use polarisation averaged Fresnel probabilities and skip the polarisation bookkeeping (faster, for unpolarised sources)")
+    ("resume", po::bool_switch(), "if given, scans that keep a journal (<output_file>_<scan>_journal.txt) skip the points completed by a previous, interrupted job and continue with its random engine state")
+    ("boundary_stats", po::bool_switch(), "if given, optical boundary interactions are counted per model, material pair and outcome, with sampled cost, and written to <output_file>_boundary_stats.json")
     ("pmt_response", po::bool_switch(), "if given, simulates PMT response using scan data (currently only for mDOM PMT)")
     ("place_harness",po::bool_switch(),"place OM harness (if implemented)")
 	("detector_type", po::value<G4int>()->default_value(2), "module type [custom = 0, Single PMT = 1, mDOM = 2, DOM = 3, LOM16 = 4, LOM18 = 5, DEGG = 6, pDOM (HQE deepcore) = 7]")
@@ -125,6 +130,7 @@ int OMSim::determineNumberOfThreads()
 void OMSim::initialiseSimulation(OMSimDetectorConstruction* p_detectorConstruction)
 {
     OMSimHitManager::init();
+    OMSimBoundaryStatistics::init();
     
     OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
     Tools::ensureDirectoryExists(args.get<std::string>("output_file"));
@@ -194,23 +200,31 @@ po::variables_map OMSim::parseArguments(int p_argumentCount, char *p_argumentVec
 
 /**
  * @brief Sets variables from a variables map to the instance of OMSimCommandArgsTable
+ * @param p_variablesMap Parsed user arguments.
+ * @param p_deriveArguments If given, called after the user arguments (and the seed) are set and before the table is finalized, to add arguments derived from them. These are saved with the other args.
  */
-void OMSim::setUserArgumentsToArgTable(po::variables_map p_variablesMap)
+void OMSim::setUserArgumentsToArgTable(po::variables_map p_variablesMap, const std::function<void(OMSimCommandArgsTable &)> &p_deriveArguments)
 {
 	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
 	for (const auto &option : p_variablesMap)
 	{
 		args.setParameter(option.first, option.second.value());
 	}
+	if (p_deriveArguments)
+	{
+		args.setDefaultSeed();
+		p_deriveArguments(args);
+	}
 	// Now that all parameters are set, "finalize" the OMSimCommandArgsTable instance so that the parameters cannot be modified anymore
 	args.finalize();
 }
 
 /**
  * @brief Parses the user arguments into variables that can be accessed in the simulation via OMSimCommandArgsTable. 
+ * @param p_deriveArguments Optional function adding arguments derived from the user arguments (see setUserArgumentsToArgTable).
  * @return true if simulation should continue, if --help is called it will return false and stop the program
  */
-bool OMSim::handleArguments(int p_argumentCount, char *p_argumentVector[])
+bool OMSim::handleArguments(int p_argumentCount, char *p_argumentVector[], const std::function<void(OMSimCommandArgsTable &)> &p_deriveArguments)
 {
 	
 	po::variables_map variableMap = parseArguments(p_argumentCount, p_argumentVector);
@@ -223,7 +237,7 @@ bool OMSim::handleArguments(int p_argumentCount, char *p_argumentVector[])
 	}
 
 	//If no help needed continue and set arguments to arg table
-	setUserArgumentsToArgTable(variableMap);
+	setUserArgumentsToArgTable(variableMap, p_deriveArguments);
 
     //now we know the log level, lets configure the logger as intended
     configureLogger();
@@ -253,6 +267,9 @@ OMSim::~OMSim()
     log_trace("Deleting OMSimHitManager");
     OMSimHitManager::shutdown();
 
+    log_trace("Deleting OMSimBoundaryStatistics");
+    OMSimBoundaryStatistics::shutdown();
+
     log_trace("Deleting OMSimCommandArgsTable");
     OMSimCommandArgsTable::shutdown();
 
@@ -0,0 +1,265 @@
+#include "OMSimBoundaryStatistics.hh"
+#include "OMSimCommandArgsTable.hh"
+#include "OMSimLogger.hh"
+
+#include <chrono>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define OMSIM_HAS_RDTSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define OMSIM_HAS_RDTSC 1
+#endif
+
+G4Mutex OMSimBoundaryStatistics::m_mutex = G4Mutex();
+G4ThreadLocal OMSimBoundaryStatistics::ThreadLocalData *OMSimBoundaryStatistics::m_threadData = nullptr;
+
+namespace
+{
+    const char *const g_modelNames[] = {"none", "dielectric_glisur", "dielectric_unified", "dielectric_metal",
+                                        "LUT", "DAVIS", "dichroic", "coated_photocathode"};
+    static_assert(sizeof(g_modelNames) / sizeof(g_modelNames[0]) == OMSimBoundaryStatistics::k_numberOfModels,
+                  "A name is needed for each OpBoundaryModel");
+
+    const char *const g_statusNames[] = {
+        "Undefined", "Transmission", "FresnelRefraction", "FresnelReflection", "TotalInternalReflection",
+        "LambertianReflection", "LobeReflection", "SpikeReflection", "BackScattering", "Absorption", "Detection",
+        "NotAtBoundary", "SameMaterial", "StepTooSmall", "NoRINDEX",
+        "PolishedLumirrorAirReflection", "PolishedLumirrorGlueReflection", "PolishedAirReflection",
+        "PolishedTeflonAirReflection", "PolishedTiOAirReflection", "PolishedTyvekAirReflection",
+        "PolishedVM2000AirReflection", "PolishedVM2000GlueReflection",
+        "EtchedLumirrorAirReflection", "EtchedLumirrorGlueReflection", "EtchedAirReflection",
+        "EtchedTeflonAirReflection", "EtchedTiOAirReflection", "EtchedTyvekAirReflection",
+        "EtchedVM2000AirReflection", "EtchedVM2000GlueReflection",
+        "GroundLumirrorAirReflection", "GroundLumirrorGlueReflection", "GroundAirReflection",
+        "GroundTeflonAirReflection", "GroundTiOAirReflection", "GroundTyvekAirReflection",
+        "GroundVM2000AirReflection", "GroundVM2000GlueReflection",
+        "Dichroic", "CoatedDielectricReflection", "CoatedDielectricRefraction", "CoatedDielectricFrustratedTransmission"};
+    static_assert(sizeof(g_statusNames) / sizeof(g_statusNames[0]) == OMSimBoundaryStatistics::k_numberOfStatuses,
+                  "A name is needed for each G4OpBoundaryProcessStatus");
+
+    /**
+     * @return Time stamp counter (cycles) if available, otherwise a steady clock in nanoseconds. Never 0.
+     */
+    inline std::uint64_t readCostCounter()
+    {
+#ifdef OMSIM_HAS_RDTSC
+        return __rdtsc() | 1;
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now().time_since_epoch())
+                                              .count()) |
+               1;
+#endif
+    }
+
+    constexpr const char *costUnit()
+    {
+#ifdef OMSIM_HAS_RDTSC
+        return "cycles";
+#else
+        return "ns";
+#endif
+    }
+
+    double meanCost(std::uint64_t p_cost, std::uint64_t p_samples)
+    {
+        return p_samples > 0 ? static_cast<double>(p_cost) / p_samples : 0.;
+    }
+}
+
+/**
+ * @brief Initializes the global instance if the statistics were requested with `--boundary_stats`.
+ *
+ * This method is normally called in OMSim::initialiseSimulation.
+ */
+void OMSimBoundaryStatistics::init()
+{
+    OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+    if (g_boundaryStatistics || !args.get<bool>("boundary_stats"))
+        return;
+    g_boundaryStatistics = new OMSimBoundaryStatistics(args.get<std::string>("output_file") + "_boundary_stats.json");
+    log_info("Boundary process statistics enabled, cost sampled every {} calls", k_samplePeriod);
+}
+
+/**
+ * @brief Deletes the global instance of OMSimBoundaryStatistics.
+ *
+ * This method is normally called in the destructor ~OMSim.
+ */
+void OMSimBoundaryStatistics::shutdown()
+{
+    delete g_boundaryStatistics;
+    g_boundaryStatistics = nullptr;
+}
+
+/**
+ * @return A reference to the global OMSimBoundaryStatistics instance.
+ * @throws std::runtime_error if called before init() or after shutdown() (or if the statistics were not requested).
+ */
+OMSimBoundaryStatistics &OMSimBoundaryStatistics::getInstance()
+{
+    if (!g_boundaryStatistics)
+        throw std::runtime_error("OMSimBoundaryStatistics accessed before initialization, after shutdown or without --boundary_stats!");
+    return *g_boundaryStatistics;
+}
+
+/**
+ * @brief Counts a boundary call of this thread and starts the cost measurement if the call is sampled.
+ * @return Start value of the cost counter, 0 if this call is not sampled.
+ */
+std::uint64_t OMSimBoundaryStatistics::startCall()
+{
+    if (!m_threadData)
+        m_threadData = new ThreadLocalData();
+    if (++m_threadData->callCounter % k_samplePeriod != 0)
+        return 0;
+    return readCostCounter();
+}
+
+/**
+ * @brief Records the outcome of a boundary call in the thread local counters.
+ * @param p_costStart Value returned by startCall.
+ * @param p_model Model that handled the interaction.
+ * @param p_status Final status of the boundary process.
+ * @param p_material1 Material of the pre-step point.
+ * @param p_material2 Material of the post-step point.
+ */
+void OMSimBoundaryStatistics::endCall(std::uint64_t p_costStart, OpBoundaryModel p_model, G4OpBoundaryProcessStatus p_status,
+                                      const G4Material *p_material1, const G4Material *p_material2)
+{
+    const std::uint64_t cost = p_costStart != 0 ? readCostCounter() - p_costStart : 0;
+    const std::uint64_t sampled = p_costStart != 0 ? 1 : 0;
+
+    ModelCounters &model = m_threadData->models[static_cast<std::size_t>(p_model)];
+    ++model.calls;
+    model.sampledCalls += sampled;
+    model.sampledCost += cost;
+    ++model.statuses[static_cast<std::size_t>(p_status)];
+
+    // Steps inside a volume say nothing about material pairs
+    if (p_model == OpBoundaryModel::None && (p_status == NotAtBoundary || p_status == StepTooSmall))
+        return;
+
+    CostCounters &pair = m_threadData->materialPairs[PairKey(p_material1, p_material2, p_model)];
+    ++pair.calls;
+    pair.sampledCalls += sampled;
+    pair.sampledCost += cost;
+}
+
+/**
+ * @brief Adds the counters of the calling thread to the global ones and clears them. Thread-safe.
+ */
+void OMSimBoundaryStatistics::mergeThreadData()
+{
+    if (!m_threadData)
+        return;
+    G4AutoLock lock(&m_mutex);
+    for (std::size_t i = 0; i < k_numberOfModels; ++i)
+    {
+        const ModelCounters &local = m_threadData->models[i];
+        ModelCounters &global = m_models[i];
+        global.calls += local.calls;
+        global.sampledCalls += local.sampledCalls;
+        global.sampledCost += local.sampledCost;
+        for (std::size_t j = 0; j < k_numberOfStatuses; ++j)
+            global.statuses[j] += local.statuses[j];
+    }
+    for (const auto &[key, local] : m_threadData->materialPairs)
+    {
+        const G4Material *material1 = std::get<0>(key);
+        const G4Material *material2 = std::get<1>(key);
+        CostCounters &global = m_materialPairs[NamedPairKey(material1 ? material1->GetName() : "none",
+                                                            material2 ? material2->GetName() : "none",
+                                                            std::get<2>(key))];
+        global.calls += local.calls;
+        global.sampledCalls += local.sampledCalls;
+        global.sampledCost += local.sampledCost;
+    }
+    log_debug("Merged boundary statistics of thread {}", G4Threading::G4GetThreadId());
+    delete m_threadData;
+    m_threadData = nullptr;
+}
+
+/**
+ * @brief Called at the end of each run by all threads: workers merge their counters, the master writes the file.
+ *
+ * The master's EndOfRunAction runs after all workers finished, so the file contains all runs so far.
+ */
+void OMSimBoundaryStatistics::endOfRun()
+{
+    mergeThreadData();
+    if (G4Threading::IsMasterThread())
+    {
+        G4AutoLock lock(&m_mutex);
+        ++m_runs;
+        lock.unlock();
+        writeToJson(m_outputFileName);
+    }
+}
+
+/**
+ * @brief Writes the merged statistics to a JSON file.
+ * @param p_fileName Name of the output file.
+ * @throw std::runtime_error If the file fails to open.
+ */
+void OMSimBoundaryStatistics::writeToJson(const std::string &p_fileName)
+{
+    G4AutoLock lock(&m_mutex);
+    std::ofstream outputFile(p_fileName);
+    if (!outputFile.is_open())
+    {
+        throw std::runtime_error("Failed to open file " + p_fileName);
+    }
+
+    outputFile << "{\n";
+    outputFile << "\t\"runs\": " << m_runs << ",\n";
+    outputFile << "\t\"sample_period\": " << k_samplePeriod << ",\n";
+    outputFile << "\t\"cost_unit\": \"" << costUnit() << "\",\n";
+
+    outputFile << "\t\"models\": {";
+    bool first = true;
+    for (std::size_t i = 0; i < k_numberOfModels; ++i)
+    {
+        const ModelCounters &model = m_models[i];
+        if (model.calls == 0)
+            continue;
+        outputFile << (first ? "\n" : ",\n");
+        first = false;
+        outputFile << "\t\t\"" << g_modelNames[i] << "\": {\"calls\": " << model.calls
+                   << ", \"sampled_calls\": " << model.sampledCalls
+                   << ", \"sampled_cost\": " << model.sampledCost
+                   << ", \"mean_cost\": " << meanCost(model.sampledCost, model.sampledCalls)
+                   << ", \"status\": {";
+        bool firstStatus = true;
+        for (std::size_t j = 0; j < k_numberOfStatuses; ++j)
+        {
+            if (model.statuses[j] == 0)
+                continue;
+            outputFile << (firstStatus ? "" : ", ") << "\"" << g_statusNames[j] << "\": " << model.statuses[j];
+            firstStatus = false;
+        }
+        outputFile << "}}";
+    }
+    outputFile << "\n\t},\n";
+
+    outputFile << "\t\"material_pairs\": [";
+    first = true;
+    for (const auto &[key, pair] : m_materialPairs)
+    {
+        outputFile << (first ? "\n" : ",\n");
+        first = false;
+        outputFile << "\t\t{\"material1\": \"" << std::get<0>(key) << "\", \"material2\": \"" << std::get<1>(key)
+                   << "\", \"model\": \"" << g_modelNames[static_cast<std::size_t>(std::get<2>(key))]
+                   << "\", \"calls\": " << pair.calls
+                   << ", \"sampled_calls\": " << pair.sampledCalls
+                   << ", \"sampled_cost\": " << pair.sampledCost
+                   << ", \"mean_cost\": " << meanCost(pair.sampledCost, pair.sampledCalls) << "}";
+    }
+    outputFile << "\n\t]\n";
+    outputFile << "}\n";
+    outputFile.close();
+    log_info("Boundary process statistics written to {}", p_fileName);
+}
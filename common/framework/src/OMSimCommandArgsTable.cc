@@ -81,12 +81,21 @@ void OMSimCommandArgsTable::writeToJson(std::string p_fileName)
         else
         {
             const std::type_info &type = kv.second.type();
+            bool isWritten = false;
 
             WRITE_TO_JSON_IF_TYPE_MATCHES(kv.second, int)
             WRITE_TO_JSON_IF_TYPE_MATCHES(kv.second, double)
             WRITE_TO_JSON_IF_TYPE_MATCHES(kv.second, long)
             WRITE_TO_JSON_IF_TYPE_MATCHES(kv.second, bool)
             WRITE_TO_JSON_IF_TYPE_MATCHES(kv.second, std::string)
+            WRITE_ARRAY_TO_JSON_IF_TYPE_MATCHES(kv.second, double)
+            WRITE_ARRAY_TO_JSON_IF_TYPE_MATCHES(kv.second, std::string)
+
+            if (!isWritten)
+            {
+                log_warning("Argument {} has a type that can't be written to the args file, written as null", kv.first);
+                outputFile << "\t\"" << kv.first << "\": null";
+            }
         }
 
         // Append comma if it's not the last item
@@ -102,17 +111,24 @@ void OMSimCommandArgsTable::writeToJson(std::string p_fileName)
 }
 
 /**
- * @brief Finalizes the table, setting a random seed if none was provided. m_finalized is set to true preventing any further modifications.
+ * @brief Sets a seed from the CPU time if none was provided, so that arguments derived from the seed can be set before finalize.
  */
-void OMSimCommandArgsTable::finalize()
+void OMSimCommandArgsTable::setDefaultSeed()
 {
-    long seed;
     if (!keyExists("seed"))
     {
         struct timeval timeForRandom;
         gettimeofday(&timeForRandom, NULL);
-        seed = timeForRandom.tv_sec + 4294 * timeForRandom.tv_usec;
+        long seed = timeForRandom.tv_sec + 4294 * timeForRandom.tv_usec;
         setParameter("seed", seed);
     }
+}
+
+/**
+ * @brief Finalizes the table, setting a random seed if none was provided. m_finalized is set to true preventing any further modifications.
+ */
+void OMSimCommandArgsTable::finalize()
+{
+    setDefaultSeed();
     m_finalized = true;
 }
\ No newline at end of file
@@ -182,6 +182,31 @@ bool OMSimHitManager::areThereHitsInModuleSingleThread(int p_moduleIndex)
 	return m_threadData->moduleHits.find(p_moduleIndex) != m_threadData->moduleHits.end();
 }
 
+/**
+ * @brief Moves the hits stored by the calling thread out of the manager, leaving it empty for this thread.
+ *
+ * Useful to process the hits event by event (e.g. in EndOfEventAction) without keeping them until the end of the run.
+ * @return Map of the HitStats of the calling thread for each module.
+ */
+std::map<G4int, HitStats> OMSimHitManager::extractSingleThreadHits()
+{
+	if (!m_threadData)
+		return {};
+	std::map<G4int, HitStats> hits = std::move(m_threadData->moduleHits);
+	m_threadData->moduleHits.clear();
+	return hits;
+}
+
+/**
+ * @param p_moduleIndex Module index for which we are getting the information (default 0)
+ * @return Number of PMTs of the module, as set with setNumberOfPMTs (0 if it was not set).
+ */
+G4int OMSimHitManager::getNumberOfPMTs(int p_moduleIndex)
+{
+	auto it = m_numberOfPMTs.find(p_moduleIndex);
+	return it != m_numberOfPMTs.end() ? it->second : 0;
+}
+
 /**
  * @brief Deletes hit information in memory for all modules.
  */
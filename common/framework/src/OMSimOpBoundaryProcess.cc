@@ -74,6 +74,8 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "OMSimOpBoundaryProcess.hh"
+#include "OMSimBoundaryStatistics.hh"
+#include "OMSimCommandArgsTable.hh"
 #include "OMSimLogger.hh"
 
 #include "G4ios.hh"
@@ -89,6 +91,45 @@
 #include "G4VSensitiveDetector.hh"
 #include <tuple>
 
+thread_local std::vector<std::unique_ptr<PhotonMaterialTracking>> PhotonMaterialTrackingPool::m_freeList;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+/**
+ * @return A PhotonMaterialTracking with empty history, reused from the free list of this thread if possible.
+ */
+PhotonMaterialTracking *PhotonMaterialTrackingPool::acquire()
+{
+  if (m_freeList.empty())
+  {
+    return new PhotonMaterialTracking();
+  }
+  PhotonMaterialTracking *info = m_freeList.back().release();
+  m_freeList.pop_back();
+  return info;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+/**
+ * @brief Detaches the PhotonMaterialTracking of a finished track and keeps it for reuse.
+ * @param p_track Track that was just finished (called from PostUserTrackingAction).
+ */
+void PhotonMaterialTrackingPool::release(const G4Track *p_track)
+{
+  PhotonMaterialTracking *info = dynamic_cast<PhotonMaterialTracking *>(p_track->GetUserInformation());
+  if (info == nullptr)
+  {
+    return;
+  }
+  p_track->SetUserInformation(nullptr);
+  if (m_freeList.size() >= k_maxPooled)
+  {
+    delete info;
+    return;
+  }
+  info->reset();
+  m_freeList.emplace_back(info);
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 G4OpBoundaryProcess::G4OpBoundaryProcess(const G4String &processName,
                                          G4ProcessType ptype)
@@ -126,6 +167,7 @@ G4OpBoundaryProcess::G4OpBoundaryProcess(const G4String &processName,
   fDichroicVector = nullptr;
 
   fNumWarnings = 0;
+  fUnpolarized = OMSimCommandArgsTable::getInstance().get<bool>("unpolarized_boundary");
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -148,8 +190,24 @@ void G4OpBoundaryProcess::Initialise()
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 G4VParticleChange *G4OpBoundaryProcess::PostStepDoIt(const G4Track &aTrack,
                                                      const G4Step &aStep)
+{
+  if (!OMSimBoundaryStatistics::isEnabled())
+    return BoundaryDoIt(aTrack, aStep);
+
+  OMSimBoundaryStatistics &statistics = OMSimBoundaryStatistics::getInstance();
+  const std::uint64_t costStart = statistics.startCall();
+  G4VParticleChange *particleChange = BoundaryDoIt(aTrack, aStep);
+  statistics.endCall(costStart, fStatisticsModel, fStatus,
+                     aStep.GetPreStepPoint()->GetMaterial(), aStep.GetPostStepPoint()->GetMaterial());
+  return particleChange;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+G4VParticleChange *G4OpBoundaryProcess::BoundaryDoIt(const G4Track &aTrack,
+                                                     const G4Step &aStep)
 {
   fStatus = Undefined;
+  fStatisticsModel = OpBoundaryModel::None;
   aParticleChange.Initialize(aTrack);
   aParticleChange.ProposeVelocity(aTrack.GetVelocity());
 
@@ -174,29 +232,13 @@ G4VParticleChange *G4OpBoundaryProcess::PostStepDoIt(const G4Track &aTrack,
     }
     // Checks if the photon is at the geometry boundary. If true, it retrieves the materials of the two volumes on either side of the boundary.
     // Little tool to track how often beta is being factored to the Fresnel coefficients
-    G4VUserTrackInformation *lUserInformation = aTrack.GetUserInformation();
-    if (lUserInformation != nullptr)
-    {
-      PhotonMaterialTracking *myInfo = dynamic_cast<PhotonMaterialTracking *>(lUserInformation);
-      if (myInfo)
-      {
-        // If myInfo exists, just add the new volume
-        myInfo->addVolume(fMaterial1->GetMaterialPropertiesTable());
-      }
-      else
-      {
-        // If myInfo doesn't exist, create a new one and add the volume
-        myInfo = new PhotonMaterialTracking();
-        myInfo->addVolume(fMaterial1->GetMaterialPropertiesTable());
-        aTrack.SetUserInformation(myInfo);
-      }
-    }
-    else
+    PhotonMaterialTracking *myInfo = dynamic_cast<PhotonMaterialTracking *>(aTrack.GetUserInformation());
+    if (myInfo == nullptr)
     {
-      PhotonMaterialTracking *myInfo = new PhotonMaterialTracking();
-      myInfo->addVolume(fMaterial1->GetMaterialPropertiesTable());
+      myInfo = PhotonMaterialTrackingPool::acquire();
       aTrack.SetUserInformation(myInfo);
     }
+    myInfo->addVolume(fMaterial1->GetMaterialPropertiesTable());
   }
   else
   {
@@ -461,6 +503,8 @@ G4VParticleChange *G4OpBoundaryProcess::PostStepDoIt(const G4Track &aTrack,
     }
   } // end of if(fOpticalSurface)
 
+  fStatisticsModel = StatisticsModel(type);
+
   //  DIELECTRIC-DIELECTRIC
 
   if (type == dielectric_dielectric)
@@ -595,6 +639,31 @@ G4VParticleChange *G4OpBoundaryProcess::PostStepDoIt(const G4Track &aTrack,
   return G4VDiscreteProcess::PostStepDoIt(aTrack, aStep);
 }
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+/**
+ * @return Model category of the current interaction for OMSimBoundaryStatistics.
+ */
+OpBoundaryModel G4OpBoundaryProcess::StatisticsModel(G4SurfaceType p_type) const
+{
+  switch (p_type)
+  {
+  case dielectric_dielectric:
+    return fModel == unified ? OpBoundaryModel::DielectricUnified : OpBoundaryModel::DielectricGlisur;
+  case dielectric_metal:
+    return OpBoundaryModel::DielectricMetal;
+  case dielectric_LUT:
+    return OpBoundaryModel::LUT;
+  case dielectric_LUTDAVIS:
+    return OpBoundaryModel::DAVIS;
+  case dielectric_dichroic:
+    return OpBoundaryModel::Dichroic;
+  case coated:
+    return OpBoundaryModel::CoatedPhotocathode;
+  default:
+    return OpBoundaryModel::None;
+  }
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 void G4OpBoundaryProcess::BoundaryProcessVerbose() const // Outputs verbose information about the current status of the boundary process
 {
@@ -1146,7 +1215,7 @@ leap:
 
   G4ThreeVector A_trans, A_paral, E1pp, E1pl;
   G4double E1_perp, E1_parl;
-  G4double s1, s2, E2_perp, E2_parl, E2_total, transCoeff;
+  G4double E2_perp, E2_parl, E2_total, transCoeff;
   G4double E2_abs, C_parl, C_perp;
   G4double alpha;
 
@@ -1223,35 +1292,44 @@ leap:
         cost2 = -std::sqrt(1. - sint2 * sint2);
       }
 
-      if (sint1 > 0.0)
+      if (fUnpolarized)
       {
-        A_trans = (fOldMomentum.cross(fFacetNormal)).unit();
-        E1_perp = fOldPolarization * A_trans;
-        E1pp = E1_perp * A_trans;
-        E1pl = fOldPolarization - E1pp;
-        E1_parl = E1pl.mag();
+        // Polarisation averaged probability, the field amplitudes are not needed
+        E1_perp = E1_parl = E2_perp = E2_parl = E2_total = 0.0;
+        if (fTransmittance > 0.)
+          transCoeff = fTransmittance;
+        else
+          transCoeff = FresnelKernels::unpolarizedTransmission(fRindex1, fRindex2, cost1, cost2);
       }
       else
       {
-        A_trans = fOldPolarization;
-        // Here we Follow Jackson's conventions and set the parallel
-        // component = 1 in case of a ray perpendicular to the surface
-        E1_perp = 0.0;
-        E1_parl = 1.0;
-      }
+        if (sint1 > 0.0)
+        {
+          A_trans = (fOldMomentum.cross(fFacetNormal)).unit();
+          E1_perp = fOldPolarization * A_trans;
+          E1pp = E1_perp * A_trans;
+          E1pl = fOldPolarization - E1pp;
+          E1_parl = E1pl.mag();
+        }
+        else
+        {
+          A_trans = fOldPolarization;
+          // Here we Follow Jackson's conventions and set the parallel
+          // component = 1 in case of a ray perpendicular to the surface
+          E1_perp = 0.0;
+          E1_parl = 1.0;
+        }
 
-      s1 = fRindex1 * cost1;
-      E2_perp = 2. * s1 * E1_perp / (fRindex1 * cost1 + fRindex2 * cost2);
-      E2_parl = 2. * s1 * E1_parl / (fRindex2 * cost1 + fRindex1 * cost2);
-      E2_total = E2_perp * E2_perp + E2_parl * E2_parl;
-      s2 = fRindex2 * cost2 * E2_total;
+        const DielectricAmplitudes amplitudes = FresnelKernels::dielectricAmplitudes(fRindex1, fRindex2, cost1, cost2, E1_perp, E1_parl);
+        E2_perp = amplitudes.E2Perp;
+        E2_parl = amplitudes.E2Parl;
+        E2_total = amplitudes.E2Total;
 
-      if (fTransmittance > 0.)
-        transCoeff = fTransmittance; // Determines whether the photon reflects or transmits based on a transmission coefficient
-      else if (cost1 != 0.0)
-        transCoeff = s2 / s1;
-      else
-        transCoeff = 0.0;
+        if (fTransmittance > 0.)
+          transCoeff = fTransmittance; // Determines whether the photon reflects or transmits based on a transmission coefficient
+        else
+          transCoeff = amplitudes.transCoeff;
+      }
 
       // NOT TIR: REFLECTION
       if (!G4BooleanRand(transCoeff))
@@ -1276,7 +1354,12 @@ leap:
         {
           fNewMomentum =
               fOldMomentum - 2. * fOldMomentum * fFacetNormal * fFacetNormal;
-          if (sint1 > 0.0)
+          if (fUnpolarized)
+          { // mirror image of the old polarisation, stays transverse
+            fNewPolarization = -fOldPolarization + (2. * fOldPolarization *
+                                                    fFacetNormal * fFacetNormal);
+          }
+          else if (sint1 > 0.0)
           { // incident ray oblique
             E2_parl = fRindex2 * E2_parl / fRindex1 - E1_parl;
             E2_perp = E2_perp - E1_perp;
@@ -1312,12 +1395,19 @@ leap:
         { // incident ray oblique
           alpha = cost1 - cost2 * (fRindex2 / fRindex1);
           fNewMomentum = (fOldMomentum + alpha * fFacetNormal).unit();
-          A_paral = (fNewMomentum.cross(A_trans)).unit();
-          E2_abs = std::sqrt(E2_total);
-          C_parl = E2_parl / E2_abs;
-          C_perp = E2_perp / E2_abs;
+          if (fUnpolarized)
+          {
+            fNewPolarization = TransversePolarization(fOldPolarization, fNewMomentum);
+          }
+          else
+          {
+            A_paral = (fNewMomentum.cross(A_trans)).unit();
+            E2_abs = std::sqrt(E2_total);
+            C_parl = E2_parl / E2_abs;
+            C_perp = E2_perp / E2_abs;
 
-          fNewPolarization = C_parl * A_paral + C_perp * A_trans;
+            fNewPolarization = C_parl * A_paral + C_perp * A_trans;
+          }
         }
         else
         { // incident ray perpendicular
@@ -1588,7 +1678,7 @@ void G4OpBoundaryProcess::PhotocathodeCoatedComplex(const G4Track *pTrack)
   const G4complex lI(0, 1);
 
   // Initialize variables outside the loop
-  G4double lSintTL, lPdotN, lE1Perp, lE1Parl, lS1, lE2Perp, lE2Parl, lE2Total;
+  G4double lSintTL, lPdotN, lE1Perp, lE1Parl, lE2Perp, lE2Parl, lE2Total;
   G4double lE2Abs, lCParl, lCPerp, lAlpha;
   G4ThreeVector lATrans, lAParal, lE1pp, lE1pl;
   G4bool lThrough = false;
@@ -1700,27 +1790,31 @@ void G4OpBoundaryProcess::PhotocathodeCoatedComplex(const G4Track *pTrack)
       lSintTL = 0.0;
     }
 
-    if (lSint1 > 0.0)
-    {
-      lATrans = fOldMomentum.cross(fFacetNormal).unit();
-      lE1Perp = fOldPolarization * lATrans;
-      lE1pp = lE1Perp * lATrans;
-      lE1pl = fOldPolarization - lE1pp;
-      lE1Parl = lE1pl.mag();
-    }
-    else
-    {
-      lATrans = fOldPolarization;
-      lE1Perp = 0.0;
-      lE1Parl = 1.0;
-    }
-
-    lS1 = fRindex1 * lCost1;
     G4double lCost2 = lCost1 > 0.0 ? std::sqrt(1. - lSint2 * lSint2) : -std::sqrt(1. - lSint2 * lSint2);
 
-    lE2Perp = 2. * lS1 * lE1Perp / (fRindex1 * lCost1 + fRindex2 * lCost2);
-    lE2Parl = 2. * lS1 * lE1Parl / (fRindex2 * lCost1 + fRindex1 * lCost2);
-    lE2Total = lE2Perp * lE2Perp + lE2Parl * lE2Parl;
+    // The layer probabilities are polarisation averaged already, the amplitudes only serve the outgoing polarisation
+    if (!fUnpolarized)
+    {
+      if (lSint1 > 0.0)
+      {
+        lATrans = fOldMomentum.cross(fFacetNormal).unit();
+        lE1Perp = fOldPolarization * lATrans;
+        lE1pp = lE1Perp * lATrans;
+        lE1pl = fOldPolarization - lE1pp;
+        lE1Parl = lE1pl.mag();
+      }
+      else
+      {
+        lATrans = fOldPolarization;
+        lE1Perp = 0.0;
+        lE1Parl = 1.0;
+      }
+
+      const DielectricAmplitudes lAmplitudes = FresnelKernels::dielectricAmplitudes(fRindex1, fRindex2, lCost1, lCost2, lE1Perp, lE1Parl);
+      lE2Perp = lAmplitudes.E2Perp;
+      lE2Parl = lAmplitudes.E2Parl;
+      lE2Total = lAmplitudes.E2Total;
+    }
 
     G4double lCostTL = lCost1 > 0.0 ? std::sqrt(1. - lSintTL * lSintTL) : -std::sqrt(1. - lSintTL * lSintTL);
 
@@ -1736,12 +1830,13 @@ void G4OpBoundaryProcess::PhotocathodeCoatedComplex(const G4Track *pTrack)
       lCost1Complex = std::sqrt(G4complex(1.0, 0.0) - lSint1 * lSint1);
     }
 
-    FresnelCoefficients lCoefficients1TL = CalculateFresnelCoefficientsComplex(lComplexRindex1, lComplexCoatedRindex, lCost1Complex, lCostTLComplex);
-    FresnelCoefficients lCoefficientsTL2 = CalculateFresnelCoefficientsComplex(lComplexCoatedRindex, lComplexRindex2, lCostTLComplex, lCost2Complex);
+    FresnelCoefficients lCoefficients1TL = FresnelKernels::fresnelCoefficients(lComplexRindex1, lComplexCoatedRindex, lCost1Complex, lCostTLComplex);
+    FresnelCoefficients lCoefficientsTL2 = FresnelKernels::fresnelCoefficients(lComplexCoatedRindex, lComplexRindex2, lCostTLComplex, lCost2Complex);
     G4complex lBeta = lK0 * lComplexCoatedRindex * lCoatedThickness * lCostTLComplex;
 
-    FresnelCoefficients lCoefficients1TL2 = ThreeLayerSystem(lCoefficients1TL, lCoefficientsTL2, lBeta);
-    OpticalLayerResult lResults = Fresnel2ProbabilityComplex(lCoefficients1TL2, fRindex1, fRindex2, limagRIndex1, limagRIndex2, lCost1Complex, lCost2Complex);
+    FresnelCoefficients lCoefficients1TL2 = FresnelKernels::threeLayerSystem(lCoefficients1TL, lCoefficientsTL2, lBeta);
+    OpticalLayerResult lResults = FresnelKernels::fresnelToProbability(lCoefficients1TL2, G4complex(fRindex1, limagRIndex1), G4complex(fRindex2, limagRIndex2),
+                                                                       lCost1Complex, lCost2Complex);
     G4OpBoundaryProcessStatus lStatus = getStatus(lResults);
 
     if (lStatus == FresnelReflection)
@@ -1750,7 +1845,11 @@ void G4OpBoundaryProcess::PhotocathodeCoatedComplex(const G4Track *pTrack)
 
       fNewMomentum = fOldMomentum - (2. * lPdotN) * fFacetNormal;
 
-      if (lSint1 > 0.0)
+      if (fUnpolarized)
+      {
+        fNewPolarization = -fOldPolarization + (2. * fOldPolarization * fFacetNormal) * fFacetNormal;
+      }
+      else if (lSint1 > 0.0)
       {
         lE2Parl = fRindex2 * lE2Parl / fRindex1 - lE1Parl;
         lE2Perp = lE2Perp - lE1Perp;
@@ -1776,11 +1875,18 @@ void G4OpBoundaryProcess::PhotocathodeCoatedComplex(const G4Track *pTrack)
       {
         lAlpha = lCost1 - lCost2 * (fRindex2 / fRindex1);
         fNewMomentum = (fOldMomentum + lAlpha * fFacetNormal).unit();
-        lAParal = fNewMomentum.cross(lATrans).unit();
-        lE2Abs = std::sqrt(lE2Total);
-        lCParl = lE2Parl / lE2Abs;
-        lCPerp = lE2Perp / lE2Abs;
-        fNewPolarization = lCParl * lAParal + lCPerp * lATrans;
+        if (fUnpolarized)
+        {
+          fNewPolarization = TransversePolarization(fOldPolarization, fNewMomentum);
+        }
+        else
+        {
+          lAParal = fNewMomentum.cross(lATrans).unit();
+          lE2Abs = std::sqrt(lE2Total);
+          lCParl = lE2Parl / lE2Abs;
+          lCPerp = lE2Perp / lE2Abs;
+          fNewPolarization = lCParl * lAParal + lCPerp * lATrans;
+        }
       }
       else
       {
@@ -1809,22 +1915,22 @@ void G4OpBoundaryProcess::PhotocathodeCoatedComplex(const G4Track *pTrack)
   } while (!lDone);
 }
 
-FresnelCoefficients G4OpBoundaryProcess::ThreeLayerSystem(FresnelCoefficients pCoefficientsL1, FresnelCoefficients pCoefficientsL2, G4complex pFactor)
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+/**
+ * @brief Keeps the polarisation vector valid (perpendicular to the momentum) without computing the Fresnel amplitudes.
+ * @param p_polarization Polarisation before the interaction.
+ * @param p_momentum New (unit) momentum direction.
+ * @return Transverse, not normalised polarisation vector.
+ */
+G4ThreeVector G4OpBoundaryProcess::TransversePolarization(const G4ThreeVector &p_polarization, const G4ThreeVector &p_momentum) const
 {
-  static const G4complex i(0, 1);
-  const G4complex lExp2 = std::exp(2.0 * i * pFactor);
-  const G4complex lExp = std::sqrt(lExp2);
-
-  FresnelCoefficients lResult;
-  lResult.rTE = (pCoefficientsL1.rTE + pCoefficientsL2.rTE * lExp2) / (1.0 + pCoefficientsL1.rTE * pCoefficientsL2.rTE * lExp2);
-  lResult.rTM = (pCoefficientsL1.rTM + pCoefficientsL2.rTM * lExp2) / (1.0 + pCoefficientsL1.rTM * pCoefficientsL2.rTM * lExp2);
-
-  lResult.tTE = (pCoefficientsL1.tTE * pCoefficientsL2.tTE * lExp) / (1.0 + pCoefficientsL1.rTE * pCoefficientsL2.rTE * lExp2);
-  lResult.tTM = (pCoefficientsL1.tTM * pCoefficientsL2.tTM * lExp) / (1.0 + pCoefficientsL1.rTM * pCoefficientsL2.rTM * lExp2);
-
-  return lResult;
+  G4ThreeVector lTransverse = p_polarization - (p_polarization * p_momentum) * p_momentum;
+  if (lTransverse.mag2() < fCarTolerance)
+    lTransverse = p_momentum.orthogonal();
+  return lTransverse;
 }
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 G4OpBoundaryProcessStatus G4OpBoundaryProcess::getStatus(OpticalLayerResult pResults)
 {
   G4double lRandom = G4UniformRand();
@@ -1834,53 +1940,3 @@ G4OpBoundaryProcessStatus G4OpBoundaryProcess::getStatus(OpticalLayerResult pRes
     return FresnelReflection;
   return Absorption;
 }
-
-FresnelCoefficients G4OpBoundaryProcess::CalculateFresnelCoefficientsComplex(G4complex pComplexRindex1,
-                                                                             G4complex pComplexRindex2,
-                                                                             G4complex pCost1,
-                                                                             G4complex pCost2)
-{
-
-  FresnelCoefficients lResult;
-  G4complex n1Cost1 = pComplexRindex1 * pCost1;
-  G4complex n2Cost2 = pComplexRindex2 * pCost2;
-  G4complex n1Cost2 = pComplexRindex1 * pCost2;
-  G4complex n2Cost1 = pComplexRindex2 * pCost1;
-
-  G4complex denomTE = n1Cost1 + n2Cost2;
-  G4complex denomTM = n1Cost2 + n2Cost1;
-
-  lResult.rTE = (n1Cost1 - n2Cost2) / denomTE;
-  lResult.tTE = 2.0 * n1Cost1 / denomTE;
-  lResult.rTM = (n2Cost1 - n1Cost2) / denomTM;
-  lResult.tTM = 2.0 * n1Cost1 / denomTM;
-
-  return lResult;
-}
-
-OpticalLayerResult G4OpBoundaryProcess::Fresnel2ProbabilityComplex(FresnelCoefficients pCoefficients,
-                                                                   G4double pRindex1,
-                                                                   G4double pRindex2,
-                                                                   G4double pImagRIndex1,
-                                                                   G4double pImagRIndex2,
-                                                                   G4complex pCost1,
-                                                                   G4complex pCost2)
-{
-
-  OpticalLayerResult lResult;
-  G4complex lComplexRindex1(pRindex1, pImagRIndex1);
-  G4complex lComplexRindex2(pRindex2, pImagRIndex2);
-
-  G4double lReflTE = std::norm(pCoefficients.rTE);
-  G4double lReflTM = std::norm(pCoefficients.rTM);
-
-  G4double prefactor = std::real((lComplexRindex2 * pCost2) / (lComplexRindex1 * pCost1));
-  G4double lTransTE = prefactor * std::norm(pCoefficients.tTE);
-  G4double lTransTM = prefactor * std::norm(pCoefficients.tTM);
-
-  // real probabilities:
-  lResult.Reflectivity = (lReflTE + lReflTM) * 0.5;
-  lResult.Transmittance = (lTransTE + lTransTM) * 0.5;
-  lResult.Absorption = 1.0 - lResult.Reflectivity - lResult.Transmittance;
-  return lResult;
-}
\ No newline at end of file
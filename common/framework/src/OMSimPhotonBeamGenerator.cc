@@ -0,0 +1,488 @@
+#include "OMSimPhotonBeamGenerator.hh"
+#include "OMSimCommandArgsTable.hh"
+#include "OMSimLogger.hh"
+#include "OMSimScanQueue.hh"
+
+#include <G4Event.hh>
+#include <G4OpticalPhoton.hh>
+#include <G4PrimaryParticle.hh>
+#include <G4PrimaryVertex.hh>
+#include <Randomize.hh>
+
+#include <algorithm>
+#include <cfloat>
+
+BeamConfiguration OMSimPhotonBeamGenerator::m_globalConfiguration;
+std::atomic<unsigned int> OMSimPhotonBeamGenerator::m_globalVersion{1};
+std::atomic<G4long> OMSimPhotonBeamGenerator::m_culledPhotons{0};
+std::atomic<G4int> OMSimPhotonBeamGenerator::m_photonsPerEventOverride{0};
+G4Mutex OMSimPhotonBeamGenerator::m_mutex = G4Mutex();
+
+OMSimPhotonBeamGenerator::OMSimPhotonBeamGenerator() : m_photonsPerEvent(getPhotonsPerEvent())
+{
+    updateConfiguration();
+}
+
+/**
+ * @return Number of photons generated per event (setPhotonsPerEvent, else --photons_per_event, 1 if not given).
+ */
+G4int OMSimPhotonBeamGenerator::getPhotonsPerEvent()
+{
+    G4int photonsPerEventOverride = m_photonsPerEventOverride.load();
+    if (photonsPerEventOverride > 0)
+        return photonsPerEventOverride;
+    OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+    G4int photonsPerEvent = args.keyExists("photons_per_event") ? args.get<G4int>("photons_per_event") : 1;
+    if (photonsPerEvent < 1)
+        throw std::invalid_argument("photons_per_event must be at least 1!");
+    return photonsPerEvent;
+}
+
+/**
+ * @brief Changes the photons per event of the generators of all threads from their next event on (call between runs).
+ *
+ * Used to compare the throughput of several values in one job (see the photons_per_event_scan option of the effective area study).
+ * @param p_photonsPerEvent Photons per event, 0 to go back to --photons_per_event.
+ * @throw std::invalid_argument If p_photonsPerEvent is negative.
+ */
+void OMSimPhotonBeamGenerator::setPhotonsPerEvent(G4int p_photonsPerEvent)
+{
+    if (p_photonsPerEvent < 0)
+        throw std::invalid_argument("photons_per_event must be at least 1!");
+    G4AutoLock lock(&m_mutex);
+    m_photonsPerEventOverride.store(p_photonsPerEvent);
+    ++m_globalVersion;
+}
+
+/**
+ * @param p_photons Number of photons to simulate, numevents if negative.
+ * @return Number of events needed for p_photons photons.
+ * @throw std::invalid_argument If p_photons is not a multiple of the photons per event (the normalisation would be wrong).
+ */
+G4int OMSimPhotonBeamGenerator::getNumberOfEvents(G4long p_photons)
+{
+    G4long photons = p_photons >= 0 ? p_photons : OMSimCommandArgsTable::getInstance().get<G4int>("numevents");
+    G4int photonsPerEvent = getPhotonsPerEvent();
+    if (photons % photonsPerEvent != 0)
+        throw std::invalid_argument("Number of photons (" + std::to_string(photons) + ") is not a multiple of photons_per_event (" + std::to_string(photonsPerEvent) + ")!");
+    return static_cast<G4int>(photons / photonsPerEvent);
+}
+
+/**
+ * @brief Tests if the straight line of a photon misses the sphere or the cylinder of a cull volume.
+ * @param p_volume Cull volume, should be enabled.
+ * @param p_position Start position of the photon.
+ * @param p_direction Unit momentum direction of the photon.
+ * @return True if the photon can not enter one of the two volumes (photons starting inside are never culled).
+ */
+bool OMSimPhotonBeamGenerator::missesCullVolume(const BeamCullVolume &p_volume, const G4ThreeVector &p_position, const G4ThreeVector &p_direction)
+{
+    G4ThreeVector offset = p_position - p_volume.centre;
+
+    if (p_volume.sphereRadius > 0)
+    {
+        G4double projection = offset.dot(p_direction);
+        G4double outside = offset.mag2() - p_volume.sphereRadius * p_volume.sphereRadius;
+        if (outside > 0 && (projection >= 0 || projection * projection < outside))
+            return true;
+    }
+
+    if (p_volume.cylinderRadius > 0)
+    {
+        // Interval of the path length t >= 0 inside the infinite cylinder, then cut with the slab |z| <= half height
+        G4double tMin = 0;
+        G4double tMax = DBL_MAX;
+        G4double a = p_direction.perp2();
+        G4double b = offset.x() * p_direction.x() + offset.y() * p_direction.y();
+        G4double c = offset.perp2() - p_volume.cylinderRadius * p_volume.cylinderRadius;
+        if (a > 0)
+        {
+            G4double discriminant = b * b - a * c;
+            if (discriminant < 0)
+                return true;
+            G4double root = std::sqrt(discriminant);
+            tMin = std::max(tMin, (-b - root) / a);
+            tMax = std::min(tMax, (-b + root) / a);
+        }
+        else if (c > 0)
+        {
+            return true;
+        }
+
+        G4double halfHeight = p_volume.cylinderHalfHeight;
+        if (p_direction.z() != 0)
+        {
+            G4double t1 = (-halfHeight - offset.z()) / p_direction.z();
+            G4double t2 = (halfHeight - offset.z()) / p_direction.z();
+            tMin = std::max(tMin, std::min(t1, t2));
+            tMax = std::min(tMax, std::max(t1, t2));
+        }
+        else if (std::abs(offset.z()) > halfHeight)
+        {
+            return true;
+        }
+        if (tMin > tMax)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Sets the beam used by the generators of all threads from their next event on.
+ *
+ * Call between runs (the workers copy the configuration when they start their next event).
+ * @param p_configuration New configuration.
+ * @throw std::invalid_argument If the configuration is inconsistent.
+ */
+void OMSimPhotonBeamGenerator::setConfiguration(const BeamConfiguration &p_configuration)
+{
+    if (p_configuration.rot1.cross(p_configuration.rot2).mag2() == 0)
+        throw std::invalid_argument("Beam axes rot1 and rot2 must not be parallel!");
+    if (p_configuration.angular == BeamAngularDistribution::ThetaProfile &&
+        (p_configuration.thetaProfileX.size() < 2 || p_configuration.thetaProfileX.size() != p_configuration.thetaProfileY.size()))
+        throw std::invalid_argument("Beam theta profile needs at least two points and one weight per point!");
+    if (!p_configuration.wavelengthSpectrumX.empty() &&
+        (p_configuration.wavelengthSpectrumX.size() < 2 || p_configuration.wavelengthSpectrumX.size() != p_configuration.wavelengthSpectrumY.size()))
+        throw std::invalid_argument("Beam wavelength spectrum needs at least two points and one density per point!");
+    if (p_configuration.footprintRings < 0 || p_configuration.footprintSectors < 0 ||
+        (p_configuration.footprintRings > 0 && (p_configuration.shape != BeamShape::Disc || p_configuration.footprintSectors == 0)))
+        throw std::invalid_argument("Beam footprint cells need a disc beam and at least one sector per ring!");
+    if (!p_configuration.footprintProbabilities.empty() &&
+        (p_configuration.footprintProbabilities.size() != static_cast<std::size_t>(p_configuration.footprintRings * p_configuration.footprintSectors) ||
+         *std::min_element(p_configuration.footprintProbabilities.begin(), p_configuration.footprintProbabilities.end()) <= 0))
+        throw std::invalid_argument("Beam footprint needs one positive probability per cell!");
+
+    G4AutoLock lock(&m_mutex);
+    m_globalConfiguration = p_configuration;
+    ++m_globalVersion;
+    log_trace("New beam configuration (version {})", m_globalVersion.load());
+}
+
+/**
+ * @return Copy of the configuration set with setConfiguration.
+ */
+BeamConfiguration OMSimPhotonBeamGenerator::getConfiguration()
+{
+    G4AutoLock lock(&m_mutex);
+    return m_globalConfiguration;
+}
+
+/**
+ * @brief Moves the beam of this generator (thread) until the global configuration changes.
+ * @param p_centre Centre of the source.
+ * @param p_rot1 First axis of the source plane.
+ * @param p_rot2 Second axis of the source plane.
+ */
+void OMSimPhotonBeamGenerator::setBeamGeometry(const G4ThreeVector &p_centre, const G4ThreeVector &p_rot1, const G4ThreeVector &p_rot2)
+{
+    updateConfiguration();
+    m_configuration.centre = p_centre;
+    m_configuration.rot1 = p_rot1;
+    m_configuration.rot2 = p_rot2;
+    calculateFrame();
+}
+
+/**
+ * @brief Changes the footprint probabilities of this generator (thread) until the global configuration changes.
+ *
+ * Used to give each direction of a multi-direction run its own footprint; does nothing if the probabilities are unchanged.
+ * @param p_probabilities Probability of each footprint cell, empty for equal probabilities.
+ */
+void OMSimPhotonBeamGenerator::setFootprintProbabilities(const std::vector<G4double> &p_probabilities)
+{
+    updateConfiguration();
+    if (p_probabilities == m_configuration.footprintProbabilities)
+        return;
+    m_configuration.footprintProbabilities = p_probabilities;
+    calculateFootprint();
+}
+
+/**
+ * @brief Copies the global configuration if it changed since the last copy. Only locks if it did.
+ */
+void OMSimPhotonBeamGenerator::updateConfiguration()
+{
+    if (m_version == m_globalVersion.load(std::memory_order_acquire))
+        return;
+    G4AutoLock lock(&m_mutex);
+    m_configuration = m_globalConfiguration;
+    m_version = m_globalVersion.load();
+    lock.unlock();
+    m_photonsPerEvent = getPhotonsPerEvent();
+    m_scanPoint = -1;
+    calculateFrame();
+    calculateThetaProfile();
+    calculateSpectrum();
+    calculateFootprint();
+}
+
+/**
+ * @brief Switches to the beam of a point of the running OMSimScanQueue plan, if it is not the current one.
+ * @param p_point Index of the scan point.
+ */
+void OMSimPhotonBeamGenerator::applyScanPoint(G4int p_point)
+{
+    if (p_point == m_scanPoint)
+        return;
+    m_configuration = OMSimScanQueue::getBeam(p_point);
+    m_scanPoint = p_point;
+    calculateFrame();
+    calculateThetaProfile();
+    calculateSpectrum();
+    calculateFootprint();
+}
+
+/**
+ * @brief Orthonormalises the source axes as the GPS does: axis3 = rot1 x rot2, axis2 = axis3 x axis1.
+ */
+void OMSimPhotonBeamGenerator::calculateFrame()
+{
+    m_axis1 = m_configuration.rot1.unit();
+    m_axis3 = m_configuration.rot1.cross(m_configuration.rot2).unit();
+    m_axis2 = m_axis3.cross(m_axis1).unit();
+}
+
+/**
+ * @brief Builds the cumulative distribution of the theta profile, summing the weights as the GPS does for /gps/hist/point.
+ */
+void OMSimPhotonBeamGenerator::calculateThetaProfile()
+{
+    m_profileCDF.clear();
+    m_profileMaxCDF = 1;
+    if (m_configuration.angular != BeamAngularDistribution::ThetaProfile)
+        return;
+
+    G4double sum = 0;
+    for (const auto &weight : m_configuration.thetaProfileY)
+    {
+        sum += weight;
+        m_profileCDF.push_back(sum);
+    }
+    for (auto &value : m_profileCDF)
+        value /= sum;
+
+    const std::vector<G4double> &x = m_configuration.thetaProfileX;
+    if (m_configuration.maxTheta < x.back())
+    {
+        auto upper = std::upper_bound(x.begin(), x.end(), m_configuration.maxTheta);
+        std::size_t i = std::max<std::size_t>(upper - x.begin(), 1);
+        G4double fraction = (m_configuration.maxTheta - x[i - 1]) / (x[i] - x[i - 1]);
+        m_profileMaxCDF = m_profileCDF[i - 1] + std::clamp(fraction, 0., 1.) * (m_profileCDF[i] - m_profileCDF[i - 1]);
+    }
+}
+
+/**
+ * @brief Integrates the piecewise linear wavelength spectrum (trapezoids) into a normalised cumulative distribution.
+ */
+void OMSimPhotonBeamGenerator::calculateSpectrum()
+{
+    m_spectrumCDF.clear();
+    const std::vector<G4double> &x = m_configuration.wavelengthSpectrumX;
+    const std::vector<G4double> &y = m_configuration.wavelengthSpectrumY;
+    if (x.empty())
+        return;
+
+    m_spectrumCDF.push_back(0);
+    for (std::size_t i = 1; i < x.size(); i++)
+        m_spectrumCDF.push_back(m_spectrumCDF.back() + 0.5 * (y[i] + y[i - 1]) * (x[i] - x[i - 1]));
+    if (m_spectrumCDF.back() <= 0)
+        throw std::invalid_argument("Beam wavelength spectrum has no positive area!");
+    for (auto &value : m_spectrumCDF)
+        value /= m_spectrumCDF.back();
+}
+
+/**
+ * @brief Builds the normalised cumulative distribution of the footprint probabilities.
+ */
+void OMSimPhotonBeamGenerator::calculateFootprint()
+{
+    m_footprintCDF.clear();
+    G4double sum = 0;
+    for (const auto &probability : m_configuration.footprintProbabilities)
+    {
+        sum += probability;
+        m_footprintCDF.push_back(sum);
+    }
+    for (auto &value : m_footprintCDF)
+        value /= sum;
+}
+
+/**
+ * @brief Draws the footprint cell of the event and its importance weight (1 / number of cells) / probability.
+ */
+void OMSimPhotonBeamGenerator::sampleFootprintCell()
+{
+    m_eventCell = -1;
+    m_eventWeight = 1;
+    G4int numberOfCells = m_configuration.footprintRings * m_configuration.footprintSectors;
+    if (numberOfCells == 0)
+        return;
+
+    if (m_footprintCDF.empty())
+    {
+        m_eventCell = std::min(static_cast<G4int>(G4UniformRand() * numberOfCells), numberOfCells - 1);
+        return;
+    }
+    G4double random = G4UniformRand();
+    m_eventCell = std::min(static_cast<G4int>(std::upper_bound(m_footprintCDF.begin(), m_footprintCDF.end(), random) - m_footprintCDF.begin()), numberOfCells - 1);
+    G4double probability = m_footprintCDF[m_eventCell] - (m_eventCell > 0 ? m_footprintCDF[m_eventCell - 1] : 0);
+    m_eventWeight = 1. / (numberOfCells * probability);
+}
+
+/**
+ * @brief Photon energy: fixed, from the wavelength list, or sampled exactly from the piecewise linear spectrum.
+ */
+G4double OMSimPhotonBeamGenerator::sampleEnergy()
+{
+    G4double wavelength;
+    if (!m_spectrumCDF.empty())
+    {
+        const std::vector<G4double> &x = m_configuration.wavelengthSpectrumX;
+        const std::vector<G4double> &y = m_configuration.wavelengthSpectrumY;
+        G4double random = G4UniformRand();
+        std::size_t i = std::upper_bound(m_spectrumCDF.begin(), m_spectrumCDF.end(), random) - m_spectrumCDF.begin();
+        i = std::clamp<std::size_t>(i, 1, x.size() - 1);
+
+        // Solve y0*d + slope/2*d^2 = area for the distance d from x[i-1], with the density linear in the segment
+        G4double width = x[i] - x[i - 1];
+        G4double segmentArea = m_spectrumCDF[i] - m_spectrumCDF[i - 1];
+        G4double fraction = segmentArea > 0 ? (random - m_spectrumCDF[i - 1]) / segmentArea : 0;
+        G4double area = fraction * 0.5 * (y[i] + y[i - 1]) * width;
+        G4double slope = (y[i] - y[i - 1]) / width;
+        G4double distance = std::abs(slope) > 0 ? (-y[i - 1] + std::sqrt(std::max(y[i - 1] * y[i - 1] + 2 * slope * area, 0.))) / slope
+                                               : fraction * width;
+        wavelength = x[i - 1] + std::clamp(distance, 0., width);
+    }
+    else if (!m_configuration.wavelengthList.empty())
+    {
+        std::size_t size = m_configuration.wavelengthList.size();
+        wavelength = m_configuration.wavelengthList[std::min(static_cast<std::size_t>(G4UniformRand() * size), size - 1)];
+    }
+    else
+    {
+        return m_configuration.energy;
+    }
+    return 1239.84193 * eV * nm / wavelength;
+}
+
+/**
+ * @brief Inverse transform sampling of the tabulated theta profile (linear interpolation between the bin edges).
+ */
+G4double OMSimPhotonBeamGenerator::sampleProfileTheta()
+{
+    G4double random = G4UniformRand() * m_profileMaxCDF;
+    auto upper = std::lower_bound(m_profileCDF.begin(), m_profileCDF.end(), random);
+    std::size_t i = upper - m_profileCDF.begin();
+    const std::vector<G4double> &x = m_configuration.thetaProfileX;
+    if (i == 0)
+        return x.front();
+    if (i >= x.size())
+        return x.back();
+    G4double width = m_profileCDF[i] - m_profileCDF[i - 1];
+    return width > 0 ? x[i - 1] + (random - m_profileCDF[i - 1]) / width * (x[i] - x[i - 1]) : x[i];
+}
+
+/**
+ * @return Direction with polar angle p_theta around the beam axis -axis3 and azimuth p_phi.
+ */
+G4ThreeVector OMSimPhotonBeamGenerator::toGlobal(G4double p_theta, G4double p_phi)
+{
+    G4double sinTheta = std::sin(p_theta);
+    return -sinTheta * std::cos(p_phi) * m_axis1 - sinTheta * std::sin(p_phi) * m_axis2 - std::cos(p_theta) * m_axis3;
+}
+
+G4ThreeVector OMSimPhotonBeamGenerator::samplePosition()
+{
+    G4double x = 0;
+    G4double y = 0;
+    switch (m_configuration.shape)
+    {
+    case BeamShape::Disc:
+    {
+        G4double radial = G4UniformRand();
+        G4double angular = G4UniformRand();
+        if (m_eventCell >= 0)
+        {
+            // Uniform in the cell: ring i covers r^2 in [i, i+1] / rings, sector j covers phi in [j, j+1] / sectors of the turn
+            radial = (m_eventCell / m_configuration.footprintSectors + radial) / m_configuration.footprintRings;
+            angular = (m_eventCell % m_configuration.footprintSectors + angular) / m_configuration.footprintSectors;
+        }
+        G4double r = m_configuration.radius * std::sqrt(radial);
+        G4double phi = CLHEP::twopi * angular;
+        x = r * std::cos(phi);
+        y = r * std::sin(phi);
+        break;
+    }
+    case BeamShape::Rectangle:
+        x = m_configuration.halfX * (2 * G4UniformRand() - 1);
+        y = m_configuration.halfY * (2 * G4UniformRand() - 1);
+        break;
+    case BeamShape::Point:
+        break;
+    }
+    if (m_configuration.sigmaPosition > 0)
+    {
+        x += G4RandGauss::shoot(0, m_configuration.sigmaPosition);
+        y += G4RandGauss::shoot(0, m_configuration.sigmaPosition);
+    }
+    return m_configuration.centre + x * m_axis1 + y * m_axis2;
+}
+
+G4ThreeVector OMSimPhotonBeamGenerator::sampleDirection(const G4ThreeVector &p_position)
+{
+    switch (m_configuration.angular)
+    {
+    case BeamAngularDistribution::Gaussian:
+        return toGlobal(G4RandGauss::shoot(0, m_configuration.sigmaAngle), CLHEP::twopi * G4UniformRand());
+    case BeamAngularDistribution::Focused:
+        return (m_configuration.focusPoint - p_position).unit();
+    case BeamAngularDistribution::ThetaProfile:
+        return toGlobal(sampleProfileTheta(), CLHEP::twopi * G4UniformRand());
+    case BeamAngularDistribution::Collimated:
+        break;
+    }
+    return -m_axis3;
+}
+
+/**
+ * @brief Generates photons_per_event independent optical photons with the current configuration (or the beam of the event's point if a scan plan is running).
+ *
+ * Culled photons get no vertex; an event whose photons were all culled has no primaries, but is still processed, so the
+ * event actions see every event.
+ */
+void OMSimPhotonBeamGenerator::GeneratePrimaries(G4Event *p_event)
+{
+    updateConfiguration();
+    if (OMSimScanQueue::isRunning())
+        applyScanPoint(OMSimScanQueue::getPointOfEvent(p_event->GetEventID()));
+
+    sampleFootprintCell();
+    m_culledEnergies.clear();
+    bool cull = m_configuration.cullVolume.isEnabled();
+    for (G4int i = 0; i < m_photonsPerEvent; i++)
+    {
+        G4ThreeVector position = samplePosition();
+        G4ThreeVector direction = sampleDirection(position);
+        if (cull && missesCullVolume(m_configuration.cullVolume, position, direction))
+        {
+            m_culledEnergies.push_back(sampleEnergy());
+            continue;
+        }
+
+        // Random linear polarisation perpendicular to the momentum
+        G4ThreeVector perpendicular = direction.orthogonal().unit();
+        G4double angle = CLHEP::twopi * G4UniformRand();
+        G4ThreeVector polarisation = std::cos(angle) * perpendicular + std::sin(angle) * direction.cross(perpendicular);
+
+        G4PrimaryParticle *photon = new G4PrimaryParticle(G4OpticalPhoton::Definition());
+        photon->SetKineticEnergy(sampleEnergy());
+        photon->SetMomentumDirection(direction);
+        photon->SetPolarization(polarisation);
+
+        G4PrimaryVertex *vertex = new G4PrimaryVertex(position, 0.);
+        vertex->SetPrimary(photon);
+        p_event->AddPrimaryVertex(vertex);
+    }
+    if (!m_culledEnergies.empty())
+        m_culledPhotons.fetch_add(m_culledEnergies.size(), std::memory_order_relaxed);
+}
@@ -0,0 +1,106 @@
+#include "OMSimScanJournal.hh"
+#include "OMSimCommandArgsTable.hh"
+#include "OMSimLogger.hh"
+
+#include <Randomize.hh>
+
+#include <filesystem>
+#include <fstream>
+
+/**
+ * @brief Creates the journal of a scan; with `--resume`, restores the state of the last completed point.
+ * @param p_scanName Name of the scan, part of the journal file name and checked when resuming.
+ * @param p_outputFileName File to which the scan appends its rows.
+ * @param p_numberOfPoints Number of points of the scan, checked when resuming.
+ * @throw std::runtime_error If the journal to resume belongs to a different scan.
+ */
+OMSimScanJournal::OMSimScanJournal(const std::string &p_scanName, const std::string &p_outputFileName, std::size_t p_numberOfPoints)
+    : m_scanName(p_scanName), m_outputFileName(p_outputFileName), m_numberOfPoints(p_numberOfPoints)
+{
+    m_journalFileName = OMSimCommandArgsTable::getInstance().get<std::string>("output_file") + "_" + m_scanName + "_journal.txt";
+    if (!OMSimCommandArgsTable::getInstance().get<bool>("resume"))
+        return;
+    if (!std::filesystem::exists(m_journalFileName))
+    {
+        log_warning("No journal {} to resume, starting scan from the beginning", m_journalFileName);
+        return;
+    }
+    read();
+}
+
+/**
+ * @brief Reads the journal, truncates the output file to the recorded size and restores the random engine.
+ */
+void OMSimScanJournal::read()
+{
+    std::ifstream journal(m_journalFileName);
+    std::string key, scanName;
+    std::size_t numberOfPoints = 0;
+    std::uintmax_t outputSize = 0;
+    journal >> key >> scanName >> key >> numberOfPoints >> key >> m_completedPoints >> key >> outputSize >> key;
+    if (!journal || key != "engine")
+        throw std::runtime_error("Scan journal " + m_journalFileName + " is corrupt!");
+    if (scanName != m_scanName || numberOfPoints != m_numberOfPoints)
+        throw std::runtime_error("Scan journal " + m_journalFileName + " belongs to a different scan!");
+    G4Random::getTheEngine()->get(journal);
+    if (!journal)
+        throw std::runtime_error("Random engine state in scan journal " + m_journalFileName + " is corrupt!");
+
+    if (std::filesystem::exists(m_outputFileName))
+    {
+        if (std::filesystem::file_size(m_outputFileName) < outputSize)
+            throw std::runtime_error("Output file " + m_outputFileName + " is shorter than recorded in the scan journal!");
+        std::filesystem::resize_file(m_outputFileName, outputSize);
+    }
+    else if (outputSize > 0)
+    {
+        throw std::runtime_error("Output file " + m_outputFileName + " recorded in the scan journal is missing!");
+    }
+    m_resuming = true;
+    log_info("Resuming {} scan after {} of {} completed points", m_scanName, m_completedPoints, m_numberOfPoints);
+}
+
+/**
+ * @brief Writes the journal to a temporary file and renames it, so the journal is always complete.
+ */
+void OMSimScanJournal::write()
+{
+    std::uintmax_t outputSize = std::filesystem::exists(m_outputFileName) ? std::filesystem::file_size(m_outputFileName) : 0;
+    std::string temporaryFileName = m_journalFileName + ".tmp";
+    {
+        std::ofstream journal(temporaryFileName, std::ios::trunc);
+        if (!journal.is_open())
+            throw std::runtime_error("Failed to open file " + temporaryFileName);
+        journal << "scan " << m_scanName << "\n";
+        journal << "points " << m_numberOfPoints << "\n";
+        journal << "completed " << m_completedPoints << "\n";
+        journal << "output_size " << outputSize << "\n";
+        journal << "engine\n";
+        G4Random::getTheEngine()->put(journal);
+        journal << "\n";
+        journal.flush();
+        if (!journal)
+            throw std::runtime_error("Failed to write scan journal " + temporaryFileName);
+    }
+    std::filesystem::rename(temporaryFileName, m_journalFileName);
+}
+
+/**
+ * @brief Records the state before the first point (after writing the header), if not resuming.
+ */
+void OMSimScanJournal::recordStart()
+{
+    if (!m_resuming)
+        write();
+}
+
+/**
+ * @brief Records that all points up to p_point are completed and their rows written to the output file.
+ * @param p_point Index of the completed point.
+ */
+void OMSimScanJournal::recordCompleted(std::size_t p_point)
+{
+    m_completedPoints = p_point + 1;
+    write();
+    log_trace("Scan journal: {} of {} points completed", m_completedPoints, m_numberOfPoints);
+}
@@ -0,0 +1,152 @@
+#include "OMSimScanPlan.hh"
+#include "OMSimCommandArgsTable.hh"
+#include "OMSimLogger.hh"
+#include "OMSimTools.hh"
+
+#include <Randomize.hh>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <algorithm>
+
+namespace pt = boost::property_tree;
+
+/**
+ * @param p_name Name of the parameter.
+ * @return Value of the parameter at this point.
+ * @throw std::invalid_argument If the plan does not define the parameter.
+ */
+G4double ScanPoint::get(const std::string &p_name) const
+{
+    auto found = parameters.find(p_name);
+    if (found == parameters.end())
+        throw std::invalid_argument("Scan plan does not define parameter " + p_name + "!");
+    return found->second;
+}
+
+/**
+ * @param p_name Name of the parameter.
+ * @param p_default Value returned if the plan does not define the parameter.
+ */
+G4double ScanPoint::get(const std::string &p_name, G4double p_default) const
+{
+    auto found = parameters.find(p_name);
+    return found == parameters.end() ? p_default : found->second;
+}
+
+/**
+ * @param p_fileName Json file with the plan (see class description).
+ * @throw std::invalid_argument If the design is unknown or the plan has no points.
+ */
+OMSimScanPlan::OMSimScanPlan(const std::string &p_fileName) : m_fileName(p_fileName)
+{
+    pt::ptree tree;
+    pt::read_json(p_fileName, tree);
+
+    m_photons = tree.get<G4int>("photons", OMSimCommandArgsTable::getInstance().get<G4int>("numevents"));
+    std::string design = tree.get<std::string>("design", "grid");
+    if (design == "grid")
+        readGrid(tree);
+    else if (design == "list")
+        readList(tree);
+    else if (design == "random")
+        readRandom(tree);
+    else
+        throw std::invalid_argument("Unknown design '" + design + "' in scan plan " + p_fileName + " (use grid, list or random)!");
+
+    if (m_points.empty())
+        throw std::invalid_argument("Scan plan " + p_fileName + " has no points!");
+    log_info("Scan plan {} ({} design) with {} points", p_fileName, design, m_points.size());
+}
+
+/**
+ * @brief Values of a grid parameter, either a json array or a range {"start", "stop", "step"}.
+ */
+std::vector<G4double> OMSimScanPlan::readValues(const std::string &p_name, const pt::ptree &p_node)
+{
+    std::vector<G4double> values;
+    if (p_node.count("start"))
+    {
+        values = Tools::arange(p_node.get<G4double>("start"), p_node.get<G4double>("stop"), p_node.get<G4double>("step"));
+    }
+    else
+    {
+        for (const auto &value : p_node)
+            values.push_back(value.second.get_value<G4double>());
+    }
+    if (values.empty())
+        throw std::invalid_argument("Parameter " + p_name + " of scan plan " + m_fileName + " has no values!");
+    return values;
+}
+
+void OMSimScanPlan::readGrid(const pt::ptree &p_tree)
+{
+    std::vector<std::vector<G4double>> values;
+    for (const auto &parameter : p_tree.get_child("parameters"))
+    {
+        m_parameterNames.push_back(parameter.first);
+        values.push_back(readValues(parameter.first, parameter.second));
+    }
+
+    // Odometer over the value lists, last parameter fastest
+    std::vector<std::size_t> index(values.size(), 0);
+    while (!values.empty())
+    {
+        ScanPoint point;
+        point.photons = m_photons;
+        for (std::size_t i = 0; i < values.size(); i++)
+            point.parameters[m_parameterNames[i]] = values[i][index[i]];
+        m_points.push_back(point);
+
+        std::size_t digit = values.size();
+        while (digit > 0 && ++index[digit - 1] == values[digit - 1].size())
+            index[--digit] = 0;
+        if (digit == 0)
+            break;
+    }
+}
+
+void OMSimScanPlan::readList(const pt::ptree &p_tree)
+{
+    for (const auto &entry : p_tree.get_child("points"))
+    {
+        ScanPoint point;
+        point.photons = m_photons;
+        for (const auto &parameter : entry.second)
+        {
+            if (parameter.first == "photons")
+            {
+                point.photons = parameter.second.get_value<G4int>();
+                continue;
+            }
+            point.parameters[parameter.first] = parameter.second.get_value<G4double>();
+            if (std::find(m_parameterNames.begin(), m_parameterNames.end(), parameter.first) == m_parameterNames.end())
+                m_parameterNames.push_back(parameter.first);
+        }
+        m_points.push_back(point);
+    }
+    for (const auto &point : m_points)
+    {
+        if (point.parameters.size() != m_parameterNames.size())
+            throw std::invalid_argument("All points of scan plan " + m_fileName + " must define the same parameters!");
+    }
+}
+
+void OMSimScanPlan::readRandom(const pt::ptree &p_tree)
+{
+    std::vector<std::pair<G4double, G4double>> ranges;
+    for (const auto &parameter : p_tree.get_child("parameters"))
+    {
+        m_parameterNames.push_back(parameter.first);
+        ranges.push_back({parameter.second.get<G4double>("min"), parameter.second.get<G4double>("max")});
+    }
+
+    G4int numberOfPoints = p_tree.get<G4int>("points");
+    for (G4int i = 0; i < numberOfPoints; i++)
+    {
+        ScanPoint point;
+        point.photons = m_photons;
+        for (std::size_t j = 0; j < ranges.size(); j++)
+            point.parameters[m_parameterNames[j]] = ranges[j].first + G4UniformRand() * (ranges[j].second - ranges[j].first);
+        m_points.push_back(point);
+    }
+}
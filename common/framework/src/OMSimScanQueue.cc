@@ -0,0 +1,175 @@
+#include "OMSimScanQueue.hh"
+#include "OMSimLogger.hh"
+#include "OMSimUIinterface.hh"
+
+#include <G4Event.hh>
+
+#include <algorithm>
+#include <limits>
+
+const OMSimScanPlan *OMSimScanQueue::m_plan = nullptr;
+const std::vector<BeamConfiguration> *OMSimScanQueue::m_beams = nullptr;
+OMSimScanQueue::PointWriter OMSimScanQueue::m_writer;
+std::ofstream OMSimScanQueue::m_output;
+G4int OMSimScanQueue::m_numberOfPMTs = 0;
+std::size_t OMSimScanQueue::m_nextPoint = 0;
+unsigned int OMSimScanQueue::m_generation = 0;
+std::vector<G4int> OMSimScanQueue::m_eventOffsets;
+std::vector<G4int> OMSimScanQueue::m_pointEvents;
+std::unique_ptr<std::atomic<G4int>[]> OMSimScanQueue::m_finishedEvents;
+std::vector<std::unique_ptr<std::vector<ScanPointTally>>> OMSimScanQueue::m_threadTallies;
+G4ThreadLocal std::vector<ScanPointTally> *OMSimScanQueue::m_threadTally = nullptr;
+G4ThreadLocal unsigned int OMSimScanQueue::m_threadGeneration = 0;
+G4Mutex OMSimScanQueue::m_mutex = G4Mutex();
+
+/**
+ * @brief Runs all points of a plan in a single run and writes one line per point to the output file.
+ * @param p_plan Points to run.
+ * @param p_beams Beam of each point, same size as the plan.
+ * @param p_numberOfPMTs Number of PMTs of module 0 (size of the tallies).
+ * @param p_outputFileName File to which the points are appended.
+ * @param p_writer Writes one point, see PointWriter.
+ * @throw std::invalid_argument If the number of beams does not match the plan, the photons of a point are not a multiple
+ * of the photons per event, or the run would have too many events.
+ */
+void OMSimScanQueue::run(const OMSimScanPlan &p_plan, const std::vector<BeamConfiguration> &p_beams, G4int p_numberOfPMTs,
+                         const std::string &p_outputFileName, const PointWriter &p_writer)
+{
+    std::size_t numberOfPoints = p_plan.getNumberOfPoints();
+    if (p_beams.size() != numberOfPoints)
+        throw std::invalid_argument("Number of beams and scan plan points differ!");
+
+    std::vector<G4int> eventOffsets;
+    std::vector<G4int> pointEvents;
+    G4double totalEvents = 0;
+    for (const auto &point : p_plan.getPoints())
+    {
+        G4int events = OMSimPhotonBeamGenerator::getNumberOfEvents(std::max(point.photons, 0));
+        pointEvents.push_back(events);
+        totalEvents += events;
+        if (totalEvents > std::numeric_limits<G4int>::max())
+            throw std::invalid_argument("Too many events for a single run, reduce the photons of the scan plan!");
+        eventOffsets.push_back(static_cast<G4int>(totalEvents));
+    }
+
+    G4AutoLock lock(&m_mutex);
+    m_plan = &p_plan;
+    m_beams = &p_beams;
+    m_writer = p_writer;
+    m_numberOfPMTs = p_numberOfPMTs;
+    m_pointEvents = pointEvents;
+    m_nextPoint = 0;
+    m_generation++;
+    m_finishedEvents = std::make_unique<std::atomic<G4int>[]>(numberOfPoints);
+    for (std::size_t i = 0; i < numberOfPoints; i++)
+        m_finishedEvents[i].store(0);
+    m_output.open(p_outputFileName, std::ios::out | std::ios::app);
+    if (!m_output.is_open())
+        throw std::runtime_error("Failed to open file " + p_outputFileName);
+    writeCompletedPoints(); // points without photons at the start of the plan
+    lock.unlock();
+
+    if (totalEvents > 0)
+    {
+        OMSimPhotonBeamGenerator::setConfiguration(p_beams.at(0));
+        m_eventOffsets = eventOffsets;
+        log_info("Running {} scan points with {} events in a single run", numberOfPoints, totalEvents);
+        OMSimUIinterface::getInstance().runBeamOn(static_cast<G4int>(totalEvents));
+        m_eventOffsets.clear();
+    }
+
+    lock.lock();
+    writeCompletedPoints();
+    if (m_nextPoint < numberOfPoints)
+        log_error("Only {} of {} scan points completed", m_nextPoint, numberOfPoints);
+    m_output.close();
+    for (auto &tally : m_threadTallies)
+        tally->clear();
+    m_plan = nullptr;
+    m_beams = nullptr;
+}
+
+/**
+ * @param p_eventID ID of an event of the running plan.
+ * @return Index of the point the event belongs to.
+ */
+G4int OMSimScanQueue::getPointOfEvent(G4int p_eventID)
+{
+    return static_cast<G4int>(std::upper_bound(m_eventOffsets.begin(), m_eventOffsets.end(), p_eventID) - m_eventOffsets.begin());
+}
+
+/**
+ * @brief Adds the hits of an event to the tally of its point, and writes the point if this was its last event.
+ *
+ * Call from the study's EndOfEventAction; does nothing if no plan is running. Only locks on the first event of a thread
+ * in a run and when a point is complete.
+ * @param p_event The event that ended.
+ * @param p_moduleHits Hits of the event in module 0, or nullptr if there were none.
+ */
+void OMSimScanQueue::endOfEvent(const G4Event *p_event, const HitStats *p_moduleHits)
+{
+    if (!isRunning())
+        return;
+
+    if (!m_threadTally || m_threadGeneration != m_generation)
+    {
+        G4AutoLock lock(&m_mutex);
+        if (!m_threadTally)
+        {
+            m_threadTallies.push_back(std::make_unique<std::vector<ScanPointTally>>());
+            m_threadTally = m_threadTallies.back().get();
+        }
+        m_threadTally->assign(m_plan->getNumberOfPoints(), ScanPointTally());
+        m_threadGeneration = m_generation;
+    }
+
+    G4int point = getPointOfEvent(p_event->GetEventID());
+    if (p_moduleHits && !p_moduleHits->PMTnr.empty())
+    {
+        ScanPointTally &tally = (*m_threadTally)[point];
+        if (tally.weightedHits.empty())
+            tally.weightedHits.assign(m_numberOfPMTs + 1, 0.0);
+        for (std::size_t i = 0; i < p_moduleHits->PMTnr.size(); i++)
+        {
+            double weight = p_moduleHits->PMTresponse.at(i).detectionProbability;
+            tally.weightedHits.at(p_moduleHits->PMTnr.at(i)) += weight;
+            tally.weightedHits.back() += weight;
+        }
+        tally.countedHits += p_moduleHits->PMTnr.size();
+    }
+
+    // The tally writes above happen before the increment, so the thread completing the point sees them
+    if (m_finishedEvents[point].fetch_add(1, std::memory_order_acq_rel) + 1 == m_pointEvents[point])
+    {
+        G4AutoLock lock(&m_mutex);
+        writeCompletedPoints();
+    }
+}
+
+/**
+ * @brief Sums the thread tallies of all complete points after the last written one and writes them in plan order. Call with m_mutex locked.
+ *
+ * No thread writes to the tally of a complete point anymore, so the tallies of the other threads can be read while they run.
+ */
+void OMSimScanQueue::writeCompletedPoints()
+{
+    while (m_nextPoint < m_plan->getNumberOfPoints() &&
+           m_finishedEvents[m_nextPoint].load(std::memory_order_acquire) >= m_pointEvents[m_nextPoint])
+    {
+        ScanPointTally merged;
+        merged.weightedHits.assign(m_numberOfPMTs + 1, 0.0);
+        for (auto &threadTally : m_threadTallies)
+        {
+            if (threadTally->size() <= m_nextPoint)
+                continue;
+            ScanPointTally &tally = (*threadTally)[m_nextPoint];
+            for (std::size_t pmt = 0; pmt < tally.weightedHits.size(); pmt++)
+                merged.weightedHits[pmt] += tally.weightedHits[pmt];
+            merged.countedHits += tally.countedHits;
+            tally = ScanPointTally();
+        }
+        m_writer(m_output, m_plan->getPoint(m_nextPoint), merged);
+        m_output.flush();
+        m_nextPoint++;
+    }
+}
@@ -6,6 +6,7 @@
 
 #pragma once
 #include "OMSimOpticalModule.hh"
+#include "OMSimPhotonBeamGenerator.hh"
 
 #include <G4Orb.hh>
 #include <G4VUserDetectorConstruction.hh>
@@ -23,6 +24,7 @@ public:
     G4VPhysicalVolume *Construct();
     void ConstructSDandField() override;
     void registerSensitiveDetector(G4LogicalVolume* logVol, G4VSensitiveDetector* aSD);
+    BeamCullVolume getBoundingVolume();
 
     G4VPhysicalVolume *m_worldPhysical;
 
@@ -18,6 +18,7 @@ public:
     void construction();
     double getPressureVesselWeight() {return (5.38+5.35)*kg;};
     int getNumberOfPMTs() { return m_totalNumberPMTs;};
+    ModuleSymmetry getSymmetry() override;
     
     G4String getName()
     {
@@ -18,6 +18,7 @@ public:
     void construction();
     double getPressureVesselWeight() { return 13.0 * kg; };
     int getNumberOfPMTs() { return m_totalNumberPMTs; };
+    ModuleSymmetry getSymmetry() override;
     G4String getName()
     {
         std::stringstream ss;
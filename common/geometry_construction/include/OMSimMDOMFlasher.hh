@@ -13,6 +13,7 @@
 #pragma once
 
 #include "OMSimDetectorComponent.hh"
+#include "OMSimPhotonBeamGenerator.hh"
 #include <G4UnionSolid.hh>
 #include <G4Navigator.hh>
 
@@ -38,7 +39,7 @@ struct GlobalPosition
  * @details
  * This class is responsible for creating the flashers in the mDOM,
  * which includes a LED, the air around it, and a glass window on top of it. This class also has methods for retrieving flasher solids,
- * activating a specific flasher in a particular module, and configuring the GPS for flasher simulations.
+ * activating a specific flasher in a particular module, and configuring the beam of OMSimPhotonBeamGenerator for flasher simulations (the study's primary generator must derive from it).
  * @ingroup common
  */
 class mDOMFlasher : public OMSimDetectorComponent
@@ -48,6 +49,7 @@ public:
     void construction();
     std::tuple<G4UnionSolid *, G4UnionSolid *, G4Tubs *> getSolids();
     void runBeamOnFlasher(mDOM *pMDOMInstance, G4int pModuleIndex, G4int pLEDIndex);
+    BeamConfiguration getBeamConfiguration(mDOM *pMDOMInstance, G4int pModuleIndex, G4int pLEDIndex);
 
 
 private:
@@ -55,7 +57,6 @@ private:
     void makeLogicalVolumes();
     void readFlasherProfile();
     GlobalPosition getFlasherPositionInfo(mDOM *pMDOMInstance, G4int pModuleIndex, G4int pLEDIndex);
-    void configureGPS(GlobalPosition flasherInfo);
 
     G4UnionSolid *m_LEDSolid;
     G4UnionSolid *m_flasherHoleSolid;
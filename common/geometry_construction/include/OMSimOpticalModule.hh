@@ -14,6 +14,19 @@
 #include "OMSimPMTConstruction.hh"
 class OMSimDetectorConstruction;
 
+/**
+ *  @brief Discrete symmetry group of an optical module.
+ *  @details The module is invariant under rotations by 360 deg / azimuthalOrder around its z axis and, if upDownMirror is true,
+ *           under the mirror z -> -z (and their combinations). The PMT positions are needed to know which PMT an operation maps onto.
+ *  @ingroup common
+ */
+struct ModuleSymmetry
+{
+    G4int azimuthalOrder = 1;                 ///< Order of the azimuthal rotation symmetry (1: none).
+    G4bool upDownMirror = false;              ///< Module invariant under z -> -z.
+    std::vector<G4ThreeVector> PMTPositions;  ///< Position of each PMT in the module frame, in PMT index order.
+};
+
 /**
  *  @class OMSimOpticalModule
  *  @brief Base class for OMs works as interface
@@ -45,6 +58,13 @@ public:
 
     virtual G4String getName() = 0;
 
+    /**
+     *  @brief Symmetry group of the module, used to reduce angular scans (see SymmetricScanPlanner).
+     *  @details Derived classes whose geometry has symmetries should override this. The default is no symmetry.
+     *  @return Symmetry group of the module.
+     */
+    virtual ModuleSymmetry getSymmetry() { return ModuleSymmetry(); };
+
     OMSimPMTConstruction *getPMTmanager();
     G4int m_index;
 
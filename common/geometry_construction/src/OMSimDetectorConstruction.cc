@@ -9,6 +9,8 @@
 #include "OMSimLogger.hh"
 
 #include "G4SDManager.hh"
+#include <G4Material.hh>
+#include <G4VSolid.hh>
 
 OMSimDetectorConstruction::OMSimDetectorConstruction()
     : m_worldSolid(0), m_worldLogical(0), m_worldPhysical(0)
@@ -55,4 +57,62 @@ void OMSimDetectorConstruction::registerSensitiveDetector(G4LogicalVolume *pLogV
 {
     log_trace("Registering logical volume {} as sensitive detector {}", pLogVol->GetName(), pSD->GetName());
     m_sensitiveDetectors.push_back({pLogVol, pSD});
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Bounding sphere and cylinder (axis along z) of all volumes placed in the world, for culling beam photons that can not hit them.
+ *
+ * The bounding boxes of the daughters of the world are placed in the world and enclosed by a sphere and a cylinder around
+ * their common centre. Photons in the world medium only travel in straight lines if it does not scatter, so no volume is
+ * returned (culling stays disabled) if the world material has a Rayleigh or Mie scattering length.
+ * @return Bounding volume, disabled if there are no daughters or the world medium scatters.
+ */
+BeamCullVolume OMSimDetectorConstruction::getBoundingVolume()
+{
+    BeamCullVolume volume;
+    G4MaterialPropertiesTable *properties = m_worldLogical->GetMaterial()->GetMaterialPropertiesTable();
+    if (properties && (properties->GetProperty("RAYLEIGH") || properties->GetProperty("MIEHG")))
+    {
+        log_warning("World medium {} scatters photons, photons missing the detector can not be culled", m_worldLogical->GetMaterial()->GetName());
+        return volume;
+    }
+    if (m_worldLogical->GetNoDaughters() == 0)
+        return volume;
+
+    std::vector<G4ThreeVector> corners;
+    for (std::size_t i = 0; i < m_worldLogical->GetNoDaughters(); i++)
+    {
+        G4VPhysicalVolume *daughter = m_worldLogical->GetDaughter(i);
+        G4ThreeVector minimum;
+        G4ThreeVector maximum;
+        daughter->GetLogicalVolume()->GetSolid()->BoundingLimits(minimum, maximum);
+        G4RotationMatrix rotation = daughter->GetObjectRotationValue();
+        for (G4int corner = 0; corner < 8; corner++)
+        {
+            G4ThreeVector local(corner & 1 ? maximum.x() : minimum.x(), corner & 2 ? maximum.y() : minimum.y(), corner & 4 ? maximum.z() : minimum.z());
+            corners.push_back(rotation * local + daughter->GetObjectTranslation());
+        }
+    }
+
+    G4ThreeVector minimum = corners.front();
+    G4ThreeVector maximum = corners.front();
+    for (const auto &corner : corners)
+    {
+        minimum = G4ThreeVector(std::min(minimum.x(), corner.x()), std::min(minimum.y(), corner.y()), std::min(minimum.z(), corner.z()));
+        maximum = G4ThreeVector(std::max(maximum.x(), corner.x()), std::max(maximum.y(), corner.y()), std::max(maximum.z(), corner.z()));
+    }
+    volume.centre = 0.5 * (minimum + maximum);
+    for (const auto &corner : corners)
+    {
+        volume.sphereRadius = std::max(volume.sphereRadius, (corner - volume.centre).mag());
+        volume.cylinderRadius = std::max(volume.cylinderRadius, (corner - volume.centre).perp());
+    }
+    volume.cylinderHalfHeight = 0.5 * (maximum.z() - minimum.z());
+
+    // Margin against rounding, photons grazing the boxes are tracked
+    volume.sphereRadius += 1 * mm;
+    volume.cylinderRadius += 1 * mm;
+    volume.cylinderHalfHeight += 1 * mm;
+    log_debug("Bounding sphere radius {} mm, cylinder radius {} mm and half height {} mm", volume.sphereRadius / mm, volume.cylinderRadius / mm, volume.cylinderHalfHeight / mm);
+    return volume;
+}
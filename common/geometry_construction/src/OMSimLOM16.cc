@@ -30,6 +30,23 @@ LOM16::LOM16(G4bool p_placeHarness) : OMSimOpticalModule(new OMSimPMTConstructio
     log_trace("Finished constructing LOM16");
 }
 
+/**
+ * @brief The PMTs and gel pads have a fourfold azimuthal symmetry.
+ * @details The lower PMTs are not placed at the mirrored z of the upper ones (see setPMTAndGelpadPositions), so no up-down symmetry
+ *          is declared. The internal support structure follows the rotation symmetry only approximately, and the harness breaks it
+ *          (no symmetry is returned if it is placed).
+ * @return Symmetry group of the LOM16.
+ */
+ModuleSymmetry LOM16::getSymmetry()
+{
+    ModuleSymmetry symmetry;
+    if (m_placeHarness)
+        return symmetry;
+    symmetry.azimuthalOrder = m_numberPolarPMTs;
+    symmetry.PMTPositions = m_positionsPMT;
+    return symmetry;
+}
+
 void LOM16::construction()
 {
     G4VSolid *glassSolid = pressureVessel(m_glassOutRad, "Glass");
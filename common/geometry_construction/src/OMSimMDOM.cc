@@ -45,6 +45,22 @@ mDOM::mDOM(G4bool p_placeHarness)
     log_trace("Finished constructing mDOM");
 }
 
+/**
+ * @brief The PMT and reflector layout has a fourfold azimuthal symmetry and the lower half mirrors the upper one.
+ * @details The single polar flashers at -90 deg break the symmetry slightly, the harness strongly (no symmetry is returned if it is placed).
+ * @return Symmetry group of the mDOM.
+ */
+ModuleSymmetry mDOM::getSymmetry()
+{
+    ModuleSymmetry symmetry;
+    if (m_placeHarness)
+        return symmetry;
+    symmetry.azimuthalOrder = m_numberPolarPMTs;
+    symmetry.upDownMirror = true;
+    symmetry.PMTPositions = m_positionsPMT;
+    return symmetry;
+}
+
 void mDOM::construction()
 {
 
@@ -1,6 +1,7 @@
 #include "OMSimMDOM.hh"
 #include "OMSimUIinterface.hh"
 #include "OMSimCommandArgsTable.hh"
+#include "OMSimPhotonBeamGenerator.hh"
 #include "OMSimTools.hh"
 #include "G4TouchableHistoryHandle.hh"
 #include "G4TransportationManager.hh"
@@ -76,7 +77,7 @@ std::tuple<G4UnionSolid *, G4UnionSolid *, G4Tubs *> mDOMFlasher::getSolids()
 
 /*
  * %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
- *                                GPS flashing methods
+ *                                Flashing methods
  * %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
  */
 
@@ -89,19 +90,10 @@ std::tuple<G4UnionSolid *, G4UnionSolid *, G4Tubs *> mDOMFlasher::getSolids()
  */
 void mDOMFlasher::runBeamOnFlasher(mDOM *p_instanceMDOM, G4int p_moduleIndex, G4int p_LEDIndex)
 {
-	if (!m_flasherProfileAvailable)
-	{
-		readFlasherProfile();
-	}
-
-	// Get Flasher and Rotation Info
-	auto flasherInfo = getFlasherPositionInfo(p_instanceMDOM, p_moduleIndex, p_LEDIndex);
-
-	// Configure the GPS
-	configureGPS(flasherInfo);
+	OMSimPhotonBeamGenerator::setConfiguration(getBeamConfiguration(p_instanceMDOM, p_moduleIndex, p_LEDIndex));
 
 	// Flash the LED
-	OMSimUIinterface::getInstance().runBeamOn();
+	OMSimUIinterface::getInstance().runBeamOn(OMSimPhotonBeamGenerator::getNumberOfEvents());
 }
 
 /**
@@ -160,32 +152,30 @@ GlobalPosition mDOMFlasher::getFlasherPositionInfo(mDOM *p_instanceMDOM, G4int p
 }
 
 /**
- * @brief Configures the GPS for the flasher simulation.
- * @param flasherInfo The position and orientation information of the flasher.
+ * @brief Beam of OMSimPhotonBeamGenerator for the flasher simulation, e.g. to run several LEDs as points of an OMSimScanQueue plan.
+ * @details Point source at the LED emitting with the measured polar angle profile around the LED axis.
+ * @param p_instanceMDOM The mDOM instance to access to the placement OM positions and orientations.
+ * @param p_moduleIndex The index of the module to be flashed.
+ * @param p_LEDIndex The index of the flasher within the module.
  */
-void mDOMFlasher::configureGPS(GlobalPosition pGlobalPos)
+BeamConfiguration mDOMFlasher::getBeamConfiguration(mDOM *p_instanceMDOM, G4int p_moduleIndex, G4int p_LEDIndex)
 {
-	OMSimUIinterface &lUIinterface = OMSimUIinterface::getInstance();
-
-	lUIinterface.applyCommand("/gps/pos/type Point");
-	lUIinterface.applyCommand("/gps/ang/type user");   // biast = theta
-	lUIinterface.applyCommand("/gps/hist/type theta"); // biast = theta
-
-	for (unsigned int u = 0; u < m_profileX.size(); u++)
+	if (!m_flasherProfileAvailable)
 	{
-		lUIinterface.applyCommand("/gps/hist/point", m_profileX.at(u), m_profileY.at(u)); // biast = theta
+		readFlasherProfile();
 	}
-
-	lUIinterface.applyCommand("/gps/ang/surfnorm");
-
-	lUIinterface.applyCommand("/gps/pos/rot1", pGlobalPos.rotation.xx(), pGlobalPos.rotation.yx(), pGlobalPos.rotation.zx());
-	lUIinterface.applyCommand("/gps/ang/rot1", pGlobalPos.rotation.xx(), pGlobalPos.rotation.yx(), pGlobalPos.rotation.zx());
-
-	lUIinterface.applyCommand("/gps/pos/rot2", -pGlobalPos.rotation.xy(), -pGlobalPos.rotation.yy(), -pGlobalPos.rotation.zy());
-	lUIinterface.applyCommand("/gps/ang/rot2", -pGlobalPos.rotation.xy(), -pGlobalPos.rotation.yy(), -pGlobalPos.rotation.zy());
-	lUIinterface.applyCommand("/gps/ang/maxtheta 89 deg"); // when too close to 90, give photons that directly hit the structure and do not propagate... photons with theta=90 are anyway weighed very low
-
-	lUIinterface.applyCommand("/gps/pos/centre", pGlobalPos.x, pGlobalPos.y, pGlobalPos.z, "mm");
-	lUIinterface.applyCommand("/gps/particle opticalphoton");
-	lUIinterface.applyCommand("/gps/energy", 1239.84193 / OMSimCommandArgsTable::getInstance().get<G4double>("wavelength"), "eV");
+	GlobalPosition flasherInfo = getFlasherPositionInfo(p_instanceMDOM, p_moduleIndex, p_LEDIndex);
+
+	BeamConfiguration beam;
+	beam.shape = BeamShape::Point;
+	beam.angular = BeamAngularDistribution::ThetaProfile;
+	beam.thetaProfileX = m_profileX;
+	beam.thetaProfileY = m_profileY;
+	beam.maxTheta = 89 * deg; // when too close to 90, give photons that directly hit the structure and do not propagate... photons with theta=90 are anyway weighed very low
+
+	beam.rot1 = G4ThreeVector(flasherInfo.rotation.xx(), flasherInfo.rotation.yx(), flasherInfo.rotation.zx());
+	beam.rot2 = G4ThreeVector(-flasherInfo.rotation.xy(), -flasherInfo.rotation.yy(), -flasherInfo.rotation.zy());
+	beam.centre = G4ThreeVector(flasherInfo.x, flasherInfo.y, flasherInfo.z);
+	beam.energy = 1239.84193 / OMSimCommandArgsTable::getInstance().get<G4double>("wavelength") * eV;
+	return beam;
 }
@@ -0,0 +1,106 @@
+/**
+ * @file args_json_test.cc
+ * @brief Checks that OMSimCommandArgsTable::writeToJson writes valid JSON for all argument types used by the studies.
+ *
+ * Fills the table with values of every supported type (including the multitoken options, which are vectors) and of an
+ * unsupported type (written as null), writes the args file, parses it back with boost::property_tree and compares the values. The return code is non-zero if
+ * the file is not valid JSON or any value differs.
+ *
+ * Usage: args_json_test [output file]
+ * @ingroup common
+ */
+
+#include "OMSimCommandArgsTable.hh"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+std::shared_ptr<spdlog::logger> g_logger;
+
+namespace
+{
+  int g_failures = 0;
+
+  void check(bool pCondition, const std::string &pMessage)
+  {
+    if (!pCondition)
+    {
+      std::printf("FAILED: %s\n", pMessage.c_str());
+      g_failures++;
+    }
+  }
+
+  std::vector<std::string> readArray(const boost::property_tree::ptree &pTree, const std::string &pKey)
+  {
+    std::vector<std::string> values;
+    for (const auto &child : pTree.get_child(pKey))
+    {
+      values.push_back(child.second.get_value<std::string>());
+    }
+    return values;
+  }
+
+  void checkDoubleArray(const boost::property_tree::ptree &pTree, const std::string &pKey, const std::vector<double> &pExpected)
+  {
+    std::vector<std::string> values = readArray(pTree, pKey);
+    check(values.size() == pExpected.size(), pKey + " has " + std::to_string(values.size()) + " entries");
+    for (size_t i = 0; i < values.size() && i < pExpected.size(); ++i)
+    {
+      check(std::abs(std::stod(values[i]) - pExpected[i]) <= 1e-5 * std::abs(pExpected[i]), pKey + " entry " + std::to_string(i) + " is " + values[i]);
+    }
+  }
+}
+
+int main(int pArgumentCount, char *pArgumentVector[])
+{
+  const std::string fileName = pArgumentCount > 1 ? pArgumentVector[1] : "args_json_test_args.json";
+
+  OMSimCommandArgsTable::init();
+  OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+  args.setParameter("numevents", 10);
+  args.setParameter("time_window", 60.5);
+  args.setParameter("seed", 1234567890123L);
+  args.setParameter("visual", false);
+  args.setParameter("output_file", std::string("output"));
+  args.setParameter("help", boost::any());
+  args.setParameter("multiplicity_time_window", std::vector<double>{10., 20., 50.});
+  args.setParameter("wavelengths", std::vector<double>{365., 405.5, 600.}); // std::vector<G4double> in the effective area study, G4double is double
+  args.setParameter("empty_list", std::vector<double>{});
+  args.setParameter("merge_chunks", std::vector<std::string>{"out_chunk0_hits.dat", "out_chunk1_hits.dat"});
+  args.setParameter("unsupported", 1.5f);
+  args.finalize();
+  args.writeToJson(fileName);
+  OMSimCommandArgsTable::shutdown();
+
+  boost::property_tree::ptree tree;
+  try
+  {
+    boost::property_tree::read_json(fileName, tree);
+  }
+  catch (const boost::property_tree::json_parser_error &e)
+  {
+    std::printf("FAILED: %s is not valid JSON: %s\n", fileName.c_str(), e.what());
+    return 1;
+  }
+
+  check(tree.get<int>("numevents") == 10, "numevents");
+  check(tree.get<double>("time_window") == 60.5, "time_window");
+  check(tree.get<long>("seed") == 1234567890123L, "seed");
+  check(tree.get<int>("visual") == 0, "visual"); // bools are written as 0/1
+  check(tree.get<std::string>("output_file") == "output", "output_file");
+  check(tree.get<std::string>("help") == "", "help");
+  checkDoubleArray(tree, "multiplicity_time_window", {10., 20., 50.});
+  checkDoubleArray(tree, "wavelengths", {365., 405.5, 600.});
+  check(readArray(tree, "empty_list").empty(), "empty_list");
+  check(readArray(tree, "merge_chunks") == std::vector<std::string>{"out_chunk0_hits.dat", "out_chunk1_hits.dat"}, "merge_chunks");
+  check(tree.get<std::string>("unsupported") == "null", "unsupported");
+
+  std::remove(fileName.c_str());
+  std::printf("%s\n", g_failures ? "args JSON test failed" : "args JSON test passed");
+  return g_failures ? 1 : 0;
+}
@@ -8,38 +8,432 @@
 #include "OMSimAngularScan.hh"
 #include "OMSimEffectiveAreaAnalyisis.hh"
 #include "OMSimEffectiveAreaDetector.hh"
+#include "OMSimScanJournal.hh"
+#include "OMSimScanPlan.hh"
+#include "OMSimScanQueue.hh"
+#include "OMSimSymmetricScanPlanner.hh"
 #include "OMSimTools.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <Randomize.hh>
+
 std::shared_ptr<spdlog::logger> g_logger;
 namespace po = boost::program_options;
 
-void runEffectiveAreaSimulation()
+/**
+ * @brief Simulates photons per direction in batches until the effective area of each direction reaches the relative error
+ * target_error or max_photons photons were simulated.
+ *
+ * Each round is a single run (see AngularScan::runMultipleAngularScan) with one batch for every unfinished direction, so the
+ * batches are distributed dynamically over the threads. The first batch has numevents photons; the following ones are
+ * estimated from the hits so far to reach the target in one more round.
+ * @param p_photons Filled with the photons simulated per direction.
+ * @return Hits per direction.
+ */
+DirectionTally runAdaptiveScan(AngularScan *p_scanner, const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas, std::vector<G4long> &p_photons)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	G4double targetError = args.get<G4double>("target_error");
+	if (targetError <= 0)
+		throw std::invalid_argument("target_error must be positive!");
+	G4long maxPhotons = args.get<G4int>("max_photons");
+	G4long batchSize = args.get<G4int>("numevents");
+	G4long photonsPerEvent = OMSimPhotonBeamGenerator::getPhotonsPerEvent();
+	G4double targetHits = 1. / (targetError * targetError); // relative error of the effective area is 1/sqrt(hits)
+
+	DirectionTally total;
+	p_photons.assign(p_phis.size(), 0);
+	std::vector<G4int> batches(p_phis.size(), static_cast<G4int>(batchSize));
+	G4int round = 0;
+
+	while (std::any_of(batches.begin(), batches.end(), [](G4int batch) { return batch > 0; }))
+	{
+		p_scanner->runMultipleAngularScan(p_phis, p_thetas, batches);
+		OMSimEffectiveAreaAnalyisis::addDirectionTally(total, OMSimEffectiveAreaAnalyisis::mergeDirectionTallies());
+
+		G4int unfinished = 0;
+		for (std::size_t i = 0; i < p_phis.size(); i++)
+		{
+			p_photons[i] += batches[i];
+			G4double hits = total.countedHits.empty() ? 0 : total.countedHits[i];
+			if (hits >= targetHits || p_photons[i] >= maxPhotons)
+			{
+				batches[i] = 0;
+				continue;
+			}
+			// 10% margin so that most directions finish in the next round; without hits, double the photons
+			G4long needed = hits > 0 ? static_cast<G4long>(std::ceil(1.1 * p_photons[i] * targetHits / hits)) - p_photons[i] : p_photons[i];
+			G4long batch = std::min(std::max(needed, batchSize), maxPhotons - p_photons[i]);
+			batches[i] = static_cast<G4int>((batch + photonsPerEvent - 1) / photonsPerEvent * photonsPerEvent); // whole events
+			unfinished++;
+		}
+		log_info("Adaptive scan round {} finished, {} of {} directions need more photons", ++round, unfinished, p_phis.size());
+	}
+	return total;
+}
+
+/**
+ * @brief Simulates one representative again from a random symmetric direction and compares the effective areas.
+ * @details Logs the difference in units of the combined uncertainty, with a warning if it exceeds 3 sigma.
+ */
+void checkSymmetry(AngularScan *p_scanner, OMSimEffectiveAreaAnalyisis &p_analysisManager, const SymmetricScanPlanner &p_planner,
+				   const DirectionTally &p_reducedTally, const std::vector<G4long> &p_reducedPhotons)
+{
+	if (p_planner.getNumberOfOperations() < 2 || p_reducedTally.countedHits.empty())
+	{
+		log_warning("No symmetry to check");
+		return;
+	}
+	G4int numberOfReduced = static_cast<G4int>(p_reducedTally.countedHits.size());
+	G4int reducedIndex = std::min(static_cast<G4int>(G4UniformRand() * numberOfReduced), numberOfReduced - 1);
+	auto [phi, theta] = p_planner.randomImage(reducedIndex);
+	G4long photons = p_reducedPhotons.empty() ? OMSimCommandArgsTable::getInstance().get<G4int>("numevents") : p_reducedPhotons.at(reducedIndex);
+
+	p_scanner->runMultipleAngularScan({phi}, {theta}, {static_cast<G4int>(photons)});
+	DirectionTally image = OMSimEffectiveAreaAnalyisis::mergeDirectionTallies();
+	if (image.countedHits.empty() || p_reducedTally.countedHits.at(reducedIndex) == 0)
+	{
+		log_warning("Symmetry check at phi={} theta={} inconclusive, no hits", phi, theta);
+		return;
+	}
+
+	effectiveAreaResult reduced = p_analysisManager.calculateEffectiveArea(p_reducedTally.weightedHits.at(reducedIndex).back(), p_reducedTally.countedHits.at(reducedIndex), photons);
+	effectiveAreaResult symmetric = p_analysisManager.calculateEffectiveArea(image.weightedHits.at(0).back(), image.countedHits.at(0), photons);
+	G4double deviation = std::abs(reduced.EA - symmetric.EA) / std::sqrt(reduced.EAError * reduced.EAError + symmetric.EAError * symmetric.EAError);
+	if (deviation > 3)
+		log_warning("Symmetry check failed: EA at phi={} theta={} is {} +- {} cm^2, but {} +- {} cm^2 at phi={} theta={} ({:.1f} sigma)",
+					phi, theta, symmetric.EA, symmetric.EAError, reduced.EA, reduced.EAError, p_planner.getReducedPhis().at(reducedIndex), p_planner.getReducedThetas().at(reducedIndex), deviation);
+	else
+		log_info("Symmetry check passed: EA at phi={} theta={} agrees with its representative within {:.1f} sigma", phi, theta, deviation);
+}
+
+/**
+ * @brief Simulates only the fundamental domain of the module symmetry and writes the expanded scan (see SymmetricScanPlanner).
+ */
+void runSymmetricScan(AngularScan *p_scanner, OMSimEffectiveAreaAnalyisis &p_analysisManager, const ModuleSymmetry &p_symmetry,
+					  const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	SymmetricScanPlanner planner(p_symmetry, p_phis, p_thetas);
+
+	DirectionTally reducedTally;
+	std::vector<G4long> reducedPhotons;
+	if (args.keyExists("target_error"))
+	{
+		reducedTally = runAdaptiveScan(p_scanner, planner.getReducedPhis(), planner.getReducedThetas(), reducedPhotons);
+	}
+	else
+	{
+		p_scanner->runMultipleAngularScan(planner.getReducedPhis(), planner.getReducedThetas());
+		reducedTally = OMSimEffectiveAreaAnalyisis::mergeDirectionTallies();
+	}
+
+	if (args.get<bool>("symmetry_check"))
+		checkSymmetry(p_scanner, p_analysisManager, planner, reducedTally, reducedPhotons);
+
+	p_analysisManager.writeDirectionScans(p_phis, p_thetas, args.get<G4double>("wavelength"), planner.expandTally(reducedTally), planner.expandPhotons(reducedPhotons));
+}
+
+/**
+ * @brief Runs the points of a scan plan (parameters phi and theta in deg, optionally wavelength in nm) in a single run.
+ * @see OMSimScanPlan, OMSimScanQueue
+ */
+void runScanPlan(AngularScan *p_scanner, OMSimEffectiveAreaAnalyisis &p_analysisManager)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	OMSimScanPlan plan(args.get<std::string>("scan_plan"));
+
+	std::vector<BeamConfiguration> beams;
+	for (const auto &point : plan.getPoints())
+		beams.push_back(p_scanner->getBeamConfiguration(point.get("phi"), point.get("theta"), point.get("wavelength", args.get<G4double>("wavelength"))));
+
+	const std::vector<std::string> &names = plan.getParameterNames();
+	if (!args.get<bool>("no_header"))
+		p_analysisManager.writePlanHeader(names);
+
+	OMSimScanQueue::run(plan, beams, OMSimHitManager::getInstance().getNumberOfPMTs(), p_analysisManager.m_outputFileName,
+						[&](std::ostream &p_output, const ScanPoint &p_point, const ScanPointTally &p_tally)
+						{ p_analysisManager.writePlanPoint(p_output, names, p_point, p_tally); });
+	OMSimHitManager::getInstance().reset();
+}
+
+/**
+ * @brief Defines the wavelength distribution of the photons and the bins of the analysis from --wavelengths or --wavelength_spectrum.
+ *
+ * Listed wavelengths get one bin each (edges halfway between neighbours); a spectrum is binned with wavelength_bin_width.
+ */
+void configureWavelengthBins(AngularScan *p_scanner)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	std::vector<G4double> centres;
+	std::vector<G4double> edges;
+	if (args.keyExists("wavelength_spectrum"))
+	{
+		std::vector<G4PV2DDataVector> data = Tools::loadtxt(args.get<std::string>("wavelength_spectrum"), true);
+		std::vector<G4double> x = data.at(0);
+		std::vector<G4double> y = data.at(1);
+		p_scanner->setWavelengthDistribution({}, x, y);
+
+		G4double width = args.get<G4double>("wavelength_bin_width");
+		if (width <= 0)
+			throw std::invalid_argument("wavelength_bin_width must be positive!");
+		G4double minimum = *std::min_element(x.begin(), x.end());
+		G4double maximum = *std::max_element(x.begin(), x.end());
+		G4int numberOfBins = std::max(1, static_cast<G4int>(std::ceil((maximum - minimum) / width - 1e-9)));
+		for (G4int i = 0; i <= numberOfBins; i++)
+			edges.push_back(std::min(minimum + i * width, maximum));
+		for (std::size_t i = 0; i + 1 < edges.size(); i++)
+			centres.push_back(0.5 * (edges[i] + edges[i + 1]));
+	}
+	else
+	{
+		centres = args.get<std::vector<G4double>>("wavelengths");
+		std::sort(centres.begin(), centres.end());
+		centres.erase(std::unique(centres.begin(), centres.end()), centres.end());
+		p_scanner->setWavelengthDistribution(centres, {}, {});
+
+		G4double halfGap = centres.size() > 1 ? 0.5 * (centres[1] - centres[0]) : 1;
+		edges.push_back(centres.front() - halfGap);
+		for (std::size_t i = 0; i + 1 < centres.size(); i++)
+			edges.push_back(0.5 * (centres[i] + centres[i + 1]));
+		edges.push_back(centres.back() + (centres.size() > 1 ? 0.5 * (centres.back() - centres[centres.size() - 2]) : 1));
+	}
+	OMSimEffectiveAreaAnalyisis::setWavelengthBins(centres, edges);
+	log_info("Multi-wavelength scan with {} wavelength bins", centres.size());
+}
+
+/**
+ * @brief Simulates all directions in a single run with photons of many wavelengths, and writes the effective area per
+ * direction and wavelength bin, each normalised to the photons simulated in that bin.
+ */
+void runMultiWavelengthScan(AngularScan *p_scanner, OMSimEffectiveAreaAnalyisis &p_analysisManager,
+							const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	if (args.keyExists("target_error") || args.get<bool>("use_symmetry") || args.keyExists("pilot_photons"))
+		throw std::invalid_argument("Multi-wavelength scans can not be combined with target_error, use_symmetry or pilot_photons!");
+
+	configureWavelengthBins(p_scanner);
+	if (!args.get<bool>("no_header"))
+		p_analysisManager.writeHeader("Phi", "Theta", "Wavelength", "Photons");
+	p_scanner->runMultipleAngularScan(p_phis, p_thetas);
+	p_analysisManager.writeWavelengthScans(p_phis, p_thetas, OMSimEffectiveAreaAnalyisis::mergeDirectionTallies());
+	OMSimEffectiveAreaAnalyisis::setWavelengthBins({}, {});
+	OMSimHitManager::getInstance().reset();
+}
+
+/**
+ * @brief Simulates all directions with an importance-sampled beam footprint and writes their weighted effective areas.
+ *
+ * A uniform pilot run (pilot_photons per direction) records the hits per footprint cell of each direction. The production
+ * run (numevents photons per direction) draws the cells with probability importance_mixing / cells + (1 - importance_mixing) *
+ * pilot hits of the cell / pilot hits, so cells without pilot hits are still sampled and the weighted result is unbiased.
+ * Only the production run enters the result.
+ */
+void runImportanceSampledScan(AngularScan *p_scanner, OMSimEffectiveAreaAnalyisis &p_analysisManager,
+							  const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	if (args.keyExists("target_error") || args.get<bool>("use_symmetry"))
+		throw std::invalid_argument("Importance sampling can not be combined with target_error or use_symmetry!");
+	G4double mixing = args.get<G4double>("importance_mixing");
+	if (mixing <= 0 || mixing > 1)
+		throw std::invalid_argument("importance_mixing must be in (0, 1]!");
+
+	G4int rings = args.get<G4int>("footprint_rings");
+	G4int sectors = args.get<G4int>("footprint_sectors");
+	std::size_t numberOfCells = static_cast<std::size_t>(rings * sectors);
+	p_scanner->setFootprintCells(rings, sectors);
+
+	G4int pilotPhotons = args.get<G4int>("pilot_photons");
+	p_scanner->runMultipleAngularScan(p_phis, p_thetas, std::vector<G4int>(p_phis.size(), pilotPhotons));
+	DirectionTally pilot = OMSimEffectiveAreaAnalyisis::mergeDirectionTallies();
+
+	std::vector<std::vector<G4double>> footprints;
+	for (std::size_t i = 0; i < p_phis.size(); i++)
+	{
+		std::vector<double> cellHits = i < pilot.footprintHits.size() ? pilot.footprintHits[i] : std::vector<double>();
+		cellHits.resize(numberOfCells, 0.0);
+		G4double totalHits = std::accumulate(cellHits.begin(), cellHits.end(), 0.0);
+		std::vector<G4double> probabilities(numberOfCells, 1. / numberOfCells);
+		if (totalHits > 0)
+			for (std::size_t cell = 0; cell < numberOfCells; cell++)
+				probabilities[cell] = mixing / numberOfCells + (1 - mixing) * cellHits[cell] / totalHits;
+		else
+			log_warning("No pilot hits at phi={} theta={}, sampling its footprint uniformly", p_phis.at(i), p_thetas.at(i));
+		footprints.push_back(probabilities);
+	}
+	log_info("Pilot run with {} photons per direction finished, sampling the footprints of {} directions", pilotPhotons, p_phis.size());
+
+	p_scanner->setFootprintProbabilities(footprints);
+	p_scanner->runMultipleAngularScan(p_phis, p_thetas);
+	p_analysisManager.writeDirectionScans(p_phis, p_thetas, args.get<G4double>("wavelength"), OMSimEffectiveAreaAnalyisis::mergeDirectionTallies());
+	p_scanner->setFootprintCells(0, 0);
+	OMSimHitManager::getInstance().reset();
+}
+
+/**
+ * @brief Simulates the direction given by phi and theta once per value of photons_per_event_scan and logs the photon
+ * throughput of each run, for choosing photons_per_event. Nothing is written to the output file.
+ *
+ * Each run simulates numevents photons, so numevents must be a multiple of every value. A first run with the first value
+ * is not timed, as it builds the physics tables.
+ */
+void runPhotonsPerEventScan(AngularScan *p_scanner)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	std::vector<G4int> photonsPerEvent = args.get<std::vector<G4int>>("photons_per_event_scan");
+	G4double phi = args.get<G4double>("phi");
+	G4double theta = args.get<G4double>("theta");
+	G4int photons = args.get<G4int>("numevents");
+	for (G4int value : photonsPerEvent)
+		if (value < 1 || photons % value != 0)
+			throw std::invalid_argument(fmt::format("numevents ({}) must be a multiple of each value of photons_per_event_scan, got {}!", photons, value));
+
+	OMSimPhotonBeamGenerator::setPhotonsPerEvent(photonsPerEvent.front());
+	p_scanner->runSingleAngularScan(phi, theta);
+	OMSimHitManager::getInstance().reset();
+
+	G4double firstRate = 0;
+	for (G4int value : photonsPerEvent)
+	{
+		OMSimPhotonBeamGenerator::setPhotonsPerEvent(value);
+		auto start = std::chrono::steady_clock::now();
+		p_scanner->runSingleAngularScan(phi, theta);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		OMSimHitManager::getInstance().reset();
+		G4double rate = photons / elapsed.count();
+		if (firstRate == 0)
+			firstRate = rate;
+		log_info("photons_per_event {:>4}: {} photons in {:.3f} s, {:.4g} photons/s (x{:.2f})", value, photons, elapsed.count(), rate, rate / firstRate);
+	}
+	OMSimPhotonBeamGenerator::setPhotonsPerEvent(0);
+}
+
+/**
+ * @param p_symmetry Symmetry of the module, for use_symmetry.
+ * @param p_cullVolume Bounding volume of the detector; photons missing it are not tracked (disabled unless cull_misses is given).
+ */
+void runEffectiveAreaSimulation(const ModuleSymmetry &p_symmetry, const BeamCullVolume &p_cullVolume)
 {
 	OMSimEffectiveAreaAnalyisis analysisManager;
 	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
 	OMSimHitManager &hitManager = OMSimHitManager::getInstance();
 	AngularScan *scanner = new AngularScan(args.get<G4double>("radius"), args.get<G4double>("distance"), args.get<G4double>("wavelength"));
+	scanner->setCullVolume(p_cullVolume);
 
 	analysisManager.m_outputFileName = args.get<std::string>("output_file") + ".dat";
 
-	bool writeHeader = !args.get<bool>("no_header");
-	if (writeHeader) analysisManager.writeHeader("Phi", "Theta", "Wavelength");
+	if (args.keyExists("scan_plan"))
+	{
+		runScanPlan(scanner, analysisManager);
+		return;
+	}
 
-	// If angle file is provided, run over all angle pairs in file
+	if (args.keyExists("photons_per_event_scan"))
+	{
+		runPhotonsPerEventScan(scanner);
+		return;
+	}
+
+	bool adaptive = args.keyExists("target_error");
+	bool perRunScan = args.keyExists("angles_file") && !adaptive && !args.get<bool>("single_run") && !args.get<bool>("use_symmetry");
+
+	std::vector<G4double> thetas;
+	std::vector<G4double> phis;
 	if (args.keyExists("angles_file"))
 	{
 		std::vector<G4PV2DDataVector> data = Tools::loadtxt(args.get<std::string>("angles_file"), true);
-		std::vector<G4double> thetas = data.at(0);
-		std::vector<G4double> phis = data.at(1);
+		thetas = data.at(0);
+		phis = data.at(1);
+	}
+
+	if (args.keyExists("wavelengths") || args.keyExists("wavelength_spectrum"))
+	{
+		if (!args.keyExists("angles_file"))
+		{
+			phis = {args.get<G4double>("phi")};
+			thetas = {args.get<G4double>("theta")};
+		}
+		runMultiWavelengthScan(scanner, analysisManager, phis, thetas);
+		return;
+	}
+
+	if (args.keyExists("pilot_photons"))
+	{
+		if (!args.keyExists("angles_file"))
+		{
+			phis = {args.get<G4double>("phi")};
+			thetas = {args.get<G4double>("theta")};
+		}
+		if (!args.get<bool>("no_header"))
+			analysisManager.writeHeader("Phi", "Theta", "Wavelength");
+		runImportanceSampledScan(scanner, analysisManager, phis, thetas);
+		return;
+	}
+
+	// Only the scan with one run per angle pair can be resumed; the other modes simulate all directions in the same runs
+	std::unique_ptr<OMSimScanJournal> journal;
+	if (perRunScan)
+		journal = std::make_unique<OMSimScanJournal>("angular_scan", analysisManager.m_outputFileName, thetas.size());
+
+	bool writeHeader = !args.get<bool>("no_header") && !(journal && journal->isResuming());
+	if (writeHeader && adaptive) analysisManager.writeHeader("Phi", "Theta", "Wavelength", "Photons");
+	else if (writeHeader) analysisManager.writeHeader("Phi", "Theta", "Wavelength");
+
+	// If angle file is provided, run over all angle pairs in file
+	if (args.keyExists("angles_file"))
+	{
 
+		if (args.get<bool>("use_symmetry"))
+		{
+			runSymmetricScan(scanner, analysisManager, p_symmetry, phis, thetas);
+			hitManager.reset();
+			return;
+		}
+
+		if (adaptive)
+		{
+			std::vector<G4long> photons;
+			DirectionTally tally = runAdaptiveScan(scanner, phis, thetas, photons);
+			analysisManager.writeDirectionScans(phis, thetas, args.get<G4double>("wavelength"), tally, photons);
+			hitManager.reset();
+			return;
+		}
+
+		if (args.get<bool>("single_run"))
+		{
+			scanner->runMultipleAngularScan(phis, thetas);
+			analysisManager.writeDirectionScans(phis, thetas, args.get<G4double>("wavelength"), OMSimEffectiveAreaAnalyisis::mergeDirectionTallies());
+			hitManager.reset();
+			return;
+		}
+
+		journal->recordStart();
 		for (std::vector<int>::size_type i = 0; i != thetas.size(); i++)
 		{
+			if (journal->isCompleted(i))
+				continue;
 			scanner->runSingleAngularScan(phis.at(i), thetas.at(i));
 			analysisManager.writeScan(phis.at(i), thetas.at(i),  args.get<G4double>("wavelength"));
 			hitManager.reset();
+			journal->recordCompleted(i);
 		}
 	}
 	// If file with angle pairs was not provided, use the angle pairs provided through command-line arguments
+	else if (adaptive)
+	{
+		std::vector<G4double> phis = {args.get<G4double>("phi")};
+		std::vector<G4double> thetas = {args.get<G4double>("theta")};
+		std::vector<G4long> photons;
+		DirectionTally tally = runAdaptiveScan(scanner, phis, thetas, photons);
+		analysisManager.writeDirectionScans(phis, thetas, args.get<G4double>("wavelength"), tally, photons);
+		hitManager.reset();
+	}
 	else
 	{
 		scanner->runSingleAngularScan(args.get<G4double>("phi"), args.get<G4double>("theta"));
@@ -63,7 +457,22 @@ void addModuleOptions(OMSim* p_simulation)
 	("theta,t", po::value<G4double>()->default_value(0.0), "theta (= zenith) in deg")
 	("phi,f", po::value<G4double>()->default_value(0.0), "phi (= azimuth) in deg")
 	("wavelength,l", po::value<G4double>()->default_value(400.0), "wavelength of incoming light in nm")
+	("wavelengths", po::value<std::vector<G4double>>()->multitoken(), "wavelengths in nm; if given, each photon gets one of them at random and the effective area is written per direction and wavelength from a single run")
+	("wavelength_spectrum", po::value<std::string>(), "file with two columns, wavelength in nm and spectral density; if given, photon wavelengths are drawn from it and the effective area is written per direction and wavelength bin from a single run")
+	("wavelength_bin_width", po::value<G4double>()->default_value(10.0), "width in nm of the wavelength bins of wavelength_spectrum")
 	("angles_file,i", po::value<std::string>(), "The input angle pairs file to be scanned. The file should contain two columns, the first column with the theta (zenith) and the second with phi (azimuth) in degrees.")
+	("scan_plan", po::value<std::string>(), "json scan plan (grid, list or random design of phi, theta and optionally wavelength) run in a single run, see OMSimScanPlan")
+	("single_run", po::bool_switch(), "if given, all angle pairs of angles_file are simulated in a single run (numevents photons each), with hits tallied per direction")
+	("target_error", po::value<G4double>(), "if given, photons are simulated in batches (the first with numevents photons) until the relative error of the effective area of each direction is below this value, or max_photons is reached")
+	("max_photons", po::value<G4int>()->default_value(10000000), "maximum number of photons per direction when target_error is given")
+	("use_symmetry", po::bool_switch(), "if given together with angles_file, only the directions in the fundamental domain of the module symmetry are simulated and the results are expanded to all angle pairs (requires a module without harness)")
+	("symmetry_check", po::bool_switch(), "with use_symmetry, simulate one random symmetric image of a simulated direction and compare the effective areas")
+	("pilot_photons", po::value<G4int>(), "if given, a pilot run with this many photons per direction maps the hits over the beam footprint, and the numevents photons per direction of the production run are importance sampled from that map (weighted effective areas)")
+	("footprint_rings", po::value<G4int>()->default_value(16), "number of equal-area rings of the beam footprint map of pilot_photons")
+	("footprint_sectors", po::value<G4int>()->default_value(32), "number of sectors of each ring of the beam footprint map")
+	("importance_mixing", po::value<G4double>()->default_value(0.1), "fraction of the production photons of pilot_photons that are sampled uniformly over the footprint, keeps the result unbiased where the pilot had no hits")
+	("photons_per_event_scan", po::value<std::vector<G4int>>()->multitoken(), "if given, only the direction of phi and theta is simulated, once per value of photons per event, and the photons/s of each run are logged (e.g. 1 4 16 64); nothing is written")
+	("cull_misses", po::bool_switch(), "if given, photons of the plane wave whose straight line misses the bounding sphere or cylinder of the detector are counted but not tracked (only in a non-scattering medium)")
 	("no_header", po::bool_switch(), "if given, the header of the output file will not be written");
 
 	p_simulation->extendOptions(effectiveAreaOptions);
@@ -80,9 +489,13 @@ int main(int p_argCount, char *p_argumentVector[])
 
 	std::unique_ptr<OMSimEffectiveAreaDetector> detectorConstruction = std::make_unique<OMSimEffectiveAreaDetector>();
 	simulation.initialiseSimulation(detectorConstruction.get());
-	detectorConstruction.release();
+	OMSimEffectiveAreaDetector *detector = detectorConstruction.release();
+
+	BeamCullVolume cullVolume;
+	if (OMSimCommandArgsTable::getInstance().get<bool>("cull_misses"))
+		cullVolume = detector->getBoundingVolume();
 
-	runEffectiveAreaSimulation();
+	runEffectiveAreaSimulation(detector->getModuleSymmetry(), cullVolume);
 
 	if (OMSimCommandArgsTable::getInstance().get<bool>("visual"))
 		simulation.startVisualisation();
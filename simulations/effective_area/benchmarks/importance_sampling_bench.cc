@@ -0,0 +1,253 @@
+/**
+ * @file importance_sampling_bench.cc
+ * @brief Error of the importance-sampled beam footprint (--pilot_photons) against a uniform beam with the same photons.
+ *
+ * Toy module: a sphere of 178 mm radius (mDOM pressure vessel) whose only detecting region is a cap of 30 deg half-angle
+ * around +z with detection probability 0.25, hit by straight photons of a 300 mm disc beam (the study defaults). The
+ * effective area of each direction is estimated many times with
+ * - a uniform beam with pilot + production photons,
+ * - the importance-sampled footprint of runImportanceSampledScan: a uniform pilot run, then the production photons drawn
+ *   from the footprint cells (equal-area rings x sectors) with probability mixing / cells + (1 - mixing) * pilot hits of
+ *   the cell / pilot hits and weighted with (1 / cells) / probability, as OMSimPhotonBeamGenerator::sampleFootprintCell,
+ * and the relative RMS deviation from the exact effective area (quadrature over the cap) is printed for both. The mean
+ * error reported by the study (1 / sqrt(effective hits)) is printed next to it. Directions run from frontal (theta = 0, the
+ * cap faces the beam) to grazing (theta = 110 deg, only the edge of the cap is visible).
+ *
+ * The return code is non-zero if a mean effective area deviates from the exact one by more than 4 standard errors.
+ *
+ * Usage: importance_sampling_bench [photons per estimate] [repetitions]
+ * @ingroup EffectiveArea
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const double g_moduleRadius = 178.;   // mm
+  const double g_beamRadius = 300.;     // mm
+  const double g_capCosine = std::cos(30. * M_PI / 180.);
+  const double g_detectionProbability = 0.25;
+  const int g_rings = 16;               // --footprint_rings default
+  const int g_sectors = 32;             // --footprint_sectors default
+  const double g_mixing = 0.1;          // --importance_mixing default
+
+  struct Vec3
+  {
+    double x, y, z;
+    Vec3 operator*(double p_factor) const { return {x * p_factor, y * p_factor, z * p_factor}; }
+    Vec3 operator+(const Vec3 &p_other) const { return {x + p_other.x, y + p_other.y, z + p_other.z}; }
+    double dot(const Vec3 &p_other) const { return x * p_other.x + y * p_other.y + z * p_other.z; }
+  };
+
+  /**
+   * @brief Beam direction d (photons travel along -d) and two axes spanning the beam plane.
+   */
+  struct Beam
+  {
+    Vec3 axis, u, v;
+
+    explicit Beam(double p_theta)
+    {
+      const double theta = p_theta * M_PI / 180.;
+      axis = {std::sin(theta), 0, std::cos(theta)};
+      u = {std::cos(theta), 0, -std::sin(theta)};
+      v = {0, 1, 0};
+    }
+
+    /**
+     * @brief Detection weight of the photon starting at (x, y) in the beam plane.
+     */
+    double detect(double p_x, double p_y) const
+    {
+      const double rho2 = p_x * p_x + p_y * p_y;
+      if (rho2 >= g_moduleRadius * g_moduleRadius)
+        return 0.;
+      const Vec3 hit = u * p_x + v * p_y + axis * std::sqrt(g_moduleRadius * g_moduleRadius - rho2);
+      return hit.z >= g_capCosine * g_moduleRadius ? g_detectionProbability : 0.;
+    }
+  };
+
+  double beamArea()
+  {
+    return M_PI * g_beamRadius * g_beamRadius;
+  }
+
+  /**
+   * @brief Exact effective area: detection probability times the projected area of the visible part of the cap.
+   */
+  double exactEffectiveArea(const Beam &p_beam)
+  {
+    const std::size_t polarSteps = 4000, azimuthSteps = 4000;
+    const double capAngle = std::acos(g_capCosine);
+    double projected = 0;
+    for (std::size_t i = 0; i < polarSteps; ++i)
+    {
+      const double polar = capAngle * (i + 0.5) / polarSteps;
+      for (std::size_t j = 0; j < azimuthSteps; ++j)
+      {
+        const double azimuth = 2. * M_PI * (j + 0.5) / azimuthSteps;
+        const Vec3 normal{std::sin(polar) * std::cos(azimuth), std::sin(polar) * std::sin(azimuth), std::cos(polar)};
+        projected += std::max(0., normal.dot(p_beam.axis)) * std::sin(polar);
+      }
+    }
+    projected *= g_moduleRadius * g_moduleRadius * capAngle / polarSteps * 2. * M_PI / azimuthSteps;
+    return g_detectionProbability * projected;
+  }
+
+  /**
+   * @brief Effective area and the error the study reports for it.
+   */
+  struct Estimate
+  {
+    double effectiveArea, reportedError;
+  };
+
+  /**
+   * @brief Point in cell of the footprint, as OMSimPhotonBeamGenerator::sampleBeamPosition (cell < 0: whole disc).
+   */
+  template <typename Engine>
+  void samplePosition(int p_cell, Engine &p_engine, double &p_x, double &p_y)
+  {
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    double radial = uniform(p_engine), angular = uniform(p_engine);
+    if (p_cell >= 0)
+    {
+      radial = (p_cell / g_sectors + radial) / g_rings;
+      angular = (p_cell % g_sectors + angular) / g_sectors;
+    }
+    const double r = g_beamRadius * std::sqrt(radial);
+    p_x = r * std::cos(2. * M_PI * angular);
+    p_y = r * std::sin(2. * M_PI * angular);
+  }
+
+  template <typename Engine>
+  Estimate estimateUniform(const Beam &p_beam, std::size_t p_photons, Engine &p_engine)
+  {
+    double weightedHits = 0, hits = 0;
+    for (std::size_t k = 0; k < p_photons; ++k)
+    {
+      double x, y;
+      samplePosition(-1, p_engine, x, y);
+      const double weight = p_beam.detect(x, y);
+      weightedHits += weight;
+      hits += weight > 0;
+    }
+    const double effectiveArea = weightedHits * beamArea() / p_photons;
+    return {effectiveArea, hits > 0 ? effectiveArea / std::sqrt(hits) : 0.};
+  }
+
+  template <typename Engine>
+  Estimate estimateImportanceSampled(const Beam &p_beam, std::size_t p_pilotPhotons, std::size_t p_photons, Engine &p_engine)
+  {
+    const int cells = g_rings * g_sectors;
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    // Pilot run: uniform cells, detection-weighted hits per cell
+    std::vector<double> cellHits(cells, 0.);
+    for (std::size_t k = 0; k < p_pilotPhotons; ++k)
+    {
+      const int cell = std::min(static_cast<int>(uniform(p_engine) * cells), cells - 1);
+      double x, y;
+      samplePosition(cell, p_engine, x, y);
+      cellHits[cell] += p_beam.detect(x, y);
+    }
+    double totalHits = 0;
+    for (double hits : cellHits)
+      totalHits += hits;
+    std::vector<double> cdf(cells);
+    double sum = 0;
+    for (int cell = 0; cell < cells; ++cell)
+    {
+      sum += totalHits > 0 ? g_mixing / cells + (1 - g_mixing) * cellHits[cell] / totalHits : 1. / cells;
+      cdf[cell] = sum;
+    }
+    for (double &value : cdf)
+      value /= sum;
+
+    // Production run
+    double weightedHits = 0, hitWeights = 0, hitWeightSquares = 0;
+    for (std::size_t k = 0; k < p_photons; ++k)
+    {
+      const int cell = std::min(static_cast<int>(std::upper_bound(cdf.begin(), cdf.end(), uniform(p_engine)) - cdf.begin()), cells - 1);
+      const double probability = cdf[cell] - (cell > 0 ? cdf[cell - 1] : 0.);
+      const double importanceWeight = 1. / (cells * probability);
+      double x, y;
+      samplePosition(cell, p_engine, x, y);
+      const double weight = p_beam.detect(x, y);
+      if (weight <= 0)
+        continue;
+      weightedHits += importanceWeight * weight;
+      hitWeights += importanceWeight;
+      hitWeightSquares += importanceWeight * importanceWeight;
+    }
+    const double effectiveArea = weightedHits * beamArea() / p_photons;
+    const double effectiveHits = hitWeightSquares > 0 ? hitWeights * hitWeights / hitWeightSquares : 0.;
+    return {effectiveArea, effectiveHits > 0 ? effectiveArea / std::sqrt(effectiveHits) : 0.};
+  }
+
+  /**
+   * @brief Relative RMS deviation from the exact value, mean reported relative error and pull of the mean.
+   */
+  struct ErrorSummary
+  {
+    double rmsError, reportedError, pull;
+  };
+
+  ErrorSummary summarise(const std::vector<Estimate> &p_estimates, double p_exact)
+  {
+    double squares = 0, mean = 0, reported = 0;
+    for (const Estimate &estimate : p_estimates)
+    {
+      squares += std::pow(estimate.effectiveArea / p_exact - 1, 2);
+      mean += estimate.effectiveArea / p_exact - 1;
+      reported += estimate.reportedError / p_exact;
+    }
+    const double n = p_estimates.size();
+    const double rms = std::sqrt(squares / n);
+    mean /= n;
+    return {rms, reported / n, rms > 0 ? mean / (rms / std::sqrt(n)) : 0.};
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const std::size_t photons = argc > 1 ? std::stoul(argv[1]) : 100000;
+  const std::size_t repetitions = argc > 2 ? std::stoul(argv[2]) : 200;
+  const std::size_t pilotPhotons = photons / 10;
+  const double maxPull = 4.;
+
+  std::mt19937_64 engine(12345);
+  bool passed = true;
+  std::printf("Effective area error with %zu photons per estimate (importance: %zu pilot + %zu production), %zu estimates\n",
+              photons, pilotPhotons, photons - pilotPhotons, repetitions);
+  std::printf("  %5s %12s %10s %10s %10s %10s %14s\n", "theta", "exact [mm2]", "uniform", "reported", "importance", "reported", "photon factor");
+  for (double theta : {0., 60., 90., 110.})
+  {
+    const Beam beam(theta);
+    const double exact = exactEffectiveArea(beam);
+    std::vector<Estimate> uniform, importance;
+    for (std::size_t r = 0; r < repetitions; ++r)
+    {
+      uniform.push_back(estimateUniform(beam, photons, engine));
+      importance.push_back(estimateImportanceSampled(beam, pilotPhotons, photons - pilotPhotons, engine));
+    }
+    const ErrorSummary uniformError = summarise(uniform, exact);
+    const ErrorSummary importanceError = summarise(importance, exact);
+    passed = passed && std::abs(uniformError.pull) < maxPull && std::abs(importanceError.pull) < maxPull;
+
+    // Photons a uniform beam needs for the error of the importance-sampled one, relative to the photons used
+    const double photonFactor = std::pow(uniformError.rmsError / importanceError.rmsError, 2);
+    std::printf("  %5.0f %12.1f %10.2e %10.2e %10.2e %10.2e %14.2f\n", theta, exact, uniformError.rmsError, uniformError.reportedError,
+                importanceError.rmsError, importanceError.reportedError, photonFactor);
+    std::printf("        pull of the mean: uniform %.2f, importance %.2f\n", uniformError.pull, importanceError.pull);
+  }
+
+  std::printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
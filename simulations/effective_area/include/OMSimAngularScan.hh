@@ -1,20 +1,56 @@
 /**
  * @file OMSimAngularScan.hh
- * @brief Defines the AngularScan class for configuring and running GPS beam with angular scans.
+ * @brief Defines the AngularScan class for configuring and running plane wave beams with angular scans.
  * @ingroup EffectiveArea
  */
 
 #pragma once
 
 #include "globals.hh"
+#include "OMSimPhotonBeamGenerator.hh"
+#include <G4ThreeVector.hh>
+#include <G4VUserEventInformation.hh>
+#include <vector>
+
+/**
+ * @brief Position and orientation of the plane wave for one direction of incidence.
+ */
+struct BeamGeometry
+{
+  G4ThreeVector centre; ///< Centre of the emitting disc.
+  G4ThreeVector rot1;   ///< First axis of the disc plane, also used as angular reference axis 1.
+  G4ThreeVector rot2;   ///< Second axis of the disc plane, also used as angular reference axis 2.
+  std::vector<G4double> footprintProbabilities; ///< Probability of each footprint cell, empty for equal probabilities (see BeamConfiguration).
+};
+
+/**
+ * @class ScanDirectionInformation
+ * @brief Event information carrying the index of the scanned direction of the event in a multi-direction run.
+ * @ingroup EffectiveArea
+ */
+class ScanDirectionInformation : public G4VUserEventInformation
+{
+public:
+  ScanDirectionInformation(G4int p_directionIndex) : m_directionIndex(p_directionIndex){};
+  void Print() const override { G4cout << "Scan direction index: " << m_directionIndex << G4endl; };
+  G4int getDirectionIndex() const { return m_directionIndex; };
+
+private:
+  G4int m_directionIndex;
+};
+
 /**
  * @class AngularScan
- * @brief Class for defining and running simple GPS beam configurations with angular scans.
+ * @brief Class for defining and running plane wave beam configurations with angular scans.
  *
- * The AngularScan class provides functionalities to configure and run simple GPS beam configurations
+ * The AngularScan class provides functionalities to configure and run plane wave beams (see OMSimPhotonBeamGenerator)
  * with angular scans. It allows setting the beam radius, beam distance, and wavelength of the photons
  * to be generated. It also supports specifying the angle of incidence with respect to the target
  * and performs the simulation for each angular configuration.
+ *
+ * With runMultipleAngularScan all directions are simulated in a single run: the events are assigned to the directions
+ * in order (see getDirectionOfEvent), and OMSimPrimaryGeneratorAction places the beam for each event accordingly (see ScanDirectionInformation).
+ * The disc can be divided into footprint cells, each direction with its own cell probabilities (importance sampling).
  * @ingroup EffectiveArea
  */
 class AngularScan
@@ -26,16 +62,38 @@ public:
 
 
   void configureScan();
+  BeamConfiguration getBeamConfiguration(G4double pPhi, G4double pTheta, G4double pWavelength) const;
+  void setWavelengthDistribution(const std::vector<G4double> &pWavelengths, const std::vector<G4double> &pSpectrumX, const std::vector<G4double> &pSpectrumY);
+  void setCullVolume(const BeamCullVolume &pVolume) { m_cullVolume = pVolume; };
+  void setFootprintCells(G4int pRings, G4int pSectors);
+  void setFootprintProbabilities(const std::vector<std::vector<G4double>> &pProbabilities) { m_footprintProbabilities = pProbabilities; };
   void runSingleAngularScan(G4double pPhi, G4double pTheta);
+  void runMultipleAngularScan(const std::vector<G4double> &pPhis, const std::vector<G4double> &pThetas);
+  void runMultipleAngularScan(const std::vector<G4double> &pPhis, const std::vector<G4double> &pThetas, const std::vector<G4int> &pPhotons);
+
+  static BeamGeometry calculateBeamGeometry(G4double pPhi, G4double pTheta, G4double pBeamDistance);
+  static bool isMultiDirectionRun() { return !m_eventOffsets.empty(); };
+  static G4int getNumberOfDirections() { return static_cast<G4int>(m_directions.size()); };
+  static G4int getDirectionOfEvent(G4int pEventID);
+  static const BeamGeometry &getBeamGeometry(G4int pDirectionIndex) { return m_directions.at(pDirectionIndex); };
 
 private:
+  void logCulledPhotons(G4double pPhotons);
 
-  void configurePosCoordinates();
-  void configureAngCoordinates();
   G4double m_beamRadius;
   G4double m_beamDistance;
   G4double m_wavelength;
   G4double m_theta;
   G4double m_phi;
+  std::vector<G4double> m_wavelengthList;      ///< Wavelengths in nm drawn per photon, empty to use m_wavelength
+  std::vector<G4double> m_wavelengthSpectrumX; ///< Wavelengths in nm of the spectrum drawn per photon, empty if none
+  std::vector<G4double> m_wavelengthSpectrumY; ///< Spectral density at m_wavelengthSpectrumX
+  BeamCullVolume m_cullVolume;                 ///< Photons of the plane wave missing it are counted but not tracked, disabled by default
+  G4int m_footprintRings = 0;                  ///< Rings of the footprint cells of the plane wave, 0 for none
+  G4int m_footprintSectors = 0;                ///< Sectors of each footprint ring
+  std::vector<std::vector<G4double>> m_footprintProbabilities; ///< [direction][cell] footprint of each direction of the next multi-direction runs, empty for uniform cells
+
+  static std::vector<BeamGeometry> m_directions; ///< Beam geometry of each direction of the current multi-direction run
+  static std::vector<G4int> m_eventOffsets;      ///< Cumulative number of events up to and including each direction of the current multi-direction run, empty if none is running
 };
 
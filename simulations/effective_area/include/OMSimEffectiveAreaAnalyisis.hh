@@ -7,9 +7,15 @@
 
 #include "OMSimPMTResponse.hh"
 #include "OMSimHitManager.hh"
+#include "OMSimCommandArgsTable.hh"
+#include "OMSimScanQueue.hh"
 
 #include <G4ThreeVector.hh>
+#include <G4AutoLock.hh>
 #include <fstream>
+#include <memory>
+
+class G4Event;
 
 /**
  * @brief Struct to hold results of effective area calculations.
@@ -20,6 +26,24 @@ struct effectiveAreaResult
     double EAError; ///< Uncertainty of effective area.
 };
 
+/**
+ * @brief Hits of a multi-direction scan, accumulated per direction.
+ *
+ * In multi-wavelength runs (see OMSimEffectiveAreaAnalyisis::setWavelengthBins) each direction has one entry per
+ * wavelength bin: entry = direction * number of bins + bin.
+ * If the beam is divided into footprint cells (see OMSimPhotonBeamGenerator), weightedHits include the importance weight
+ * of each hit, and the hits per cell are kept to build the footprint of the next run.
+ */
+struct DirectionTally
+{
+    std::vector<std::vector<double>> weightedHits; ///< [entry][PMT] hits weighted with detection probability, last entry is the module total.
+    std::vector<double> countedHits;               ///< [entry] number of hits (unweighted) in the module.
+    std::vector<double> photons;                   ///< [entry] number of simulated photons.
+    std::vector<double> hitWeights;                ///< [entry] sum of the importance weights of the counted hits, empty if the beam had no footprint cells.
+    std::vector<double> hitWeightSquares;          ///< [entry] sum of the squared importance weights of the counted hits.
+    std::vector<std::vector<double>> footprintHits; ///< [direction][cell] hits weighted with detection probability (not importance weight) per footprint cell.
+};
+
 /**
  * @class OMSimEffectiveAreaAnalyisis
  * @brief Responsible for calculating the effective area of optical hits and saving the results.
@@ -36,8 +60,34 @@ public:
     template <typename... Args>
     void writeHeader(Args... p_args);
 
+    void writeDirectionScans(const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas, G4double p_wavelength,
+                             const DirectionTally &p_tally, const std::vector<G4long> &p_photons = {});
+
+    void writePlanHeader(const std::vector<std::string> &p_parameterNames);
+    void writePlanPoint(std::ostream &p_output, const std::vector<std::string> &p_parameterNames, const ScanPoint &p_point, const ScanPointTally &p_tally);
+
+    void writeWavelengthScans(const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas, const DirectionTally &p_tally);
+
+    static void setWavelengthBins(const std::vector<G4double> &p_centres, const std::vector<G4double> &p_edges);
+    static G4int getNumberOfWavelengthBins() { return m_wavelengthEdges.empty() ? 1 : static_cast<G4int>(m_wavelengthEdges.size()) - 1; };
+    static G4int getWavelengthBin(G4double p_wavelength);
+    static void tallyEvent(G4int p_directionIndex, const G4Event *p_event, const OMSimPhotonBeamGenerator &p_generator, const HitStats *p_hits);
+    static DirectionTally mergeDirectionTallies();
+    static void addDirectionTally(DirectionTally &p_total, const DirectionTally &p_tally);
+    static double getEffectiveHits(const DirectionTally &p_tally, std::size_t p_entry);
+
     effectiveAreaResult calculateEffectiveArea(double weightedTotal, double countTotal);
+    effectiveAreaResult calculateEffectiveArea(double weightedTotal, double countTotal, double numberPhotons);
     G4String m_outputFileName;
+
+private:
+    void writeHits(std::ostream &p_dataFile, const std::vector<double> &p_weightedHits, double p_totalHits, double p_numberPhotons);
+
+    static std::vector<G4double> m_wavelengthCentres; ///< Wavelength in nm written for each bin
+    static std::vector<G4double> m_wavelengthEdges;   ///< Bin edges in nm, empty if the run has a single wavelength
+    static G4Mutex m_mutex;
+    static std::vector<std::unique_ptr<DirectionTally>> m_threadTallies; ///< Tallies of all threads, owned here so they can be merged after the run
+    G4ThreadLocal static DirectionTally *m_threadTally;                  ///< Tally of the calling thread, registered in m_threadTallies on first use
 };
 
 /**
@@ -55,23 +105,8 @@ void OMSimEffectiveAreaAnalyisis::writeScan(Args... p_args)
     // Write all arguments to the file
     ((dataFile << p_args << "\t"), ...);
 
-    G4double weightedTotal = 0;
-    for (const auto &hit : hits)
-    {
-        dataFile << hit << "\t";
-        weightedTotal = hit;
-    }
-
-    hits = OMSimHitManager::getInstance().countMergedHits(); //unweighted
-    G4double totalHits = 0;
-    for (const auto &hit : hits)
-    {
-        totalHits = hit; 
-    }
-
-    effectiveAreaResult effectiveArea = calculateEffectiveArea(weightedTotal, totalHits);
-    dataFile << effectiveArea.EA << "\t" << effectiveArea.EAError << "\t";
-    dataFile << G4endl;
+    G4double totalHits = OMSimHitManager::getInstance().countMergedHits().back(); // unweighted
+    writeHits(dataFile, hits, totalHits, OMSimCommandArgsTable::getInstance().get<int>("numevents"));
     dataFile.close();
 }
 
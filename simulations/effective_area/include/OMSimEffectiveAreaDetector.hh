@@ -7,6 +7,7 @@
 #pragma once
 
 #include "OMSimDetectorConstruction.hh"
+#include "OMSimOpticalModule.hh"
 
 /**
  * @class OMSimEffectiveAreaDetector
@@ -19,7 +20,10 @@ public:
     OMSimEffectiveAreaDetector() : OMSimDetectorConstruction(){};
     ~OMSimEffectiveAreaDetector(){};
 
+    ModuleSymmetry getModuleSymmetry();
+
 private:
     void constructWorld();
     void constructDetector();
+    OMSimOpticalModule *m_opticalModule = nullptr;
 };
@@ -1,21 +1,17 @@
 #pragma once
  
-#include <G4VUserPrimaryGeneratorAction.hh>
-#include <G4AutoLock.hh>
-class G4GeneralParticleSource;
+#include "OMSimPhotonBeamGenerator.hh"
+
 class G4Event;
-class OMSimPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
+class OMSimPrimaryGeneratorAction : public OMSimPhotonBeamGenerator
 {
 public:
-	OMSimPrimaryGeneratorAction();
-	~OMSimPrimaryGeneratorAction();
+	OMSimPrimaryGeneratorAction(){};
+	~OMSimPrimaryGeneratorAction(){};
 
 public:
 	void GeneratePrimaries(G4Event* anEvent) override;
 
 private:
-    static thread_local std::unique_ptr<G4GeneralParticleSource> m_particleSource;
-	static G4Mutex m_mutex;
+	void setScanDirection(G4Event *p_event);
 };
-
-
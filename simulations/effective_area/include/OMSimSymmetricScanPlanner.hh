@@ -0,0 +1,52 @@
+/**
+ * @file OMSimSymmetricScanPlanner.hh
+ * @brief Defines the SymmetricScanPlanner class, which reduces angular scans to the fundamental domain of the module symmetry.
+ * @ingroup EffectiveArea
+ */
+
+#pragma once
+
+#include "OMSimEffectiveAreaAnalyisis.hh"
+#include "OMSimOpticalModule.hh"
+
+#include <utility>
+#include <vector>
+
+/**
+ * @class SymmetricScanPlanner
+ * @brief Maps the directions of an angular scan onto the fundamental domain of the module symmetry and expands the results back.
+ *
+ * Each scan direction is mapped onto a representative with phi in [0, 360/azimuthalOrder) deg (and theta <= 90 deg if the module has
+ * up-down symmetry), together with the symmetry operation that maps the representative back onto it. Only the distinct representatives
+ * are simulated; the hits of each direction are then those of its representative with the PMT indices permuted by the operation
+ * (a PMT at position p in the representative's scan corresponds to the PMT at the transformed position).
+ * @ingroup EffectiveArea
+ */
+class SymmetricScanPlanner
+{
+public:
+  SymmetricScanPlanner(const ModuleSymmetry &p_symmetry, const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas);
+
+  const std::vector<G4double> &getReducedPhis() const { return m_reducedPhis; };
+  const std::vector<G4double> &getReducedThetas() const { return m_reducedThetas; };
+  G4int getNumberOfOperations() const { return m_azimuthalOrder * (m_upDownMirror ? 2 : 1); };
+
+  DirectionTally expandTally(const DirectionTally &p_reducedTally) const;
+  std::vector<G4long> expandPhotons(const std::vector<G4long> &p_reducedPhotons) const;
+  std::pair<G4double, G4double> randomImage(G4int p_reducedIndex) const;
+
+private:
+  std::pair<G4double, G4double> applyOperation(G4int p_operation, G4double p_phi, G4double p_theta) const;
+  G4ThreeVector applyOperation(G4int p_operation, const G4ThreeVector &p_position) const;
+  void calculatePMTPermutations(const std::vector<G4ThreeVector> &p_PMTPositions);
+
+  G4int m_azimuthalOrder;
+  G4bool m_upDownMirror;
+  G4double m_sector; ///< Azimuthal width of the fundamental domain in deg.
+
+  std::vector<G4double> m_reducedPhis;
+  std::vector<G4double> m_reducedThetas;
+  std::vector<G4int> m_reducedIndex;                   ///< [scan direction] index of its representative in m_reducedPhis
+  std::vector<G4int> m_operation;                      ///< [scan direction] operation mapping the representative onto the direction
+  std::vector<std::vector<G4int>> m_PMTPermutation;    ///< [operation][PMT] index of the PMT the operation maps the PMT onto
+};
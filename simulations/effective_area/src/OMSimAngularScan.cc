@@ -1,6 +1,14 @@
 #include "OMSimAngularScan.hh"
+#include "OMSimCommandArgsTable.hh"
+#include "OMSimLogger.hh"
+#include "OMSimPhotonBeamGenerator.hh"
 #include "OMSimUIinterface.hh"
 #include <G4SystemOfUnits.hh>
+#include <algorithm>
+#include <limits>
+
+std::vector<BeamGeometry> AngularScan::m_directions;
+std::vector<G4int> AngularScan::m_eventOffsets;
 
 /**
  * @param p_beamRadius The radius of the beam.
@@ -12,67 +20,86 @@ AngularScan::AngularScan(G4double p_beamRadius, G4double p_beamDistance, G4doubl
 }
 
 /**
- * @brief Configures the position coordinates of the beam based on the polar and azimuthal angles.
+ * @brief Calculates the position and orientation of the plane wave for a direction of incidence.
+ * @param p_phi The azimuthal angle in radians.
+ * @param p_theta The polar angle in radians.
+ * @param p_beamDistance The distance of the beam from the origin in mm.
+ * @return Centre and plane axes of the beam.
  */
-void AngularScan::configurePosCoordinates()
+BeamGeometry AngularScan::calculateBeamGeometry(G4double p_phi, G4double p_theta, G4double p_beamDistance)
 {
-    double rho = m_beamDistance * sin(m_theta);
-    double x = rho * cos(m_phi);
-    double y = rho * sin(m_phi);
-    double z = m_beamDistance * cos(m_theta);
-    OMSimUIinterface &uiInterface = OMSimUIinterface::getInstance();
-    uiInterface.applyCommand("/gps/pos/centre", x, y, z, "mm");
-    uiInterface.applyCommand("/gps/pos/radius", m_beamRadius, "mm");
+    BeamGeometry beam;
+    double rho = p_beamDistance * sin(p_theta);
+    beam.centre = G4ThreeVector(rho * cos(p_phi), rho * sin(p_phi), p_beamDistance * cos(p_theta)) * mm;
+    beam.rot1 = G4ThreeVector(-sin(p_phi), cos(p_phi), 0);
+    beam.rot2 = G4ThreeVector(-cos(p_phi) * cos(p_theta), -sin(p_phi) * cos(p_theta), sin(p_theta));
+    return beam;
 }
 
 /**
- * @brief Configures the angular coordinates of the beam based on the polar and azimuthal angles.
+ * @brief Plane wave of this scanner (radius and distance) for a direction of incidence and wavelength.
+ * @param p_phi The azimuthal angle in degrees.
+ * @param p_theta The polar angle in degrees.
+ * @param p_wavelength The wavelength in nm, unless a wavelength distribution was set (see setWavelengthDistribution).
  */
-void AngularScan::configureAngCoordinates()
+BeamConfiguration AngularScan::getBeamConfiguration(G4double p_phi, G4double p_theta, G4double p_wavelength) const
 {
-    OMSimUIinterface &uiInterface = OMSimUIinterface::getInstance();
-    double x, y, z;
-    x = -sin(m_phi);
-    y = cos(m_phi);
-    z = 0;
-    uiInterface.applyCommand("/gps/pos/rot1", x, y, z);
-    uiInterface.applyCommand("/gps/ang/rot1", x, y, z);
-
-    x = -cos(m_phi) * cos(m_theta);
-    y = -sin(m_phi) * cos(m_theta);
-    z = sin(m_theta);
-
-    uiInterface.applyCommand("/gps/pos/rot2", x, y, z);
-    uiInterface.applyCommand("/gps/ang/rot2", x, y, z);
+    BeamGeometry geometry = calculateBeamGeometry(p_phi * deg, p_theta * deg, m_beamDistance);
+    BeamConfiguration beam;
+    beam.shape = BeamShape::Disc;
+    beam.radius = m_beamRadius * mm;
+    beam.centre = geometry.centre;
+    beam.rot1 = geometry.rot1;
+    beam.rot2 = geometry.rot2;
+    beam.angular = BeamAngularDistribution::Collimated;
+    beam.energy = 1239.84193 / p_wavelength * eV;
+    for (const auto &wavelength : m_wavelengthList)
+        beam.wavelengthList.push_back(wavelength * nm);
+    for (const auto &wavelength : m_wavelengthSpectrumX)
+        beam.wavelengthSpectrumX.push_back(wavelength * nm);
+    beam.wavelengthSpectrumY = m_wavelengthSpectrumY;
+    beam.cullVolume = m_cullVolume;
+    beam.footprintRings = m_footprintRings;
+    beam.footprintSectors = m_footprintSectors;
+    return beam;
 }
 
 /**
- * @brief Configure the GPS settings, such as the particle properties, beam position and direction.
+ * @brief Divides the plane wave into footprint cells of equal area, which multi-direction runs sample with the probabilities of setFootprintProbabilities.
+ * @param p_rings Number of rings, 0 for a disc without cells.
+ * @param p_sectors Number of sectors of each ring.
+ */
+void AngularScan::setFootprintCells(G4int p_rings, G4int p_sectors)
+{
+    m_footprintRings = p_rings;
+    m_footprintSectors = p_sectors;
+    m_footprintProbabilities.clear();
+}
+
+/**
+ * @brief Draws the wavelength of each photon from a list or a spectrum instead of using the fixed wavelength.
+ * @param p_wavelengths Wavelengths in nm, chosen with equal probability (ignored if a spectrum is given).
+ * @param p_spectrumX Wavelengths in nm of a piecewise linear spectrum (empty for none).
+ * @param p_spectrumY Spectral density at p_spectrumX.
+ */
+void AngularScan::setWavelengthDistribution(const std::vector<G4double> &p_wavelengths, const std::vector<G4double> &p_spectrumX, const std::vector<G4double> &p_spectrumY)
+{
+    m_wavelengthList = p_wavelengths;
+    m_wavelengthSpectrumX = p_spectrumX;
+    m_wavelengthSpectrumY = p_spectrumY;
+}
+
+/**
+ * @brief Configure the beam (photon energy, disc position and direction) of OMSimPhotonBeamGenerator.
  */
 void AngularScan::configureScan()
 {
-    // Obtain an instance of OMSimUIinterface
     OMSimUIinterface &uiInterface = OMSimUIinterface::getInstance();
-
-    // Use applyCommand to send commands
     uiInterface.applyCommand("/event/verbose 0");
     uiInterface.applyCommand("/control/verbose 0");
     uiInterface.applyCommand("/run/verbose 0");
-    uiInterface.applyCommand("/gps/particle opticalphoton");
-    uiInterface.applyCommand("/gps/energy", 1239.84193 / m_wavelength, "eV");
-    uiInterface.applyCommand("/gps/pos/type Plane");
-    uiInterface.applyCommand("/gps/pos/shape Circle");
-    uiInterface.applyCommand("/gps/pos/centre 0 0 30 cm");
-    uiInterface.applyCommand("/gps/pos/radius 80 mm");
-    uiInterface.applyCommand("/gps/pos/rot1 0 1 0");
-    uiInterface.applyCommand("/gps/pos/rot2 0 0 1");
-    uiInterface.applyCommand("/gps/ang/rot1 0 1 0");
-    uiInterface.applyCommand("/gps/ang/rot2 0 0 1");
-    uiInterface.applyCommand("/gps/ang/type beam2d");
-    uiInterface.applyCommand("/gps/ang/sigma_x 0");
-    uiInterface.applyCommand("/gps/ang/sigma_y 0");
-    configurePosCoordinates();
-    configureAngCoordinates();
+
+    OMSimPhotonBeamGenerator::setConfiguration(getBeamConfiguration(m_phi / deg, m_theta / deg, m_wavelength));
 }
 
 /**
@@ -86,5 +113,86 @@ void AngularScan::runSingleAngularScan(G4double p_phi, G4double p_theta)
     m_phi = p_phi * deg;
     configureScan();
     OMSimUIinterface &uiInterface = OMSimUIinterface::getInstance();
-    uiInterface.runBeamOn();
-}
\ No newline at end of file
+    uiInterface.runBeamOn(OMSimPhotonBeamGenerator::getNumberOfEvents());
+    logCulledPhotons(OMSimCommandArgsTable::getInstance().get<G4int>("numevents"));
+}
+
+/**
+ * @brief Logs the fraction of the photons of the last run that were culled (see BeamCullVolume) and resets the counter.
+ * @param p_photons Photons of the last run.
+ */
+void AngularScan::logCulledPhotons(G4double p_photons)
+{
+    if (!m_cullVolume.isEnabled() || p_photons <= 0)
+        return;
+    G4long culled = OMSimPhotonBeamGenerator::getNumberOfCulledPhotons();
+    log_debug("{} of {} photons ({:.1f}%) missed the bounding volume and were not tracked", culled, p_photons, 100. * culled / p_photons);
+    OMSimPhotonBeamGenerator::resetNumberOfCulledPhotons();
+}
+
+/**
+ * @brief Run all directions of a scan in a single run, numevents photons per direction.
+ * @param p_phis The azimuthal angles in degrees.
+ * @param p_thetas The polar angles in degrees, same size as p_phis.
+ */
+void AngularScan::runMultipleAngularScan(const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas)
+{
+    G4int photonsPerDirection = OMSimCommandArgsTable::getInstance().get<G4int>("numevents");
+    runMultipleAngularScan(p_phis, p_thetas, std::vector<G4int>(p_phis.size(), photonsPerDirection));
+}
+
+/**
+ * @brief Run all directions of a scan in a single run, with a given number of photons per direction.
+ *
+ * The beam is configured once and all photons are simulated in one /run/beamOn, so the workers stay busy until the last
+ * photon instead of synchronising at the end of every direction. The events are assigned to the directions in order
+ * (the events of the first p_photons[0] photons to direction 0 and so on); the beam of each event is placed by OMSimPrimaryGeneratorAction
+ * and the hits are tallied per direction by OMSimEventAction.
+ * @param p_phis The azimuthal angles in degrees.
+ * @param p_thetas The polar angles in degrees, same size as p_phis.
+ * @param p_photons Number of photons of each direction (multiples of the photons per event), directions with 0 are skipped.
+ */
+void AngularScan::runMultipleAngularScan(const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas, const std::vector<G4int> &p_photons)
+{
+    if (p_phis.size() != p_thetas.size() || p_phis.size() != p_photons.size())
+        throw std::invalid_argument("Number of phi, theta and photon values of the scan differ!");
+    if (!m_footprintProbabilities.empty() && m_footprintProbabilities.size() != p_phis.size())
+        throw std::invalid_argument("Number of footprints and directions of the scan differ!");
+
+    G4double totalEvents = 0;
+    m_directions.clear();
+    m_eventOffsets.clear();
+    for (std::size_t i = 0; i < p_phis.size(); i++)
+    {
+        m_directions.push_back(calculateBeamGeometry(p_phis.at(i) * deg, p_thetas.at(i) * deg, m_beamDistance));
+        if (!m_footprintProbabilities.empty())
+            m_directions.back().footprintProbabilities = m_footprintProbabilities.at(i);
+        totalEvents += OMSimPhotonBeamGenerator::getNumberOfEvents(std::max(p_photons.at(i), 0));
+        if (totalEvents > std::numeric_limits<G4int>::max())
+            throw std::invalid_argument("Too many events for a single run, reduce numevents or the number of directions!");
+        m_eventOffsets.push_back(static_cast<G4int>(totalEvents));
+    }
+    if (totalEvents == 0)
+    {
+        m_eventOffsets.clear();
+        return;
+    }
+
+    m_phi = p_phis.at(0) * deg;
+    m_theta = p_thetas.at(0) * deg;
+    configureScan();
+
+    log_info("Running {} directions with {} events in a single run", m_directions.size(), totalEvents);
+    OMSimUIinterface::getInstance().runBeamOn(static_cast<G4int>(totalEvents));
+    m_eventOffsets.clear();
+    logCulledPhotons(totalEvents * OMSimPhotonBeamGenerator::getPhotonsPerEvent());
+}
+
+/**
+ * @param p_eventID ID of an event of the current multi-direction run.
+ * @return Index of the direction the event belongs to.
+ */
+G4int AngularScan::getDirectionOfEvent(G4int p_eventID)
+{
+    return static_cast<G4int>(std::upper_bound(m_eventOffsets.begin(), m_eventOffsets.end(), p_eventID) - m_eventOffsets.begin());
+}
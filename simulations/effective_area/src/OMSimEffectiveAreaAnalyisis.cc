@@ -1,25 +1,326 @@
 #include "OMSimEffectiveAreaAnalyisis.hh"
 #include "OMSimCommandArgsTable.hh"
 #include "OMSimHitManager.hh"
+#include "OMSimAngularScan.hh"
 
+#include <G4Event.hh>
+#include <G4PrimaryVertex.hh>
+#include <G4SystemOfUnits.hh>
+#include <algorithm>
 
+std::vector<G4double> OMSimEffectiveAreaAnalyisis::m_wavelengthCentres;
+std::vector<G4double> OMSimEffectiveAreaAnalyisis::m_wavelengthEdges;
+G4Mutex OMSimEffectiveAreaAnalyisis::m_mutex = G4Mutex();
+std::vector<std::unique_ptr<DirectionTally>> OMSimEffectiveAreaAnalyisis::m_threadTallies;
+G4ThreadLocal DirectionTally *OMSimEffectiveAreaAnalyisis::m_threadTally = nullptr;
 
+/**
+ * @brief Writes the hits per PMT, the total and the effective area (the columns after the scan parameters) and ends the line.
+ * @param p_dataFile Open output stream.
+ * @param p_weightedHits Weighted hits per PMT, last entry is the total of the module.
+ * @param p_totalHits Number of hits (unweighted, or the effective number with importance weights), needed for the uncertainty.
+ * @param p_numberPhotons Number of simulated photons.
+ */
+void OMSimEffectiveAreaAnalyisis::writeHits(std::ostream &p_dataFile, const std::vector<double> &p_weightedHits, double p_totalHits, double p_numberPhotons)
+{
+	for (const auto &hit : p_weightedHits)
+	{
+		p_dataFile << hit << "\t";
+	}
+	effectiveAreaResult effectiveArea = calculateEffectiveArea(p_weightedHits.back(), p_totalHits, p_numberPhotons);
+	p_dataFile << effectiveArea.EA << "\t" << effectiveArea.EAError << "\t";
+	p_dataFile << G4endl;
+}
 
 /**
- * @brief Calculates the effective area based on the number of hits and beam properties.
+ * @brief Defines the wavelength bins of multi-wavelength runs. Call on the master before the run.
+ * @param p_centres Wavelength in nm written for each bin.
+ * @param p_edges Bin edges in nm (one more than p_centres, increasing); empty for runs with a single wavelength.
+ */
+void OMSimEffectiveAreaAnalyisis::setWavelengthBins(const std::vector<G4double> &p_centres, const std::vector<G4double> &p_edges)
+{
+	if (!p_edges.empty() && p_edges.size() != p_centres.size() + 1)
+		throw std::invalid_argument("Number of wavelength bin edges must be the number of bins plus one!");
+	m_wavelengthCentres = p_centres;
+	m_wavelengthEdges = p_edges;
+}
+
+/**
+ * @param p_wavelength Wavelength in nm.
+ * @return Index of the wavelength bin (clamped to the first and last bin), 0 if the run has a single wavelength.
+ */
+G4int OMSimEffectiveAreaAnalyisis::getWavelengthBin(G4double p_wavelength)
+{
+	if (m_wavelengthEdges.empty())
+		return 0;
+	G4int bin = static_cast<G4int>(std::upper_bound(m_wavelengthEdges.begin(), m_wavelengthEdges.end(), p_wavelength) - m_wavelengthEdges.begin()) - 1;
+	return std::clamp(bin, 0, getNumberOfWavelengthBins() - 1);
+}
+
+/**
+ * @brief Adds the photons and hits of one event to the tally of its direction. Thread local, no locking except on the first call of each thread.
+ *
+ * In multi-wavelength runs, each photon is counted in the bin of its wavelength, and each hit in the bin of its energy
+ * (stored in eV; optical photons keep their energy, so a hit lands in the bin of the photon that made it).
+ * @param p_directionIndex Index of the scanned direction of the event (see ScanDirectionInformation).
+ * @param p_event The event, one photon per primary vertex.
+ * @param p_generator Generator of the event, whose culled photons (see BeamCullVolume) are counted as well.
+ * @param p_hits Hits of the event in the module, nullptr if there were none.
+ */
+void OMSimEffectiveAreaAnalyisis::tallyEvent(G4int p_directionIndex, const G4Event *p_event, const OMSimPhotonBeamGenerator &p_generator, const HitStats *p_hits)
+{
+	if (!m_threadTally)
+	{
+		G4AutoLock lock(&m_mutex);
+		m_threadTallies.push_back(std::make_unique<DirectionTally>());
+		m_threadTally = m_threadTallies.back().get();
+	}
+
+	G4int numberOfBins = getNumberOfWavelengthBins();
+	if (m_threadTally->countedHits.empty())
+	{
+		std::size_t numberOfEntries = AngularScan::getNumberOfDirections() * numberOfBins;
+		G4int numberOfPMTs = OMSimHitManager::getInstance().getNumberOfPMTs();
+		m_threadTally->weightedHits.assign(numberOfEntries, std::vector<double>(numberOfPMTs + 1, 0.0));
+		m_threadTally->countedHits.assign(numberOfEntries, 0.0);
+		m_threadTally->photons.assign(numberOfEntries, 0.0);
+	}
+
+	G4int firstEntry = p_directionIndex * numberOfBins;
+	const std::vector<G4double> &culledEnergies = p_generator.getCulledEnergies();
+	if (numberOfBins == 1)
+	{
+		m_threadTally->photons.at(firstEntry) += p_event->GetNumberOfPrimaryVertex() + culledEnergies.size();
+	}
+	else
+	{
+		for (G4int i = 0; i < p_event->GetNumberOfPrimaryVertex(); i++)
+		{
+			G4double energy = p_event->GetPrimaryVertex(i)->GetPrimary()->GetKineticEnergy();
+			m_threadTally->photons.at(firstEntry + getWavelengthBin(1239.84193 * eV / energy))++;
+		}
+		for (const auto &energy : culledEnergies)
+			m_threadTally->photons.at(firstEntry + getWavelengthBin(1239.84193 * eV / energy))++;
+	}
+
+	if (!p_hits)
+		return;
+
+	G4int cell = p_generator.getEventCell();
+	double importanceWeight = p_generator.getEventWeight();
+	if (cell >= 0 && m_threadTally->hitWeights.empty())
+	{
+		m_threadTally->hitWeights.assign(m_threadTally->countedHits.size(), 0.0);
+		m_threadTally->hitWeightSquares.assign(m_threadTally->countedHits.size(), 0.0);
+		m_threadTally->footprintHits.assign(AngularScan::getNumberOfDirections(), std::vector<double>());
+	}
+	if (cell >= 0 && m_threadTally->footprintHits.at(p_directionIndex).size() <= static_cast<std::size_t>(cell))
+		m_threadTally->footprintHits.at(p_directionIndex).resize(cell + 1, 0.0);
+
+	for (std::size_t i = 0; i < p_hits->PMTnr.size(); i++)
+	{
+		G4int entry = numberOfBins == 1 ? firstEntry : firstEntry + getWavelengthBin(1239.84193 / p_hits->energy.at(i));
+		double weight = p_hits->PMTresponse.at(i).detectionProbability;
+		std::vector<double> &weightedHits = m_threadTally->weightedHits.at(entry);
+		weightedHits.at(p_hits->PMTnr.at(i)) += importanceWeight * weight;
+		weightedHits.back() += importanceWeight * weight;
+		m_threadTally->countedHits.at(entry)++;
+		if (cell >= 0)
+		{
+			m_threadTally->hitWeights.at(entry) += importanceWeight;
+			m_threadTally->hitWeightSquares.at(entry) += importanceWeight * importanceWeight;
+			m_threadTally->footprintHits.at(p_directionIndex).at(cell) += weight;
+		}
+	}
+}
+
+/**
+ * @brief Sums the direction tallies of all threads and clears them.
+ *
+ * Call from the master after the run finished (workers are idle then, so their tallies can be read safely).
+ * @return Merged tally; empty if no thread recorded an event.
+ */
+DirectionTally OMSimEffectiveAreaAnalyisis::mergeDirectionTallies()
+{
+	G4AutoLock lock(&m_mutex);
+	DirectionTally merged;
+	for (const auto &tally : m_threadTallies)
+	{
+		addDirectionTally(merged, *tally);
+		*tally = DirectionTally();
+	}
+	return merged;
+}
+
+/**
+ * @brief Adds a tally to another one, e.g. to accumulate the runs of an adaptive scan.
+ * @param p_total Tally to which p_tally is added; taken over if still empty.
+ * @param p_tally Tally to add.
+ */
+void OMSimEffectiveAreaAnalyisis::addDirectionTally(DirectionTally &p_total, const DirectionTally &p_tally)
+{
+	if (p_tally.countedHits.empty())
+		return;
+	if (p_total.countedHits.empty())
+	{
+		p_total = p_tally;
+		return;
+	}
+	for (std::size_t direction = 0; direction < p_tally.countedHits.size(); direction++)
+	{
+		for (std::size_t pmt = 0; pmt < p_tally.weightedHits[direction].size(); pmt++)
+			p_total.weightedHits[direction][pmt] += p_tally.weightedHits[direction][pmt];
+		p_total.countedHits[direction] += p_tally.countedHits[direction];
+		p_total.photons[direction] += p_tally.photons[direction];
+	}
+
+	// Only threads (or runs) with hits in footprint cells have the importance sampling entries
+	auto add = [](std::vector<double> &p_sum, const std::vector<double> &p_values)
+	{
+		if (p_sum.size() < p_values.size())
+			p_sum.resize(p_values.size(), 0.0);
+		for (std::size_t i = 0; i < p_values.size(); i++)
+			p_sum[i] += p_values[i];
+	};
+	add(p_total.hitWeights, p_tally.hitWeights);
+	add(p_total.hitWeightSquares, p_tally.hitWeightSquares);
+	if (p_total.footprintHits.size() < p_tally.footprintHits.size())
+		p_total.footprintHits.resize(p_tally.footprintHits.size());
+	for (std::size_t direction = 0; direction < p_tally.footprintHits.size(); direction++)
+		add(p_total.footprintHits[direction], p_tally.footprintHits[direction]);
+}
+
+/**
+ * @brief Number of hits that determines the uncertainty of an entry.
+ *
+ * Without importance sampling this is the number of hits. With importance weights w it is the effective number
+ * (sum w)^2 / sum w^2, so that the relative error 1/sqrt(effective hits) is the Poisson error of the weighted sum.
+ * @param p_tally Merged tally.
+ * @param p_entry Entry (direction, or direction and wavelength bin).
+ */
+double OMSimEffectiveAreaAnalyisis::getEffectiveHits(const DirectionTally &p_tally, std::size_t p_entry)
+{
+	if (p_tally.hitWeights.empty() || p_tally.hitWeightSquares.at(p_entry) <= 0)
+		return p_tally.countedHits.at(p_entry);
+	return p_tally.hitWeights.at(p_entry) * p_tally.hitWeights.at(p_entry) / p_tally.hitWeightSquares.at(p_entry);
+}
+
+/**
+ * @brief Writes one line per direction of a multi-direction run, in the same format as writeScan.
+ * @param p_phis The azimuthal angles of the directions in degrees.
+ * @param p_thetas The polar angles of the directions in degrees.
+ * @param p_wavelength Wavelength of the scan in nm.
+ * @param p_tally Hits per direction, see mergeDirectionTallies.
+ * @param p_photons Photons simulated per direction. If given, they are written after the wavelength; if empty, numevents photons per direction are assumed.
+ */
+void OMSimEffectiveAreaAnalyisis::writeDirectionScans(const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas, G4double p_wavelength,
+													  const DirectionTally &p_tally, const std::vector<G4long> &p_photons)
+{
+	std::size_t numberOfPMTs = OMSimHitManager::getInstance().getNumberOfPMTs();
+	G4double numevents = OMSimCommandArgsTable::getInstance().get<int>("numevents");
+
+	std::fstream dataFile;
+	dataFile.open(m_outputFileName.c_str(), std::ios::out | std::ios::app);
+	for (std::size_t i = 0; i < p_phis.size(); i++)
+	{
+		dataFile << p_phis.at(i) << "\t" << p_thetas.at(i) << "\t" << p_wavelength << "\t";
+		G4double photons = numevents;
+		if (!p_photons.empty())
+		{
+			photons = p_photons.at(i);
+			dataFile << p_photons.at(i) << "\t";
+		}
+		if (p_tally.countedHits.empty())
+			writeHits(dataFile, std::vector<double>(numberOfPMTs + 1, 0.0), 0, photons);
+		else
+			writeHits(dataFile, p_tally.weightedHits.at(i), getEffectiveHits(p_tally, i), photons);
+	}
+	dataFile.close();
+}
+
+/**
+ * @brief Writes the header of a scan plan output: the plan parameters, the photons and the columns of writeHeader.
+ * @param p_parameterNames Parameters of the plan, see OMSimScanPlan::getParameterNames.
+ */
+void OMSimEffectiveAreaAnalyisis::writePlanHeader(const std::vector<std::string> &p_parameterNames)
+{
+	std::fstream dataFile;
+	dataFile.open(m_outputFileName.c_str(), std::ios::out | std::ios::app);
+	dataFile << "# ";
+	for (const auto &name : p_parameterNames)
+		dataFile << name << "\t";
+	dataFile << "Photons\thits[1perPMT]\ttotal_hits\tEA_Total(cm^2)\tEA_Total_error(cm^2)\t" << G4endl;
+	dataFile.close();
+}
+
+/**
+ * @brief Writes one point of a scan plan, see OMSimScanQueue::PointWriter.
+ * @param p_output Output stream of the scan queue.
+ * @param p_parameterNames Parameters of the plan, in the order of the header.
+ * @param p_point The point.
+ * @param p_tally Hits of the point.
+ */
+void OMSimEffectiveAreaAnalyisis::writePlanPoint(std::ostream &p_output, const std::vector<std::string> &p_parameterNames, const ScanPoint &p_point, const ScanPointTally &p_tally)
+{
+	for (const auto &name : p_parameterNames)
+		p_output << p_point.get(name) << "\t";
+	p_output << p_point.photons << "\t";
+	writeHits(p_output, p_tally.weightedHits, p_tally.countedHits, p_point.photons);
+}
+
+/**
+ * @brief Writes one line per direction and wavelength bin of a multi-wavelength run, normalised to the photons simulated in each bin.
+ * @param p_phis The azimuthal angles of the directions in degrees.
+ * @param p_thetas The polar angles of the directions in degrees.
+ * @param p_tally Hits and photons per direction and wavelength bin, see mergeDirectionTallies.
+ */
+void OMSimEffectiveAreaAnalyisis::writeWavelengthScans(const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas, const DirectionTally &p_tally)
+{
+	std::size_t numberOfPMTs = OMSimHitManager::getInstance().getNumberOfPMTs();
+	std::size_t numberOfBins = getNumberOfWavelengthBins();
+
+	std::fstream dataFile;
+	dataFile.open(m_outputFileName.c_str(), std::ios::out | std::ios::app);
+	for (std::size_t i = 0; i < p_phis.size(); i++)
+	{
+		for (std::size_t bin = 0; bin < numberOfBins; bin++)
+		{
+			std::size_t entry = i * numberOfBins + bin;
+			G4double photons = p_tally.photons.empty() ? 0 : p_tally.photons.at(entry);
+			dataFile << p_phis.at(i) << "\t" << p_thetas.at(i) << "\t" << m_wavelengthCentres.at(bin) << "\t" << photons << "\t";
+			if (photons == 0)
+				writeHits(dataFile, std::vector<double>(numberOfPMTs + 1, 0.0), 0, 1);
+			else
+				writeHits(dataFile, p_tally.weightedHits.at(entry), getEffectiveHits(p_tally, entry), photons);
+		}
+	}
+	dataFile.close();
+}
+
+/**
+ * @brief Calculates the effective area based on the number of hits and beam properties, assuming numevents photons.
  * @param p_weightTotal The number of hits weighted.
  * @param p_totalCount The number of hits
  * @return Returns a structure with the effective area and its uncertainty.
  */
 effectiveAreaResult OMSimEffectiveAreaAnalyisis::calculateEffectiveArea(double p_weightTotal, double p_totalCount)
+{
+	return calculateEffectiveArea(p_weightTotal, p_totalCount, OMSimCommandArgsTable::getInstance().get<int>("numevents"));
+}
+
+/**
+ * @brief Calculates the effective area based on the number of hits and beam properties.
+ * @param p_weightTotal The number of hits weighted.
+ * @param p_totalCount The number of hits
+ * @param p_numberPhotons The number of simulated photons
+ * @return Returns a structure with the effective area and its uncertainty.
+ */
+effectiveAreaResult OMSimEffectiveAreaAnalyisis::calculateEffectiveArea(double p_weightTotal, double p_totalCount, double p_numberPhotons)
 {
 	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
 	G4double beamRadius = args.get<G4double>("radius")/10.; //in cm
-	G4double numberPhotons = args.get<int>("numevents");
 	G4double beamArea = CLHEP::pi * beamRadius * beamRadius;
-	G4double effectiveArea = p_weightTotal * beamArea / numberPhotons;
+	G4double effectiveArea = p_weightTotal * beamArea / p_numberPhotons;
 	G4double effectiveAreaError = effectiveArea / sqrt(p_totalCount);
 	return { effectiveArea, effectiveAreaError };
 }
-
-
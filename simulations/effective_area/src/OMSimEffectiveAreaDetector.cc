@@ -97,4 +97,13 @@ void OMSimEffectiveAreaDetector::constructDetector()
         opticalModule->placeIt(G4ThreeVector(0, 0, 0), G4RotationMatrix(), m_worldLogical, "");
         opticalModule->configureSensitiveVolume(this);
     }
+    m_opticalModule = opticalModule;
+}
+
+/**
+ * @return Symmetry group of the constructed optical module (no symmetry for single PMTs or custom detectors).
+ */
+ModuleSymmetry OMSimEffectiveAreaDetector::getModuleSymmetry()
+{
+    return m_opticalModule ? m_opticalModule->getSymmetry() : ModuleSymmetry();
 }
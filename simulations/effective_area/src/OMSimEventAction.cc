@@ -1,10 +1,34 @@
 #include "OMSimEventAction.hh"
+#include "OMSimAngularScan.hh"
+#include "OMSimEffectiveAreaAnalyisis.hh"
+#include "OMSimHitManager.hh"
+#include "OMSimScanQueue.hh"
+#include <G4Event.hh>
 #include <G4RunManager.hh>
 
 void OMSimEventAction::BeginOfEventAction(const G4Event* p_event)
 {
 }
 
+/**
+ * @brief In multi-direction runs and scan plans, moves the hits of the event into the tally of its direction (and wavelength bin) or point.
+ */
 void OMSimEventAction::EndOfEventAction(const G4Event* p_event)
 {
+	if (OMSimScanQueue::isRunning())
+	{
+		std::map<G4int, HitStats> hits = OMSimHitManager::getInstance().extractSingleThreadHits();
+		auto moduleHits = hits.find(0);
+		OMSimScanQueue::endOfEvent(p_event, moduleHits != hits.end() ? &moduleHits->second : nullptr);
+		return;
+	}
+
+	auto *directionInformation = dynamic_cast<ScanDirectionInformation *>(p_event->GetUserInformation());
+	if (!directionInformation)
+		return;
+
+	std::map<G4int, HitStats> hits = OMSimHitManager::getInstance().extractSingleThreadHits();
+	auto moduleHits = hits.find(0);
+	auto *generator = static_cast<const OMSimPhotonBeamGenerator *>(G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+	OMSimEffectiveAreaAnalyisis::tallyEvent(directionInformation->getDirectionIndex(), p_event, *generator, moduleHits != hits.end() ? &moduleHits->second : nullptr);
 }
@@ -1,30 +1,24 @@
 #include "OMSimPrimaryGeneratorAction.hh"
+#include "OMSimAngularScan.hh"
 
-#include <G4GeneralParticleSource.hh>
-#include <G4ParticleTypes.hh>
-#include <G4RandomTools.hh>
+#include <G4Event.hh>
 
-thread_local std::unique_ptr<G4GeneralParticleSource> OMSimPrimaryGeneratorAction::m_particleSource;
-G4Mutex OMSimPrimaryGeneratorAction::m_mutex;
-OMSimPrimaryGeneratorAction::OMSimPrimaryGeneratorAction()
-{
-	if (!m_particleSource)
-	{
-	m_particleSource = std::make_unique<G4GeneralParticleSource>();
-	}
-}
-
-OMSimPrimaryGeneratorAction::~OMSimPrimaryGeneratorAction()
+/**
+ * @brief Places the beam (and its footprint probabilities) for the direction of the event in a multi-direction run and attaches the direction index to the event.
+ */
+void OMSimPrimaryGeneratorAction::setScanDirection(G4Event *p_event)
 {
+	G4int directionIndex = AngularScan::getDirectionOfEvent(p_event->GetEventID());
+	p_event->SetUserInformation(new ScanDirectionInformation(directionIndex));
 
+	const BeamGeometry &beam = AngularScan::getBeamGeometry(directionIndex);
+	setBeamGeometry(beam.centre, beam.rot1, beam.rot2);
+	setFootprintProbabilities(beam.footprintProbabilities);
 }
- 
+
 void OMSimPrimaryGeneratorAction::GeneratePrimaries(G4Event *p_event)
 {
-	if (m_particleSource)
-	{
-		std::lock_guard<G4Mutex> lock(m_mutex);
-		m_particleSource->SetParticlePolarization(G4RandomDirection());
-		m_particleSource->GeneratePrimaryVertex(p_event);
-	}
+	if (AngularScan::isMultiDirectionRun())
+		setScanDirection(p_event);
+	OMSimPhotonBeamGenerator::GeneratePrimaries(p_event);
 }
@@ -0,0 +1,164 @@
+#include "OMSimSymmetricScanPlanner.hh"
+#include "OMSimLogger.hh"
+
+#include <G4SystemOfUnits.hh>
+#include <Randomize.hh>
+
+#include <cmath>
+#include <map>
+
+namespace
+{
+    constexpr G4double k_angleTolerance = 1e-6;      ///< Representatives closer than this (in deg) are simulated once
+    constexpr G4double k_positionTolerance = 1 * mm; ///< Maximum distance between a transformed PMT position and the PMT it is mapped onto
+
+    G4double wrapDegrees(G4double p_angle)
+    {
+        G4double wrapped = std::fmod(p_angle, 360.);
+        return wrapped < 0 ? wrapped + 360. : wrapped;
+    }
+}
+
+/**
+ * @param p_symmetry Symmetry group of the module (see OMSimOpticalModule::getSymmetry).
+ * @param p_phis Azimuthal angles of the scan in degrees.
+ * @param p_thetas Polar angles of the scan in degrees, same size as p_phis.
+ * @throw std::runtime_error If the PMT positions are not invariant under the declared symmetry.
+ */
+SymmetricScanPlanner::SymmetricScanPlanner(const ModuleSymmetry &p_symmetry, const std::vector<G4double> &p_phis, const std::vector<G4double> &p_thetas)
+    : m_azimuthalOrder(std::max(p_symmetry.azimuthalOrder, 1)), m_upDownMirror(p_symmetry.upDownMirror), m_sector(360. / m_azimuthalOrder)
+{
+    if (p_phis.size() != p_thetas.size())
+        throw std::invalid_argument("Number of phi and theta values of the scan differ!");
+
+    calculatePMTPermutations(p_symmetry.PMTPositions);
+
+    std::map<std::pair<long long, long long>, G4int> representatives;
+    for (std::size_t i = 0; i < p_phis.size(); i++)
+    {
+        G4double phi = wrapDegrees(p_phis.at(i));
+        G4double theta = p_thetas.at(i);
+        G4int rotation = static_cast<G4int>(std::floor(phi / m_sector));
+        G4double reducedPhi = phi - rotation * m_sector;
+        if (reducedPhi > m_sector - k_angleTolerance)
+        {
+            reducedPhi = 0;
+            rotation++;
+        }
+        rotation %= m_azimuthalOrder;
+        G4bool mirror = m_upDownMirror && theta > 90.;
+        G4double reducedTheta = mirror ? 180. - theta : theta;
+
+        auto key = std::make_pair(std::llround(reducedPhi / k_angleTolerance), std::llround(reducedTheta / k_angleTolerance));
+        auto found = representatives.find(key);
+        if (found == representatives.end())
+        {
+            found = representatives.emplace(key, static_cast<G4int>(m_reducedPhis.size())).first;
+            m_reducedPhis.push_back(reducedPhi);
+            m_reducedThetas.push_back(reducedTheta);
+        }
+        m_reducedIndex.push_back(found->second);
+        m_operation.push_back(rotation + (mirror ? m_azimuthalOrder : 0));
+    }
+    log_info("Module symmetry (azimuthal order {}, up-down mirror {}) reduces the scan from {} to {} directions",
+             m_azimuthalOrder, m_upDownMirror, p_phis.size(), m_reducedPhis.size());
+}
+
+/**
+ * @brief Applies a symmetry operation (mirror z -> -z first, then rotation) to a direction.
+ * @return Transformed (phi, theta) in degrees.
+ */
+std::pair<G4double, G4double> SymmetricScanPlanner::applyOperation(G4int p_operation, G4double p_phi, G4double p_theta) const
+{
+    G4int rotation = p_operation % m_azimuthalOrder;
+    G4bool mirror = p_operation >= m_azimuthalOrder;
+    return {wrapDegrees(p_phi + rotation * m_sector), mirror ? 180. - p_theta : p_theta};
+}
+
+/**
+ * @brief Applies a symmetry operation (mirror z -> -z first, then rotation) to a position.
+ */
+G4ThreeVector SymmetricScanPlanner::applyOperation(G4int p_operation, const G4ThreeVector &p_position) const
+{
+    G4ThreeVector position = p_position;
+    if (p_operation >= m_azimuthalOrder)
+        position.setZ(-position.z());
+    position.rotateZ((p_operation % m_azimuthalOrder) * m_sector * deg);
+    return position;
+}
+
+/**
+ * @brief Finds for each operation and PMT the PMT at the transformed position.
+ * @param p_PMTPositions Positions of the PMTs in the module frame.
+ */
+void SymmetricScanPlanner::calculatePMTPermutations(const std::vector<G4ThreeVector> &p_PMTPositions)
+{
+    m_PMTPermutation.assign(getNumberOfOperations(), std::vector<G4int>(p_PMTPositions.size(), 0));
+    for (G4int operation = 0; operation < getNumberOfOperations(); operation++)
+    {
+        for (std::size_t pmt = 0; pmt < p_PMTPositions.size(); pmt++)
+        {
+            G4ThreeVector image = applyOperation(operation, p_PMTPositions[pmt]);
+            std::size_t closest = 0;
+            for (std::size_t other = 1; other < p_PMTPositions.size(); other++)
+            {
+                if ((p_PMTPositions[other] - image).mag2() < (p_PMTPositions[closest] - image).mag2())
+                    closest = other;
+            }
+            if ((p_PMTPositions[closest] - image).mag() > k_positionTolerance)
+                throw std::runtime_error("PMT positions are not invariant under the symmetry declared by the module!");
+            m_PMTPermutation[operation][pmt] = static_cast<G4int>(closest);
+        }
+    }
+}
+
+/**
+ * @brief Expands the hits of the representatives to all directions of the scan.
+ * @param p_reducedTally Hits per representative (see OMSimEffectiveAreaAnalyisis::mergeDirectionTallies).
+ * @return Hits per scan direction, PMT indices permuted according to the symmetry operation of each direction.
+ */
+DirectionTally SymmetricScanPlanner::expandTally(const DirectionTally &p_reducedTally) const
+{
+    DirectionTally expanded;
+    if (p_reducedTally.countedHits.empty())
+        return expanded;
+
+    for (std::size_t i = 0; i < m_reducedIndex.size(); i++)
+    {
+        const std::vector<double> &reducedHits = p_reducedTally.weightedHits.at(m_reducedIndex[i]);
+        std::vector<double> hits(reducedHits.size(), 0.0);
+        const std::vector<G4int> &permutation = m_PMTPermutation[m_operation[i]];
+        for (std::size_t pmt = 0; pmt + 1 < reducedHits.size(); pmt++)
+            hits.at(pmt < permutation.size() ? permutation[pmt] : pmt) = reducedHits[pmt];
+        hits.back() = reducedHits.back();
+        expanded.weightedHits.push_back(hits);
+        expanded.countedHits.push_back(p_reducedTally.countedHits.at(m_reducedIndex[i]));
+        expanded.photons.push_back(p_reducedTally.photons.at(m_reducedIndex[i]));
+    }
+    return expanded;
+}
+
+/**
+ * @param p_reducedPhotons Photons simulated per representative (may be empty).
+ * @return Photons per scan direction (empty if p_reducedPhotons is empty).
+ */
+std::vector<G4long> SymmetricScanPlanner::expandPhotons(const std::vector<G4long> &p_reducedPhotons) const
+{
+    std::vector<G4long> photons;
+    if (p_reducedPhotons.empty())
+        return photons;
+    for (const auto &reducedIndex : m_reducedIndex)
+        photons.push_back(p_reducedPhotons.at(reducedIndex));
+    return photons;
+}
+
+/**
+ * @brief Image of a representative under a random operation other than the identity, used to validate the declared symmetry.
+ * @param p_reducedIndex Index of the representative.
+ * @return (phi, theta) in degrees of the image.
+ */
+std::pair<G4double, G4double> SymmetricScanPlanner::randomImage(G4int p_reducedIndex) const
+{
+    G4int operation = 1 + std::min(static_cast<G4int>(G4UniformRand() * (getNumberOfOperations() - 1)), getNumberOfOperations() - 2);
+    return applyOperation(operation, m_reducedPhis.at(p_reducedIndex), m_reducedThetas.at(p_reducedIndex));
+}
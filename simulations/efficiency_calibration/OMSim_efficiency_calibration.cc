@@ -3,6 +3,9 @@
 #include "OMSimBeam.hh"
 #include "OMSimEffiCaliAnalyisis.hh"
 #include "OMSimEffiCaliDetector.hh"
+#include "OMSimScanJournal.hh"
+#include "OMSimScanPlan.hh"
+#include "OMSimScanQueue.hh"
 #include "OMSimTools.hh"
 std::shared_ptr<spdlog::logger> g_logger;
 
@@ -21,12 +24,17 @@ void runQEbeamSimulation()
 	//std::vector<double> wavelengths = Tools::arange(250, 305, 5); //UV range for higher statistics
 
 
-	for (const auto &wavelength : wavelengths)
+	OMSimScanJournal journal("QE_beam", analysisManager.m_outputFileName, wavelengths.size());
+	journal.recordStart();
+	for (std::size_t i = 0; i < wavelengths.size(); i++)
 	{
-		scanner->setWavelength(wavelength);
+		if (journal.isCompleted(i))
+			continue;
+		scanner->setWavelength(wavelengths.at(i));
 		scanner->runErlangenQEBeam();
-		analysisManager.writeHits(wavelength);
+		analysisManager.writeHits(wavelengths.at(i));
 		hitManager.reset();
+		journal.recordCompleted(i);
 	}
 }
 
@@ -47,16 +55,13 @@ void runXYZfrontalScan()
 	double rLim = 42; //mDOM
 	//double rLim = 53; //LOM
 
+	std::vector<std::pair<double, double>> points;
 	for (const auto &x : grid)
 	{
 		for (const auto &y : grid)
 		{
 			if (std::sqrt(x * x + y * y) < rLim)
-			{
-				scanner->runBeamPicoQuantSetup(x, y);
-				analysisManager.writeHitPositionHistogram(x, y);
-				hitManager.reset();
-			}
+				points.push_back({x, y});
 		}
 	}
 
@@ -65,11 +70,19 @@ void runXYZfrontalScan()
 	for (const auto &x : grid)
 	{
 		for (const auto &y : grid)
-		{
-			scanner->runBeamPicoQuantSetup(x, y);
-			analysisManager.writeHitPositionHistogram(x, y);
-			hitManager.reset();
-		}
+			points.push_back({x, y});
+	}
+
+	OMSimScanJournal journal("XYZ_frontal", analysisManager.m_outputFileName, points.size());
+	journal.recordStart();
+	for (std::size_t i = 0; i < points.size(); i++)
+	{
+		if (journal.isCompleted(i))
+			continue;
+		scanner->runBeamPicoQuantSetup(points[i].first, points[i].second);
+		analysisManager.writeHitPositionHistogram(points[i].first, points[i].second);
+		hitManager.reset();
+		journal.recordCompleted(i);
 	}
 	//scanner->runBeamPicoQuantSetup(20,0); //for visualisation checking
 }
@@ -93,19 +106,28 @@ void runfrontalXYScannNKT()
 	double rLim = 42; //mDOM
 	//double rLim = 53; //LOM
 
+	std::vector<std::pair<double, double>> points;
 	for (const auto &x : grid)
 	{
 		for (const auto &y : grid)
 		{
 			if (std::sqrt(x * x + y * y) < rLim)
-			{
-				scanner->runBeamNKTSetup(x, y);
-				//scanner->runBeamPicoQuantSetup(x, y);
-				analysisManager.writePositionPulseStatistics(x, y, wavelength);
-				hitManager.reset();
-			}
+				points.push_back({x, y});
 		}
 	}
+
+	OMSimScanJournal journal("XY_frontal_NKT", analysisManager.m_outputFileName, points.size());
+	journal.recordStart();
+	for (std::size_t i = 0; i < points.size(); i++)
+	{
+		if (journal.isCompleted(i))
+			continue;
+		scanner->runBeamNKTSetup(points[i].first, points[i].second);
+		//scanner->runBeamPicoQuantSetup(points[i].first, points[i].second);
+		analysisManager.writePositionPulseStatistics(points[i].first, points[i].second, wavelength);
+		hitManager.reset();
+		journal.recordCompleted(i);
+	}
 	
 }
 
@@ -127,13 +149,54 @@ void runfrontalProfileScannNKT()
 	double rLim = 42; //mDOM
 	//double rLim = 53; //LOM
 
-	for (const auto &x : profile)
+	OMSimScanJournal journal("profile_NKT", analysisManager.m_outputFileName, profile.size());
+	journal.recordStart();
+	for (std::size_t i = 0; i < profile.size(); i++)
 	{
-		scanner->runBeamNKTSetup(x, 0);
-		//scanner->runBeamPicoQuantSetup(x, 0);
-		analysisManager.writePositionStatistics(x, wavelength);
+		if (journal.isCompleted(i))
+			continue;
+		scanner->runBeamNKTSetup(profile.at(i), 0);
+		//scanner->runBeamPicoQuantSetup(profile.at(i), 0);
+		analysisManager.writePositionStatistics(profile.at(i), wavelength);
 		hitManager.reset();
+		journal.recordCompleted(i);
+	}
+}
+
+/**
+ * @brief Runs the points of a scan plan in a single run with the setup of simulation_step.
+ *
+ * Steps 1 and 2 use the Erlangen QE beam (parameter wavelength in nm), step 3 the PicoQuant and steps 4 and 5 the NKT
+ * setup (parameters x and y in mm). One line with the hits per point is written.
+ */
+void runScanPlan()
+{
+	OMSimEffiCaliAnalyisis analysisManager;
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	analysisManager.m_outputFileName = args.get<std::string>("output_file") + ".dat";
+
+	Beam *scanner = new Beam(0.3, args.get<G4double>("distance"));
+	G4int step = args.get<G4int>("simulation_step");
+	if (step >= 3)
+		scanner->configureZCorrection_PicoQuant();
+
+	OMSimScanPlan plan(args.get<std::string>("scan_plan"));
+	std::vector<BeamConfiguration> beams;
+	for (const auto &point : plan.getPoints())
+	{
+		if (step <= 2)
+			beams.push_back(scanner->getErlangenQEConfiguration(point.get("wavelength")));
+		else if (step == 3)
+			beams.push_back(scanner->getPicoQuantConfiguration(point.get("x"), point.get("y", 0)));
+		else
+			beams.push_back(scanner->getNKTConfiguration(point.get("x"), point.get("y", 0)));
 	}
+
+	const std::vector<std::string> &names = plan.getParameterNames();
+	OMSimScanQueue::run(plan, beams, OMSimHitManager::getInstance().getNumberOfPMTs(), analysisManager.m_outputFileName,
+						[&](std::ostream &p_output, const ScanPoint &p_point, const ScanPointTally &p_tally)
+						{ analysisManager.writePlanPoint(p_output, names, p_point, p_tally); });
+	OMSimHitManager::getInstance().reset();
 }
 
 /**
@@ -151,6 +214,7 @@ void addModuleOptions(OMSim *p_simulation)
 		("phi,f", po::value<G4double>()->default_value(0.0), "phi (= azimuth) in deg")
 		("wavelength,l", po::value<G4double>()->default_value(400.0), "wavelength of incoming light in nm")
 		("simulation_step", po::value<G4int>()->default_value(0), "simulation step to be performed (0, 1, 2)")
+		("scan_plan", po::value<std::string>(), "json scan plan run in a single run with the setup of simulation_step (wavelength for steps 1-2, x and y for steps 3-5), see OMSimScanPlan")
 		("no_header", po::bool_switch(), "if given, the header of the output file will not be written");
 
 	p_simulation->extendOptions(extraOptions);
@@ -169,7 +233,9 @@ int main(int p_argumentCount, char *p_argumentVector[])
 	simulation.initialiseSimulation(detectorConstruction.get());
 	detectorConstruction.release();
 
-	switch (OMSimCommandArgsTable::getInstance().get<G4int>("simulation_step"))
+	if (OMSimCommandArgsTable::getInstance().keyExists("scan_plan"))
+		runScanPlan();
+	else switch (OMSimCommandArgsTable::getInstance().get<G4int>("simulation_step"))
 	{
 	case 1:
 	{
@@ -6,6 +6,7 @@
 
 #pragma once
 #include "globals.hh"
+#include "OMSimPhotonBeamGenerator.hh"
 #include "TGraph.h"
 class Beam
 {
@@ -19,6 +20,10 @@ public:
   void runBeamNKTSetup(G4double p_x, G4double p_y);
   void setWavelength(double pWavelength);
   void configureZCorrection_PicoQuant();
+
+  BeamConfiguration getErlangenQEConfiguration(G4double pWavelength);
+  BeamConfiguration getPicoQuantConfiguration(G4double pX, G4double pY);
+  BeamConfiguration getNKTConfiguration(G4double pX, G4double pY);
 private:
 
 
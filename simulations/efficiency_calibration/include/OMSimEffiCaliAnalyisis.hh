@@ -3,6 +3,7 @@
 
 #include "OMSimPMTResponse.hh"
 #include "OMSimHitManager.hh"
+#include "OMSimScanQueue.hh"
 
 #include <G4ThreeVector.hh>
 #include <fstream>
@@ -18,6 +19,7 @@ public:
     void writeHitPositionHistogram(double x, double y);
     void writePositionStatistics(double x, double wavelength);
     void writePositionPulseStatistics(double x, double y, double wavelength);
+    void writePlanPoint(std::ostream &p_output, const std::vector<std::string> &p_parameterNames, const ScanPoint &p_point, const ScanPointTally &p_tally);
     G4String m_outputFileName;
 };
 
@@ -1,21 +1,13 @@
 #pragma once
  
-#include <G4VUserPrimaryGeneratorAction.hh>
-#include <G4AutoLock.hh>
-class G4GeneralParticleSource;
-class G4Event;
-class OMSimPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
-{
-public:
-	OMSimPrimaryGeneratorAction();
-	~OMSimPrimaryGeneratorAction();
+#include "OMSimPhotonBeamGenerator.hh"
 
+/**
+ * @brief Photons of the beams configured by Beam, see OMSimPhotonBeamGenerator.
+ */
+class OMSimPrimaryGeneratorAction : public OMSimPhotonBeamGenerator
+{
 public:
-	void GeneratePrimaries(G4Event* anEvent) override;
-
-private:
-    static thread_local std::unique_ptr<G4GeneralParticleSource> m_particleSource;
-	static G4Mutex m_mutex;
+	OMSimPrimaryGeneratorAction(){};
+	~OMSimPrimaryGeneratorAction(){};
 };
-
-
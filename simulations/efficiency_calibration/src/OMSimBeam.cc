@@ -1,4 +1,5 @@
 #include "OMSimBeam.hh"
+#include "OMSimPhotonBeamGenerator.hh"
 #include "OMSimUIinterface.hh"
 #include <G4SystemOfUnits.hh>
 
@@ -21,35 +22,35 @@ void Beam::configureXYZScan_NKTLaser()
     ui.applyCommand("/event/verbose 0");
     ui.applyCommand("/control/verbose 0");
     ui.applyCommand("/run/verbose 0");
-    ui.applyCommand("/gps/particle opticalphoton");
-    ui.applyCommand("/gps/energy", 1239.84193 / 459, "eV");
-
-    ui.applyCommand("/gps/pos/type Beam");
-    ui.applyCommand("/gps/ang/type beam1d");
-    ui.applyCommand("/gps/pos/radius 0 mm");
-    ui.applyCommand("/gps/pos/sigma_r 0.14 mm");
-    ui.applyCommand("/gps/ang/sigma_r 0 deg");
-    
-
-    ui.applyCommand("/gps/pos/rot1 0 1 0");
-    ui.applyCommand("/gps/ang/rot1 0 1 0");
-    ui.applyCommand("/gps/pos/rot2 -1 0 0");
-    ui.applyCommand("/gps/ang/rot2 -1 0 0");
-
-    ui.applyCommand("/gps/pos/centre 0 0 30 mm");
-
 }
 
-void Beam::runBeamNKTSetup(G4double p_x, G4double p_y)
+/**
+ * @brief NKT laser beam at a position of the XY scan, height from the z correction.
+ * @param p_x X position in mm.
+ * @param p_y Y position in mm.
+ */
+BeamConfiguration Beam::getNKTConfiguration(G4double p_x, G4double p_y)
 {
     double z = m_zCorrection->Eval(std::sqrt(p_x*p_x+p_y*p_y));
     if (z<4.8) { z = 4.8;} //mDOM
     //if (z<6.9) { z = 6.9;} //LOM
-    configureXYZScan_NKTLaser();
 
-    OMSimUIinterface &ui = OMSimUIinterface::getInstance();
-    ui.applyCommand("/gps/pos/centre", p_x, p_y, z, "mm");
-    ui.runBeamOn();
+    BeamConfiguration beam;
+    beam.shape = BeamShape::Point;
+    beam.sigmaPosition = 0.14 * mm;
+    beam.angular = BeamAngularDistribution::Collimated;
+    beam.rot1 = G4ThreeVector(0, 1, 0);
+    beam.rot2 = G4ThreeVector(-1, 0, 0);
+    beam.centre = G4ThreeVector(p_x, p_y, z) * mm;
+    beam.energy = 1239.84193 / 459 * eV;
+    return beam;
+}
+
+void Beam::runBeamNKTSetup(G4double p_x, G4double p_y)
+{
+    configureXYZScan_NKTLaser();
+    OMSimPhotonBeamGenerator::setConfiguration(getNKTConfiguration(p_x, p_y));
+    OMSimUIinterface::getInstance().runBeamOn(OMSimPhotonBeamGenerator::getNumberOfEvents());
 }
 
 
@@ -62,24 +63,26 @@ void Beam::configureErlangenQESetup()
     ui.applyCommand("/event/verbose 0");
     ui.applyCommand("/control/verbose 0");
     ui.applyCommand("/run/verbose 0");
-    ui.applyCommand("/gps/particle opticalphoton");
-    ui.applyCommand("/gps/energy", 1239.84193 / m_wavelength, "eV");
-
-    ui.applyCommand("/gps/pos/type Plane");
-    ui.applyCommand("/gps/pos/shape Circle");
-    ui.applyCommand("/gps/pos/radius 5 mm");
-    ui.applyCommand("/gps/ang/type focused");
-    ui.applyCommand("/gps/ang/focuspoint 0 0 279.5 mm");
-    //ui.applyCommand("/gps/ang/focuspoint 0 0 480 mm"); //Rough Münster QE setup
-    
-
-    ui.applyCommand("/gps/pos/rot1 0 1 0");
-    ui.applyCommand("/gps/ang/rot1 0 1 0");
-    ui.applyCommand("/gps/pos/rot2 -1 0 0");
-    ui.applyCommand("/gps/ang/rot2 -1 0 0");
-
-    ui.applyCommand("/gps/pos/centre 0 0 535.5 mm");
+    OMSimPhotonBeamGenerator::setConfiguration(getErlangenQEConfiguration(m_wavelength));
+}
 
+/**
+ * @brief Beam of the Erlangen QE setup, focused on the PMT.
+ * @param p_wavelength Wavelength in nm.
+ */
+BeamConfiguration Beam::getErlangenQEConfiguration(G4double p_wavelength)
+{
+    BeamConfiguration beam;
+    beam.shape = BeamShape::Disc;
+    beam.radius = 5 * mm;
+    beam.angular = BeamAngularDistribution::Focused;
+    beam.focusPoint = G4ThreeVector(0, 0, 279.5 * mm);
+    //beam.focusPoint = G4ThreeVector(0, 0, 480 * mm); //Rough Münster QE setup
+    beam.rot1 = G4ThreeVector(0, 1, 0);
+    beam.rot2 = G4ThreeVector(-1, 0, 0);
+    beam.centre = G4ThreeVector(0, 0, 535.5 * mm);
+    beam.energy = 1239.84193 / p_wavelength * eV;
+    return beam;
 }
 
 
@@ -87,7 +90,7 @@ void Beam::runErlangenQEBeam()
 {
     configureErlangenQESetup();
     OMSimUIinterface &ui = OMSimUIinterface::getInstance();
-    ui.runBeamOn();
+    ui.runBeamOn(OMSimPhotonBeamGenerator::getNumberOfEvents());
 }
 
 /* For Münsters PicoQuant 3D scanner setup*/
@@ -105,35 +108,36 @@ void Beam::configureXYZScan_PicoQuantSetup()
     ui.applyCommand("/event/verbose 0");
     ui.applyCommand("/control/verbose 0");
     ui.applyCommand("/run/verbose 0");
-    ui.applyCommand("/gps/particle opticalphoton");
-    ui.applyCommand("/gps/energy", 1239.84193 / 459, "eV");
-
-    ui.applyCommand("/gps/pos/type Beam");
-    ui.applyCommand("/gps/ang/type beam1d");
-    ui.applyCommand("/gps/pos/radius 0 mm");
-    ui.applyCommand("/gps/pos/sigma_r 0.3822 mm");
-    ui.applyCommand("/gps/ang/sigma_r 0.83 deg");
-    
-
-    ui.applyCommand("/gps/pos/rot1 0 1 0");
-    ui.applyCommand("/gps/ang/rot1 0 1 0");
-    ui.applyCommand("/gps/pos/rot2 -1 0 0");
-    ui.applyCommand("/gps/ang/rot2 -1 0 0");
-
-    ui.applyCommand("/gps/pos/centre 0 0 24.8 mm");
 }
 
-void Beam::runBeamPicoQuantSetup(G4double p_x, G4double p_y)
+/**
+ * @brief PicoQuant laser beam at a position of the XYZ scan, focal point on the PMT surface from the z correction.
+ * @param p_x X position in mm.
+ * @param p_y Y position in mm.
+ */
+BeamConfiguration Beam::getPicoQuantConfiguration(G4double p_x, G4double p_y)
 {
     double focalPoint = 9.5*mm;
     double distanceTipToCentre = 23.7245*mm; //mDOM + LOM...
     
     double z = focalPoint + distanceTipToCentre - m_zCorrection->Eval(std::sqrt(p_x*p_x+p_y*p_y))*mm;
     if (z<focalPoint) { z = focalPoint;}
-    
-    configureXYZScan_PicoQuantSetup();
 
-    OMSimUIinterface &ui = OMSimUIinterface::getInstance();
-    ui.applyCommand("/gps/pos/centre", p_x, p_y, z, "mm");
-    ui.runBeamOn();
+    BeamConfiguration beam;
+    beam.shape = BeamShape::Point;
+    beam.sigmaPosition = 0.3822 * mm;
+    beam.angular = BeamAngularDistribution::Gaussian;
+    beam.sigmaAngle = 0.83 * deg;
+    beam.rot1 = G4ThreeVector(0, 1, 0);
+    beam.rot2 = G4ThreeVector(-1, 0, 0);
+    beam.centre = G4ThreeVector(p_x * mm, p_y * mm, z);
+    beam.energy = 1239.84193 / 459 * eV;
+    return beam;
+}
+
+void Beam::runBeamPicoQuantSetup(G4double p_x, G4double p_y)
+{
+    configureXYZScan_PicoQuantSetup();
+    OMSimPhotonBeamGenerator::setConfiguration(getPicoQuantConfiguration(p_x, p_y));
+    OMSimUIinterface::getInstance().runBeamOn(OMSimPhotonBeamGenerator::getNumberOfEvents());
 }
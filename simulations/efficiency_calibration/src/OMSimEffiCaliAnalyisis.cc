@@ -126,4 +126,18 @@ void OMSimEffiCaliAnalyisis::writeHits(double p_wavelength)
 
     dataFile << G4endl;
     dataFile.close();
-}
\ No newline at end of file
+}
+
+
+/**
+ * @brief Writes one point of a scan plan (see OMSimScanQueue::PointWriter): the plan parameters, photons, hits and weighted hits.
+ */
+void OMSimEffiCaliAnalyisis::writePlanPoint(std::ostream &p_output, const std::vector<std::string> &p_parameterNames, const ScanPoint &p_point, const ScanPointTally &p_tally)
+{
+	for (const auto &name : p_parameterNames)
+		p_output << p_point.get(name) << "\t";
+	p_output << p_point.photons << "\t";
+	p_output << p_tally.countedHits << "\t";
+	p_output << p_tally.weightedHits.back() << "\t";
+	p_output << G4endl;
+}
@@ -1,4 +1,6 @@
 #include "OMSimEventAction.hh"
+#include "OMSimHitManager.hh"
+#include "OMSimScanQueue.hh"
 #include <G4RunManager.hh>
 
 
@@ -6,7 +8,14 @@ void OMSimEventAction::BeginOfEventAction(const G4Event* p_evt)
 {
 }
 
+/**
+ * @brief While a scan plan is running, moves the hits of the event into the tally of its point.
+ */
 void OMSimEventAction::EndOfEventAction(const G4Event* p_evt)
 {
-
+	if (!OMSimScanQueue::isRunning())
+		return;
+	std::map<G4int, HitStats> hits = OMSimHitManager::getInstance().extractSingleThreadHits();
+	auto moduleHits = hits.find(0);
+	OMSimScanQueue::endOfEvent(p_evt, moduleHits != hits.end() ? &moduleHits->second : nullptr);
 }
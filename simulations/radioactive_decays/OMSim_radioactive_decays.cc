@@ -10,12 +10,29 @@
 #include "OMSimDecaysGPS.hh"
 #include "OMSimHitManager.hh"
 #include "OMSimDecaysAnalysis.hh"
+#include "OMSimDecayLibrary.hh"
+#include "OMSimRateEstimator.hh"
 #include "OMSimRadDecaysDetector.hh"
 
 std::shared_ptr<spdlog::logger> g_logger;
 
 namespace po = boost::program_options;
 
+/**
+ * @brief Coincidence windows of the multiplicity study, from the user arguments.
+ */
+std::vector<G4double> getCoincidenceTimeWindows()
+{
+	std::vector<G4double> coincidenceTimeWindows;
+	for (const auto &window : OMSimCommandArgsTable::getInstance().get<std::vector<double>>("multiplicity_time_window"))
+	{
+		if (window <= 0)
+			throw std::invalid_argument("multiplicity_time_window values must be positive");
+		coincidenceTimeWindows.push_back(window * ns);
+	}
+	return coincidenceTimeWindows;
+}
+
 /**
  * @brief Runs the decay simulation for the specified optical module.
  * @param p_detector Pointer to the OMSimRadDecaysDetector object representing the detector 
@@ -29,32 +46,180 @@ void runRadioactiveDecays(OMSimRadDecaysDetector *p_detector)
 
 	OMSimDecaysGPS &decaysGPS = OMSimDecaysGPS::getInstance();
 	decaysGPS.setOpticalModule(p_detector->m_opticalModule);
-	decaysGPS.setProductionRadius(280*mm);
 	const bool simulateVesselDecays = !args.get<bool>("no_PV_decays");
 	const bool simulatePMTDecays = !args.get<bool>("no_PMT_decays");
+	const std::vector<G4double> coincidenceTimeWindows = getCoincidenceTimeWindows();
+	const bool isChunk = args.keyExists("chunk_index");
+	const G4long firstWindow = isChunk ? static_cast<G4long>(args.get<G4int>("chunk_index")) * args.get<G4int>("numevents") : 0;
 
 	for (int i = 0; i < (int)args.get<G4int>("numevents"); i++)
 	{
 		if (simulateVesselDecays)
 		{
-			decaysGPS.simulateDecaysInPressureVessel(args.get<G4double>("time_window"));
+			decaysGPS.scheduleDecaysInPressureVessel(args.get<G4double>("time_window"));
 		}
 
 		if (simulatePMTDecays)
 		{
-			decaysGPS.simulateDecaysInPMTs(args.get<G4double>("time_window"));
+			decaysGPS.scheduleDecaysInPMTs(args.get<G4double>("time_window"));
 		}
+		if (i == 0 && args.keyExists("check_samplers"))
+		{
+			decaysGPS.checkVolumeSamplers(args.get<G4int>("check_samplers"));
+		}
+		decaysGPS.runScheduledDecays();
 
+		if (isChunk)
+		{
+			analysisManager.writeChunkWindow(firstWindow + i, args.get<G4double>("time_window"));
+		}
 		if (args.get<bool>("multiplicity_study"))
 		{
-			G4double coincidenceTimeWindow = args.get<double>("multiplicity_time_window")*ns;
-			analysisManager.writeMultiplicity(coincidenceTimeWindow);
+			analysisManager.writeMultiplicity(coincidenceTimeWindows, args.get<bool>("pair_coincidences"));
+		}
+		if (isChunk || args.get<bool>("multiplicity_study"))
+		{
 			analysisManager.reset();
 		}
 	}
-	analysisManager.mergeFiles();
+	if (isChunk)
+		analysisManager.closeChunk();
+	else
+		analysisManager.mergeFiles();
 }
 
+/**
+ * @brief Seed of a chunk of a chunked livetime, derived from the seed of the job and the chunk index (splitmix64).
+ *
+ * All chunks can be started with the same --seed and still get independent random sequences.
+ */
+long getChunkSeed(long p_seed, G4int p_chunkIndex)
+{
+	std::uint64_t state = static_cast<std::uint64_t>(p_seed) + 0x9E3779B97F4A7C15ULL * (static_cast<std::uint64_t>(p_chunkIndex) + 1);
+	state = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	state = (state ^ (state >> 27)) * 0x94D049BB133111EBULL;
+	state = state ^ (state >> 31);
+	return static_cast<long>(state & 0x7FFFFFFFFFFFFFFFULL);
+}
+
+/**
+ * @brief Builds a decay library: simulates a fixed number of chains per isotope and kind of volume and stores their hits.
+ * @param p_detector Detector of the simulation.
+ * @see OMSimDecayLibrary
+ */
+void buildDecayLibrary(OMSimRadDecaysDetector *p_detector)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	OMSimDecayLibrary &library = OMSimDecayLibrary::getInstance();
+	OMSimDecaysGPS &decaysGPS = OMSimDecaysGPS::getInstance();
+	decaysGPS.setOpticalModule(p_detector->m_opticalModule);
+	const G4int chains = args.get<G4int>("build_library");
+
+	for (const auto &isotope : decaysGPS.getIsotopes())
+	{
+		if (!args.get<bool>("no_PV_decays"))
+		{
+			G4double rate = decaysGPS.scheduleLibraryDecays(isotope, chains, false);
+			decaysGPS.runScheduledDecays();
+			library.closeGroup(isotope, "PressureVessel", rate);
+		}
+		if (!args.get<bool>("no_PMT_decays"))
+		{
+			G4double rate = decaysGPS.scheduleLibraryDecays(isotope, chains, true);
+			decaysGPS.runScheduledDecays();
+			library.closeGroup(isotope, "PMTs", rate);
+		}
+	}
+	library.write(args.get<std::string>("output_file") + "_library.dat", p_detector->m_opticalModule->getNumberOfPMTs(), args.get<G4double>("time_window"));
+}
+
+/**
+ * @brief Assembles numevents time windows from a decay library instead of simulating them.
+ * @param p_detector Detector of the simulation, must have the PMTs the library was built with.
+ * @see OMSimDecayLibrary
+ */
+void assembleFromDecayLibrary(OMSimRadDecaysDetector *p_detector)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	OMSimDecayLibrary &library = OMSimDecayLibrary::getInstance();
+	library.read(args.get<std::string>("assemble_library"));
+	const G4int numberOfPMTs = p_detector->m_opticalModule->getNumberOfPMTs();
+	if (library.getNumberOfPMTs() != numberOfPMTs)
+		throw std::invalid_argument(fmt::format("Decay library was built for {} PMTs, but the module has {}", library.getNumberOfPMTs(), numberOfPMTs));
+
+	const std::vector<G4double> coincidenceTimeWindows = getCoincidenceTimeWindows();
+	for (int i = 0; i < (int)args.get<G4int>("numevents"); i++)
+	{
+		std::vector<AssembledHit> hits = library.assembleWindow(args.get<G4double>("time_window"));
+		if (args.get<bool>("multiplicity_study"))
+		{
+			std::vector<std::pair<G4double, G4int>> timePMTHits;
+			timePMTHits.reserve(hits.size());
+			for (const auto &hit : hits)
+				timePMTHits.push_back({hit.time, hit.hit->PMT});
+			OMSimDecaysAnalysis::getInstance().writeMultiplicity(timePMTHits, numberOfPMTs, coincidenceTimeWindows, args.get<bool>("pair_coincidences"));
+		}
+		else
+		{
+			library.writeHits(i, hits);
+		}
+	}
+	library.closeOutput();
+}
+
+/**
+ * @brief Builds a rate table: simulates a fixed number of chains per isotope and volume kind and tallies their hits and coincidences.
+ *
+ * The coincidences are formed with the first multiplicity_time_window.
+ * @param p_detector Detector of the simulation.
+ * @see OMSimRateEstimator
+ */
+void buildRateTable(OMSimRadDecaysDetector *p_detector)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	OMSimRateEstimator &estimator = OMSimRateEstimator::getInstance();
+	OMSimDecaysGPS &decaysGPS = OMSimDecaysGPS::getInstance();
+	decaysGPS.setOpticalModule(p_detector->m_opticalModule);
+	estimator.configure(p_detector->m_opticalModule->getNumberOfPMTs(), getCoincidenceTimeWindows().front());
+	const G4int decays = args.get<G4int>("build_rate_table");
+
+	for (const auto &isotope : decaysGPS.getIsotopes())
+	{
+		if (!args.get<bool>("no_PV_decays"))
+		{
+			decaysGPS.scheduleLibraryDecays(isotope, decays, false);
+			decaysGPS.runScheduledDecays();
+			estimator.closeGroup(isotope, "PressureVessel");
+		}
+		if (!args.get<bool>("no_PMT_decays"))
+		{
+			decaysGPS.scheduleLibraryDecays(isotope, decays, true);
+			decaysGPS.runScheduledDecays();
+			estimator.closeGroup(isotope, "PMTs");
+		}
+	}
+	estimator.write(args.get<std::string>("output_file") + "_rate_table.dat");
+}
+
+/**
+ * @brief Estimates the hit and coincidence rates of the module from the rate table and the current material activities.
+ *
+ * Uses the table of estimate_rates, or the one just built with build_rate_table.
+ * @param p_detector Detector of the simulation, must have the PMTs the table was built with.
+ * @see OMSimRateEstimator
+ */
+void estimateRates(OMSimRadDecaysDetector *p_detector)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	OMSimRateEstimator &estimator = OMSimRateEstimator::getInstance();
+	OMSimDecaysGPS::getInstance().setOpticalModule(p_detector->m_opticalModule);
+	if (args.keyExists("estimate_rates"))
+		estimator.read(args.get<std::string>("estimate_rates"));
+	const G4int numberOfPMTs = p_detector->m_opticalModule->getNumberOfPMTs();
+	if (estimator.getNumberOfPMTs() != numberOfPMTs)
+		throw std::invalid_argument(fmt::format("Rate table was built for {} PMTs, but the module has {}", estimator.getNumberOfPMTs(), numberOfPMTs));
+	estimator.writeEstimate(args.get<std::string>("output_file") + "_estimated_rates.dat");
+}
 
 /**
  * @brief Add options for the user input arguments for the radioactive decays module
@@ -73,10 +238,22 @@ void addModuleOptions(OMSim* p_simulation)
 	("scint_off", po::bool_switch(), "deactivates scintillation process.")
 	("cherenkov_off", po::bool_switch(), "deactivates Cherenkov process.")
 	("temperature", po::value<std::string>(), "temperature in C° (scintillation is temperature dependent)")
+	("sampler_voxels", po::value<G4int>()->default_value(200000), "approximate number of voxels of the bounding box of each volume in which decay vertices are sampled")
+	("check_samplers", po::value<G4int>(), "if given, this many decay vertices per volume are sampled and located with the navigator, and the sampled volume is compared with the Geant4 estimate (logged)")
 	("time_window", po::value<G4double>()->default_value(60.0), "time length in which the decays are simulated.")
-	("multiplicity_time_window", po::value<double>()->default_value(20.), "time window in ns for coincidences in multiplicity calculation")
+	("multiplicity_time_window", po::value<std::vector<double>>()->multitoken()->default_value({20.}, "20"), "time windows in ns for coincidences in multiplicity calculation; with several windows (e.g. 10 20 50 100) all are calculated from the same hits and written to one file per window")
+	("pair_coincidences", po::bool_switch(), "in a multiplicity study, also write for each time window the number of coincidences in which each pair of PMTs was hit")
 	("yield_alphas", po::value<G4double>(), "scintillation yield for alpha particles. This affects all materials with scintillation properties!")
 	("yield_electrons", po::value<G4double>(), "scintillation yield for electrons. This affects all materials with scintillation properties!")
+	("binary_output", po::bool_switch(), "write the hit and decay files as packed binary rows after a text header describing the columns, instead of tab-separated text")
+	("output_buffer_size", po::value<G4double>()->default_value(8.), "size in MB of the buffer of each per-thread hit and decay file; full buffers are written to disk by a background thread")
+	("build_library", po::value<G4int>(), "if given, this many decay chains per isotope and volume kind (pressure vessel, PMTs) are simulated and their hits stored in <output_file>_library.dat, instead of simulating time windows")
+	("assemble_library", po::value<std::string>(), "decay library file (see build_library) from which numevents time windows are assembled by resampling its chains, instead of simulating them")
+	("build_rate_table", po::value<G4int>(), "if given, this many decay chains per isotope and volume kind are simulated and their hits and coincidences (first multiplicity_time_window) per decay stored in <output_file>_rate_table.dat, from which the rates are then estimated (see estimate_rates)")
+	("estimate_rates", po::value<std::string>(), "rate table file (see build_rate_table) from which the hit and coincidence rates per PMT are estimated with the current material activities and masses, written to <output_file>_estimated_rates.dat; nothing is simulated")
+	("chunk_index", po::value<G4int>(), "if given, the numevents time windows are chunk k of a continuous livetime starting at window k*numevents, with a seed derived from --seed and k; the hits are written time ordered to <output_file>_chunk<k>_hits.dat, carrying hits past a window's end into the next window")
+	("decay_time_horizon", po::value<G4double>()->default_value(0.01), "with chunk_index, daughter nuclei decaying at most this many seconds after the end of the time window keep their decay time (their hits fall into the following windows); later decays are re-randomised into the window")
+	("merge_chunks", po::value<std::vector<std::string>>()->multitoken(), "hit files of chunks (see chunk_index) merged into one time-ordered stream in <output_file>_hits.dat; nothing is simulated")
 	("no_header", po::bool_switch(), "if given, the header of the output file will not be written");
 
 	p_simulation->extendOptions(moduleOptions);
@@ -87,13 +264,44 @@ int main(int p_argumentCount, char *p_argumentVector[])
 
 	OMSim simulation;
 	addModuleOptions(&simulation);
-	bool successful = simulation.handleArguments(p_argumentCount, p_argumentVector);
+	// The seed of a chunk is derived before the args are saved, so the args file records the seed the chunk is simulated with
+	auto deriveChunkSeed = [](OMSimCommandArgsTable &p_args)
+	{
+		if (p_args.keyExists("chunk_index"))
+			p_args.setParameter("chunk_seed", getChunkSeed(p_args.get<long>("seed"), p_args.get<G4int>("chunk_index")));
+	};
+	bool successful = simulation.handleArguments(p_argumentCount, p_argumentVector, deriveChunkSeed);
 	if (!successful) return 0;
 
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	if (args.keyExists("merge_chunks"))
+	{
+		OMSimDecaysAnalysis::mergeChunks(args.get<std::vector<std::string>>("merge_chunks"));
+		return 0;
+	}
+
 	OMSimRadDecaysDetector *detectorConstruction = new OMSimRadDecaysDetector();
 	simulation.initialiseSimulation(detectorConstruction);
 
-	runRadioactiveDecays(detectorConstruction);
+	if (args.keyExists("chunk_index"))
+	{
+		long chunkSeed = args.get<long>("chunk_seed");
+		log_info("Simulating chunk {} with seed {}", args.get<G4int>("chunk_index"), chunkSeed);
+		G4Random::setTheSeed(chunkSeed);
+	}
+	if (args.keyExists("build_rate_table"))
+	{
+		buildRateTable(detectorConstruction);
+		estimateRates(detectorConstruction);
+	}
+	else if (args.keyExists("estimate_rates"))
+		estimateRates(detectorConstruction);
+	else if (args.keyExists("build_library"))
+		buildDecayLibrary(detectorConstruction);
+	else if (args.keyExists("assemble_library"))
+		assembleFromDecayLibrary(detectorConstruction);
+	else
+		runRadioactiveDecays(detectorConstruction);
 	
 	if (OMSimCommandArgsTable::getInstance().get<bool>("visual"))
 		simulation.startVisualisation();
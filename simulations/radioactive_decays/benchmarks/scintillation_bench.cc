@@ -0,0 +1,158 @@
+/**
+ * @file scintillation_bench.cc
+ * @brief Throughput and equivalence benchmark of the scintillation energy sampling of OMSimG4Scintillation.
+ *
+ * Energy sampling: draws photon energies from a scintillation integral with
+ * - the reference implementation (copy of G4PhysicsVector::GetEnergy, bisection of the integral, as called by the upstream
+ *   process with G4UniformRand() * CIImax),
+ * - ScintillationKernels::sampleEnergy with the 256-entry guide table (OMSimScintillationKernels.hh),
+ * for a spectrum with as many nodes as the data files in common/data/scintillation (27) and a finer one, and checks that
+ * both give the same energy for the same random number.
+ *
+ * The return code is non-zero if any check fails.
+ *
+ * Usage: scintillation_bench [number of samples] [repetitions]
+ * @ingroup radioactive
+ */
+
+#include "OMSimScintillationKernels.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  namespace Reference
+  {
+    /**
+     * @brief Copy of G4PhysicsVector::GetEnergy (Geant4 11): bisection of the integral and linear interpolation.
+     */
+    double getEnergy(const std::vector<double> &p_energies, const std::vector<double> &p_values, double p_value)
+    {
+      const std::size_t nodes = p_values.size();
+      if (nodes == 1 || p_value <= p_values[0])
+        return p_energies[0];
+      if (p_value >= p_values[nodes - 1])
+        return p_energies[nodes - 1];
+      std::size_t bin = std::lower_bound(p_values.cbegin(), p_values.cend(), p_value) - p_values.cbegin() - 1;
+      bin = std::min(bin, nodes - 2);
+      double result = p_energies[bin];
+      const double delta = p_values[bin + 1] - p_values[bin];
+      if (delta > 0.0)
+        result += (p_value - p_values[bin]) * (p_energies[bin + 1] - result) / delta;
+      return result;
+    }
+  }
+
+  /**
+   * @brief Scintillation integral as built by G4Scintillation::BuildPhysicsTable (trapezoidal sum), not normalised.
+   */
+  struct Integral
+  {
+    std::vector<double> energies, values;
+  };
+
+  /**
+   * @brief Broad emission band around 400 nm between 200 and 590 nm, similar to the measured glass spectra.
+   */
+  Integral generateIntegral(std::size_t p_nodes)
+  {
+    const double hc = 1239.84198; // eV nm
+    Integral integral;
+    double previousIntensity = 0;
+    for (std::size_t j = 0; j < p_nodes; ++j)
+    {
+      const double wavelength = 590. - (590. - 200.) * j / (p_nodes - 1); // ascending energy
+      const double energy = hc / wavelength;
+      const double intensity = std::exp(-0.5 * std::pow((wavelength - 400.) / 60., 2)) + 0.05;
+      const double value = j == 0 ? 0. : integral.values.back() + 0.5 * (energy - integral.energies.back()) * (previousIntensity + intensity);
+      integral.energies.push_back(energy);
+      integral.values.push_back(value);
+      previousIntensity = intensity;
+    }
+    return integral;
+  }
+
+  /**
+   * @brief Normalised spectrum with guide table, as OMSimG4Scintillation::BuildMaterialScintillation.
+   */
+  ScintillationSpectrum toSpectrum(const Integral &p_integral)
+  {
+    ScintillationSpectrum spectrum;
+    const double maximum = p_integral.values.back();
+    spectrum.energies = p_integral.energies;
+    for (double value : p_integral.values)
+      spectrum.integral.push_back(value / maximum);
+    ScintillationKernels::buildGuide(spectrum, 256);
+    return spectrum;
+  }
+
+  template <typename Function>
+  double measureRate(std::size_t p_evaluations, std::size_t p_repetitions, Function &&p_function)
+  {
+    double best = 0;
+    for (std::size_t r = 0; r < p_repetitions; ++r)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      p_function();
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      best = std::max(best, p_evaluations / elapsed.count());
+    }
+    return best;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const std::size_t samples = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  const std::size_t repetitions = argc > 2 ? std::stoul(argv[2]) : 5;
+  const double energyTolerance = 1e-12; // relative
+
+  std::mt19937_64 randomEngine(12345);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<double> randoms(samples);
+  for (double &u : randoms)
+    u = uniform(randomEngine);
+
+  bool passed = true;
+  std::printf("Scintillation energy sampling, %zu samples, best of %zu repetitions\n", samples, repetitions);
+  for (std::size_t nodes : {27, 500})
+  {
+    const Integral integral = generateIntegral(nodes);
+    const ScintillationSpectrum spectrum = toSpectrum(integral);
+    const double maximum = integral.values.back();
+    std::vector<double> referenceEnergies(samples), guidedEnergies(samples);
+
+    auto runReference = [&]()
+    {
+      for (std::size_t k = 0; k < samples; ++k)
+        referenceEnergies[k] = Reference::getEnergy(integral.energies, integral.values, randoms[k] * maximum);
+    };
+    auto runGuided = [&]()
+    {
+      for (std::size_t k = 0; k < samples; ++k)
+        guidedEnergies[k] = ScintillationKernels::sampleEnergy(spectrum, randoms[k]);
+    };
+    const double referenceRate = measureRate(samples, repetitions, runReference);
+    const double guidedRate = measureRate(samples, repetitions, runGuided);
+
+    double maxDeviation = 0;
+    for (std::size_t k = 0; k < samples; ++k)
+      maxDeviation = std::max(maxDeviation, std::abs(guidedEnergies[k] - referenceEnergies[k]) / referenceEnergies[k]);
+    passed = passed && maxDeviation <= energyTolerance;
+
+    std::printf("  %zu nodes\n", nodes);
+    std::printf("    %-10s %14.4e samples/s\n", "bisection", referenceRate);
+    std::printf("    %-10s %14.4e samples/s (x%.2f)\n", "guided", guidedRate, guidedRate / referenceRate);
+    std::printf("    Max. relative deviation w.r.t. bisection: %.3e (tolerance %.1e)\n", maxDeviation, energyTolerance);
+  }
+
+  std::printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
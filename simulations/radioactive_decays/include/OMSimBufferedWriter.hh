@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @brief Defines the OMSimBufferedWriter class, an output file written from a background thread.
+ * @ingroup radioactive
+ */
+
+#pragma once
+
+#include <globals.hh>
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class OMSimBufferedWriter
+ * @brief Output file whose rows are collected in a large buffer and written to disk by a background thread.
+ *
+ * Rows are appended to the active buffer without any formatting or flushing. When the buffer is full, it is handed over to
+ * the writer thread and the caller continues with an empty buffer, so the calling (simulation) thread only waits if the
+ * disk is slower than the simulation. The file is opened in binary mode and gets the bytes as appended, so files of
+ * several writers can be merged by concatenation.
+ *
+ * A writer belongs to one simulation thread; it is not safe to append from several threads.
+ * @ingroup radioactive
+ */
+class OMSimBufferedWriter
+{
+public:
+  OMSimBufferedWriter(const G4String &pFileName, std::size_t pBufferSize);
+  ~OMSimBufferedWriter();
+  OMSimBufferedWriter(const OMSimBufferedWriter &) = delete;
+  OMSimBufferedWriter &operator=(const OMSimBufferedWriter &) = delete;
+
+  void write(const char *pData, std::size_t pSize);
+  void write(const std::string &pText) { write(pText.data(), pText.size()); };
+  /**
+   * @brief Appends the bytes of a value (native byte order).
+   */
+  template <typename T>
+  void writeValue(const T &pValue) { write(reinterpret_cast<const char *>(&pValue), sizeof(T)); };
+  void close();
+  const G4String &getFileName() const { return m_fileName; };
+
+private:
+  void submitBuffer();
+  void writeBuffers();
+
+  G4String m_fileName;
+  std::ofstream m_file;
+  std::size_t m_bufferSize;
+  std::vector<char> m_activeBuffer;  ///< Buffer filled by the simulation thread
+  std::vector<char> m_pendingBuffer; ///< Full buffer waiting for the writer thread
+  std::vector<char> m_writingBuffer; ///< Buffer being written by the writer thread
+  bool m_hasPendingBuffer = false;
+  bool m_isClosing = false;
+  bool m_isClosed = false;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::thread m_writerThread;
+};
@@ -0,0 +1,101 @@
+/**
+ * @file
+ * @brief Defines the OMSimDecayLibrary class, a library of simulated decay hit patterns that are resampled to assemble long livetimes.
+ * @ingroup radioactive
+ */
+
+#pragma once
+#include "OMSimBufferedWriter.hh"
+#include <G4AutoLock.hh>
+#include <globals.hh>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief A hit of a library pattern, with its time relative to the start of its segment.
+ * @ingroup radioactive
+ */
+struct DecayLibraryHit
+{
+    G4double time;                 ///< Time after the start of the segment.
+    G4int PMT;                     ///< ID of the PMT that detected the photon.
+    G4double energy;               ///< Energy of the detected photon.
+    G4double PE;                   ///< Charge in photoelectrons.
+    G4double transitTime;          ///< Detection time relative to average response of PMT.
+    G4double detectionProbability; ///< Probability of photon being detected.
+};
+
+/**
+ * @brief Simulated decay chains of one isotope in one kind of volume.
+ *
+ * A chain (one event of the build) is stored as its segments: a segment starts at the primary decay or at a decay of the
+ * chain that was moved to a random time of the window (see OMSimG4VRadioactiveDecay), and contains the hits that follow it.
+ * Chains and segments are stored as offsets into flat arrays: the segments of chain i are
+ * [chainSegments[i], chainSegments[i+1]) and the hits of segment j are [segmentHits[j], segmentHits[j+1]).
+ * @ingroup radioactive
+ */
+struct DecayLibraryGroup
+{
+    G4String isotope;                         ///< Isotope that starts the chains.
+    G4String volume;                          ///< Kind of volume, "PressureVessel" or "PMTs".
+    G4double rate = 0;                        ///< Chains per second in all volumes of the kind.
+    std::vector<std::uint64_t> chainSegments = {0}; ///< Offsets of the segments of each chain.
+    std::vector<std::uint64_t> segmentHits = {0};   ///< Offsets of the hits of each segment.
+    std::vector<DecayLibraryHit> hits;        ///< Hits of all segments.
+
+    std::size_t getNumberOfChains() const { return chainSegments.size() - 1; };
+    void append(const DecayLibraryGroup &pOther);
+    void clear();
+};
+
+/**
+ * @brief A hit of an assembled time window.
+ * @ingroup radioactive
+ */
+struct AssembledHit
+{
+    G4double time;              ///< Time of the hit in the window.
+    const DecayLibraryHit *hit; ///< Library hit that was placed.
+};
+
+/**
+ * @ingroup radioactive
+ * @brief Singleton class that builds, stores and resamples a library of decay hit patterns.
+ *
+ * Building: a fixed number of chains per isotope and kind of volume is simulated (OMSimDecaysGPS::scheduleLibraryDecays).
+ * At the end of each event, the hits of the calling thread are split into segments and kept (appendEvent); after each run
+ * the chains of all threads are collected in a group (closeGroup). The library is written to a binary file with a text header.
+ *
+ * Assembling: for each time window, the Poisson number of chains of each group is drawn from its rate, library chains are
+ * picked at random (with replacement), and each of their segments is placed at an independent uniform time of the window,
+ * as the simulation does with the decays it moves to a random time. The hits are written or used for the multiplicity.
+ */
+class OMSimDecayLibrary
+{
+public:
+    static OMSimDecayLibrary &getInstance();
+
+    void appendEvent();
+    void closeGroup(const G4String &pIsotope, const G4String &pVolume, G4double pRate);
+    void write(const G4String &pFileName, G4int pNumberOfPMTs, G4double pTimeWindow);
+    void read(const G4String &pFileName);
+    std::vector<AssembledHit> assembleWindow(G4double pTimeWindow) const;
+    void writeHits(G4int pWindow, const std::vector<AssembledHit> &pHits);
+    void closeOutput();
+    G4int getNumberOfPMTs() const { return m_numberOfPMTs; };
+
+private:
+    std::vector<DecayLibraryGroup> m_groups;
+    G4int m_numberOfPMTs = 0;
+    std::unique_ptr<OMSimBufferedWriter> m_hitWriter; ///< Output of the assembled hits, opened on first use
+
+    static G4Mutex m_mutex;
+    static std::vector<std::unique_ptr<DecayLibraryGroup>> m_threadGroups; ///< Chains of all threads, owned here so they can be collected after the run
+    G4ThreadLocal static DecayLibraryGroup *m_threadGroup;                 ///< Chains of the calling thread, registered in m_threadGroups on first use
+
+    OMSimDecayLibrary() = default;
+    ~OMSimDecayLibrary() = default;
+    OMSimDecayLibrary(const OMSimDecayLibrary &) = delete;
+    OMSimDecayLibrary &operator=(const OMSimDecayLibrary &) = delete;
+};
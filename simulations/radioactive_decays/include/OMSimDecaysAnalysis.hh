@@ -5,8 +5,11 @@
  */
 
 #pragma once
+#include "OMSimBufferedWriter.hh"
+#include "OMSimPMTResponse.hh"
 #include <G4ThreeVector.hh>
 #include <fstream>
+#include <memory>
 #include "G4AutoLock.hh"
 
 /**
@@ -19,6 +22,21 @@ struct DecayStats
     std::vector<G4String> isotopeName;        ///< Isotope name and energy level
     std::vector<G4double> decayTime;          ///< Time of the decay after (possibly) randomising inside simulation time window
     std::vector<G4ThreeVector> decayPosition; ///< Global position of the decay.
+    std::vector<bool> isTimeRandomised;       ///< Whether the decay was moved to a random time of the window (starts a new segment of the chain)
+};
+
+/**
+ * @brief A hit of the continuous stream of a chunked livetime, see OMSimDecaysAnalysis::writeChunkWindow.
+ * @ingroup radioactive
+ */
+struct StreamHit
+{
+    G4long window;                          ///< Global index of the time window.
+    G4double time;                          ///< Time since the start of the window, smaller than the window length.
+    G4int PMT;                              ///< ID of the PMT that detected the photon.
+    G4double energy;                        ///< Energy of the detected photon.
+    G4ThreeVector globalPosition;           ///< Global position of the detected photon.
+    OMSimPMTResponse::PMTPulse PMTresponse; ///< PMT's response to the detected photon.
 };
 
 /**
@@ -32,17 +50,31 @@ public:
      * @brief Returns the instance of OMSimDecaysAnalysis (Singleton pattern).
      */
     static OMSimDecaysAnalysis &getInstance();
-    void appendDecay(G4String pParticleName, G4double pDecayTime, G4ThreeVector pDecayPosition);
+    void appendDecay(G4String pParticleName, G4double pDecayTime, G4ThreeVector pDecayPosition, bool pIsTimeRandomised = false);
+    const DecayStats *getThreadDecayStats() const { return m_threadDecayStats; };
     void mergeDecayData();
     void mergeFiles();
-    void writeMultiplicity(G4double pTimeWindow);
+    void writeMultiplicity(const std::vector<G4double> &pTimeWindows, bool pPairCoincidences = false);
+    void writeMultiplicity(std::vector<std::pair<G4double, G4int>> &pHits, G4int pNumberOfPMTs, const std::vector<G4double> &pTimeWindows, bool pPairCoincidences);
     void writeThreadDecayInformation();
     void writeThreadHitInformation();
     void reset();
+    void resetThreadDecays();
+    void writeChunkWindow(G4long pWindow, G4double pTimeWindow);
+    void closeChunk();
+    static void mergeChunks(const std::vector<std::string> &pFileNames);
+    static G4String getBinaryHeader(const std::vector<std::pair<G4String, G4String>> &pColumns);
     
 private:
     G4ThreadLocal static DecayStats *m_threadDecayStats;
-    void mergeThreadFiles(G4String p_FileEnd);
+    G4ThreadLocal static OMSimBufferedWriter *m_threadDecayWriter; ///< Decay file of the calling thread, registered in m_writers on first use
+    G4ThreadLocal static OMSimBufferedWriter *m_threadHitWriter;   ///< Hit file of the calling thread, registered in m_writers on first use
+    static std::vector<std::unique_ptr<OMSimBufferedWriter>> m_writers; ///< Output files of all threads, owned here so they can be closed before merging
+    OMSimBufferedWriter *openThreadWriter(const G4String &pFileEnd);
+    void mergeThreadFiles(G4String p_FileEnd, const G4String &pBinaryHeader);
+    G4String getWindowFileName(const G4String &pFileEnd, G4double pTimeWindow, bool pSeveralWindows);
+    std::unique_ptr<OMSimBufferedWriter> m_chunkWriter; ///< Hit stream of the chunk simulated by this process, opened on first use
+    std::vector<StreamHit> m_carriedHits;               ///< Hits after the end of the last written window, written with the next windows
 
     static G4Mutex m_mutex;
 
@@ -6,10 +6,54 @@
 
 #pragma once
 #include "OMSimOpticalModule.hh"
+#include "OMSimVolumeSampler.hh"
+#include <G4ParticleDefinition.hh>
+#include <G4VUserEventInformation.hh>
 #include <globals.hh>
+#include <memory>
+
+/**
+ * @brief One primary of the decay schedule of a time window.
+ */
+struct ScheduledDecay
+{
+  G4ParticleDefinition *ion;  ///< Isotope at rest that starts the decay chain.
+  G4ThreeVector position;     ///< Decay vertex, uniform in the volume.
+  G4String terminationNuclide; ///< The chain stops at this nuclide, "none" to follow it to the end.
+  const OMSimVolumePlacement *volume; ///< Volume of the decay, in which the daughters of the chain are placed as well.
+};
+
+/**
+ * @class DecayChainInformation
+ * @brief Event information carrying the settings of the decay chain of the event, read by the decay processes during tracking.
+ *
+ * Attached to each event by OMSimPrimaryGeneratorAction, so the worker threads take the termination nuclide and the volume
+ * of the chain from their own event instead of shared state, and chains with different settings can be simulated in the same run.
+ * @ingroup radioactive
+ */
+class DecayChainInformation : public G4VUserEventInformation
+{
+public:
+  DecayChainInformation(const G4String &pTerminationNuclide, const OMSimVolumePlacement *pVolume)
+      : m_terminationNuclide(pTerminationNuclide), m_volume(pVolume){};
+  void Print() const override { G4cout << "Decay chain terminated at: " << m_terminationNuclide << G4endl; };
+  const G4String &getTerminationNuclide() const { return m_terminationNuclide; };
+  const OMSimVolumePlacement *getVolume() const { return m_volume; };
+
+private:
+  G4String m_terminationNuclide; ///< The chain stops at this nuclide, "none" to follow it to the end.
+  const OMSimVolumePlacement *m_volume; ///< Volume of the decay, in which the daughters of the chain are placed as well.
+};
+
 /**
  * @class OMSimDecaysGPS
  * @brief A class for simulating isotope decays inside the pressure vessel and PMT glass.
+ *
+ * The decays of a time window are scheduled first: the Poisson decay counts of every isotope and volume are drawn up
+ * front and one ScheduledDecay is added per decay, with its vertex sampled in the volume. The whole schedule is then
+ * simulated in a single run (runScheduledDecays), in which event i is the decay i of the schedule (see
+ * OMSimPrimaryGeneratorAction). So the workers are never synchronised between isotopes or volumes. The settings of the chain
+ * are attached to the event (DecayChainInformation), which is all the decay processes read during tracking.
  * @ingroup radioactive
  */
 class OMSimDecaysGPS
@@ -22,27 +66,32 @@ public:
     return instance;
   }
 
-  void simulateDecaysInPMTs(G4double pTimeWindow);
-  void simulateDecaysInPressureVessel(G4double pTimeWindow);
+  void scheduleDecaysInPMTs(G4double pTimeWindow);
+  void scheduleDecaysInPressureVessel(G4double pTimeWindow);
+  G4double getDecayRate(const G4String &pIsotope, bool pInPMTs);
+  G4double scheduleLibraryDecays(const G4String &pIsotope, G4int pDecays, bool pInPMTs);
+  void runScheduledDecays();
+  std::vector<G4String> getIsotopes() const;
+  const ScheduledDecay &getScheduledDecay(G4int pEventID) const { return m_schedule.at(pEventID); };
 
   /**
    * @brief Set the optical module to be used.
    * @param p_opticalModule Pointer to the optical module.
    */
   void setOpticalModule(OMSimOpticalModule *p_opticalModule) { m_opticalModule = p_opticalModule; };
-  void setProductionRadius(G4double pProductionRadius);
-  G4String getDecayTerminationNuclide();
-  G4ThreeVector sampleNextDecayPosition(G4ThreeVector p_currentPosition);
+  static const G4String &getDecayTerminationNuclide();
+  static G4ThreeVector sampleNextDecayPosition();
+  void checkVolumeSamplers(G4int pSamples);
 
 private:
-  // Define a map that maps isotopes to their GPS commands
-  std::map<G4String, G4String> m_isotopeCommands = {
-      {"U238", "/gps/ion 92 238 0"},
-      {"U235", "/gps/ion 92 235 0"},
-      {"Ra226", "/gps/ion 88 226 0"},
-      {"Ra224", "/gps/ion 88 224 0"},
-      {"Th232", "/gps/ion 90 232 0"},
-      {"K40", "/gps/ion 19 40 0"}};
+  // Define a map that maps isotopes to their atomic and mass number
+  std::map<G4String, std::pair<G4int, G4int>> m_isotopes = {
+      {"U238", {92, 238}},
+      {"U235", {92, 235}},
+      {"Ra226", {88, 226}},
+      {"Ra224", {88, 224}},
+      {"Th232", {90, 232}},
+      {"K40", {19, 40}}};
 
   // Define a map that maps isotopes to their termination isotope (Ra is gas state and chains are often not in secular equilibrium)
   // Ra224 with a lifetime of ~4d breaks equilibrium far less than Ra226, with half life ~1600y, so activity of Th232 and Ra224 will probably be very similar
@@ -54,12 +103,16 @@ private:
       {"U235", "none"},
       {"K40", "none"}};
 
-  void generalGPS();
-  void configureIsotopeGPS(G4String Isotope, G4String location);
+  void configureRun();
+  void scheduleDecays(const std::map<G4String, G4int> &pNumberDecays, const G4String &pVolumeName);
+  const OMSimVolumePlacement &getVolumePlacement(const G4String &pVolumeName);
+  G4VPhysicalVolume *findPlacement(G4VPhysicalVolume *pVolume, const G4String &pName, const G4Transform3D &pMotherToGlobal, G4Transform3D &pLocalToGlobal);
   std::map<G4String, G4int> calculateNumberOfDecays(G4MaterialPropertiesTable *pMPT, G4double pTimeWindow, G4double pMass);
   OMSimOpticalModule *m_opticalModule;
-  G4double m_productionRadius;
-  G4String m_nuclideStopName;
+  std::map<G4LogicalVolume *, std::unique_ptr<OMSimVolumeSampler>> m_samplers; ///< Voxelised logical volumes, built on first use
+  std::map<G4String, OMSimVolumePlacement> m_placements;                      ///< Placed volumes by physical volume name
+  bool m_runConfigured = false;
+  std::vector<ScheduledDecay> m_schedule; ///< Decays of the current time window, indexed by event ID
 
   OMSimDecaysGPS() = default;
   ~OMSimDecaysGPS() = default;
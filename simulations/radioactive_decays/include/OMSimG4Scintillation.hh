@@ -60,6 +60,8 @@
 #include "G4EmSaturation.hh"
 #include "G4OpticalPhoton.hh"
 #include "G4VRestDiscreteProcess.hh"
+#include "OMSimScintillationKernels.hh"
+#include <vector>
 
 class G4PhysicsTable;
 class G4Step;
@@ -210,6 +212,25 @@ class OMSimG4Scintillation : public G4VRestDiscreteProcess
   G4double ScintTrackEDep, ScintTrackYield;
 #endif
 
+  // Scintillation properties of a material, precomputed in BuildPhysicsTable
+  // so that PostStepDoIt neither looks up material properties nor allocates
+  struct MaterialScintillation
+  {
+    G4bool isScintillator = false;   // has a spectrum and FRACTIONLIFETIMES
+    G4double yield = 0.;             // SCINTILLATIONYIELD (all but e+, e-, gamma)
+    G4double yieldElectrons = 0.;    // SCINTILLATIONYIELDELECTRONS (e+, e-, gamma)
+    G4double resolutionScale = 0.;   // RESOLUTIONSCALE
+    std::vector<G4double> fractions; // normalised fraction of each lifetime component
+    std::vector<G4double> lifetimes; // lifetime of each component
+    ScintillationSpectrum spectrum;  // normalised scintillation integral with guide table
+  };
+
+  void BuildMaterialScintillation();
+
+  std::vector<MaterialScintillation> fMaterialScintillation;  // by material index
+  std::vector<G4int> fComponentPhotons;  // per-step buffers, sized in BuildPhysicsTable
+  std::vector<std::pair<G4double, G4int>> fFractionalParts;
+
   G4double single_exp(G4double t, G4double tau2);
   G4double bi_exp(G4double t, G4double tau1, G4double tau2);
 
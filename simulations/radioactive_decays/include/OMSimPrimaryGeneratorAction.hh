@@ -1,29 +1,28 @@
 /**
  * @file
- * @brief Defines a simple OMSimPrimaryGeneratorAction class for the radioactive decays simulation using GPS.
+ * @brief Defines the OMSimPrimaryGeneratorAction class for the radioactive decays simulation.
  * @ingroup radioactive
  */
 #pragma once
  
 #include <G4VUserPrimaryGeneratorAction.hh>
  
-class G4GeneralParticleSource;
 class G4Event;
 
 /**
  * @class
- * @brief OMSimPrimaryGeneratorAction class for the radioactive decays simulation using only GPS.
+ * @brief OMSimPrimaryGeneratorAction class for the radioactive decays simulation, reading the decay schedule of OMSimDecaysGPS.
+ *
+ * Event i starts the decay chain of the scheduled decay i: the isotope at rest at its vertex, with an isotropic direction.
+ * The termination nuclide and volume of the chain are attached to the event as DecayChainInformation.
  * @ingroup radioactive
  */
 class OMSimPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
 public:
-	OMSimPrimaryGeneratorAction();
-	~OMSimPrimaryGeneratorAction();
+	OMSimPrimaryGeneratorAction(){};
+	~OMSimPrimaryGeneratorAction(){};
 
 public:
 	void GeneratePrimaries(G4Event* anEvent);
-
-private:
-	G4GeneralParticleSource* m_particleSource;
 };
@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @brief Defines the OMSimRateEstimator class, which predicts hit and coincidence rates of decay backgrounds from a table of yields per decay.
+ * @ingroup radioactive
+ */
+
+#pragma once
+#include <G4AutoLock.hh>
+#include <globals.hh>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Detection yields of the decay chains of one isotope in one kind of volume, summed over the calibration decays.
+ *
+ * Coincidences are formed per decay chain as in OMSimDecaysAnalysis::writeMultiplicity. A cluster of a PMT is a
+ * coincidence in which the PMT was hit (each PMT is counted once per coincidence, however many hits it had).
+ * @ingroup radioactive
+ */
+struct DecayYield
+{
+    G4String isotope;                         ///< Isotope that starts the chains.
+    G4String volume;                          ///< Kind of volume, "PressureVessel" or "PMTs".
+    G4long decays = 0;                        ///< Number of simulated chains.
+    G4long coincidences = 0;                  ///< Coincidences with at least two PMTs.
+    std::vector<G4long> hits;                 ///< Hits of each PMT.
+    std::vector<G4long> clusters;             ///< Clusters of each PMT.
+    std::vector<G4long> coincidentClusters;   ///< Clusters of each PMT in coincidences with at least two PMTs.
+
+    void add(const DecayYield &pOther);
+    void clear();
+};
+
+/**
+ * @ingroup radioactive
+ * @brief Singleton class that estimates the hit and coincidence rates of a module without simulating time windows.
+ *
+ * Calibration: a fixed number of chains per isotope and kind of volume is simulated (as for the decay library, see
+ * OMSimDecaysGPS::scheduleLibraryDecays). The hits and coincidences of each chain are tallied at the end of its event
+ * (appendEvent) and summed over the threads after each run (closeGroup). The yields per decay are written to a text table.
+ *
+ * Estimation: each yield per decay is multiplied with the decay rate of its isotope in its volume, from the current
+ * material activities and masses (OMSimDecaysGPS::getDecayRate). So a table can be reused for other activities. Besides
+ * the rates caused by single chains, the accidental coincidence rate between independent chains is estimated from the
+ * cluster rates, 2 T R_i R_j for PMTs i and j and coincidence window T (valid while the rates times T are small).
+ */
+class OMSimRateEstimator
+{
+public:
+    static OMSimRateEstimator &getInstance();
+
+    void configure(G4int pNumberOfPMTs, G4double pCoincidenceWindow);
+    void appendEvent();
+    void closeGroup(const G4String &pIsotope, const G4String &pVolume);
+    void write(const G4String &pFileName) const;
+    void read(const G4String &pFileName);
+    void writeEstimate(const G4String &pFileName) const;
+    G4int getNumberOfPMTs() const { return m_numberOfPMTs; };
+
+private:
+    std::vector<DecayYield> m_yields;
+    G4int m_numberOfPMTs = 0;
+    G4double m_coincidenceWindow = 0;
+
+    static G4Mutex m_mutex;
+    static std::vector<std::unique_ptr<DecayYield>> m_threadYields; ///< Tallies of all threads, owned here so they can be collected after the run
+    G4ThreadLocal static DecayYield *m_threadYield;                 ///< Tallies of the calling thread, registered in m_threadYields on first use
+
+    OMSimRateEstimator() = default;
+    ~OMSimRateEstimator() = default;
+    OMSimRateEstimator(const OMSimRateEstimator &) = delete;
+    OMSimRateEstimator &operator=(const OMSimRateEstimator &) = delete;
+};
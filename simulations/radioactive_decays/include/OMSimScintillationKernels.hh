@@ -0,0 +1,68 @@
+/**
+ * @file OMSimScintillationKernels.hh
+ * @brief Geant4-independent sampling of the scintillation photon energy used by OMSimG4Scintillation.
+ *
+ * The functions in this file only depend on the standard library, so they can be tested and benchmarked
+ * outside of Geant4 (see simulations/radioactive_decays/benchmarks/scintillation_bench.cc).
+ * @ingroup radioactive
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct ScintillationSpectrum
+ * @brief Normalised scintillation integral (cumulative photon energy spectrum) of a material with its guide table.
+ */
+struct ScintillationSpectrum
+{
+  std::vector<double> energies;  ///< Photon energies of the integral nodes.
+  std::vector<double> integral;  ///< Integral at energies, normalised to 1.
+  std::vector<std::size_t> guide; ///< guide[k]: last node with integral <= k/guide.size().
+};
+
+namespace ScintillationKernels
+{
+  /**
+   * @brief Fills the guide table of a spectrum whose energies and integral are set.
+   * @param pSpectrum Spectrum to complete.
+   * @param pGuideSize Number of guide entries.
+   */
+  inline void buildGuide(ScintillationSpectrum &pSpectrum, std::size_t pGuideSize)
+  {
+    pSpectrum.guide.resize(pGuideSize);
+    std::size_t node = 0;
+    for (std::size_t k = 0; k < pGuideSize; ++k)
+    {
+      double u = double(k) / pGuideSize;
+      while (node + 2 < pSpectrum.integral.size() && pSpectrum.integral[node + 1] <= u)
+        ++node;
+      pSpectrum.guide[k] = node;
+    }
+  }
+
+  /**
+   * @brief Inverse of the normalised scintillation integral, interpolated linearly between its nodes as G4PhysicsVector::GetEnergy.
+   *
+   * The guide table gives the node below u directly, so that the integral is searched in O(1) instead of by bisection.
+   * @param pSpectrum Spectrum with guide table, see buildGuide.
+   * @param u Uniform random number in [0, 1).
+   * @return Photon energy.
+   */
+  inline double sampleEnergy(const ScintillationSpectrum &pSpectrum, double u)
+  {
+    const std::size_t nodes = pSpectrum.integral.size();
+    if (nodes < 2)
+      return pSpectrum.energies[0];
+    std::size_t i = pSpectrum.guide[std::min(std::size_t(u * pSpectrum.guide.size()), pSpectrum.guide.size() - 1)];
+    while (i + 2 < nodes && pSpectrum.integral[i + 1] <= u)
+      ++i;
+    double width = pSpectrum.integral[i + 1] - pSpectrum.integral[i];
+    if (width <= 0.)
+      return pSpectrum.energies[i];
+    return pSpectrum.energies[i] + (u - pSpectrum.integral[i]) * (pSpectrum.energies[i + 1] - pSpectrum.energies[i]) / width;
+  }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file
+ * @brief Defines the OMSimVolumeSampler class, a uniform sampler of decay vertices in a volume.
+ * @ingroup radioactive
+ */
+
+#pragma once
+
+#include <G4LogicalVolume.hh>
+#include <G4Point3D.hh>
+#include <G4Transform3D.hh>
+#include <G4ThreeVector.hh>
+#include <G4VSolid.hh>
+#include <vector>
+
+/**
+ * @class OMSimVolumeSampler
+ * @brief Samples points uniformly in the material of a logical volume (its solid minus its daughters), without navigator calls.
+ *
+ * The bounding box of the solid is divided into equal voxels once. Using the safety distances of the solids, each voxel is
+ * classified as empty (no material), full (only material), or boundary. The occupied (full and boundary) voxels are kept
+ * in a flat list. Voxels have equal volume, so a uniform pick from the list is a draw with the voxels' cumulative volume
+ * weights. A point is drawn uniformly in the picked voxel and, for boundary voxels only, tested with G4VSolid::Inside of the
+ * solid and its daughters and redrawn if it is outside the material. This rejection keeps the distribution exactly uniform.
+ * The expected number of draws per point is the occupied volume over the material volume, close to one for fine voxels,
+ * so sampling takes constant time even for thin shells such as the PMT glass.
+ *
+ * A sampler is read-only after construction and can be shared by all threads.
+ * @ingroup radioactive
+ */
+class OMSimVolumeSampler
+{
+public:
+  OMSimVolumeSampler(G4LogicalVolume *pLogicalVolume, G4int pTargetVoxels);
+
+  G4ThreeVector sample() const;
+  bool contains(const G4ThreeVector &pLocalPoint) const;
+  G4double estimateVolume(G4int pSamples) const;
+  G4double getOccupiedVolume() const { return m_voxels.size() * m_voxelSize.x() * m_voxelSize.y() * m_voxelSize.z(); };
+  std::size_t getNumberOfFullVoxels() const { return m_numberOfFullVoxels; };
+  std::size_t getNumberOfVoxels() const { return m_voxels.size(); };
+  G4LogicalVolume *getLogicalVolume() const { return m_logicalVolume; };
+
+private:
+  /**
+   * @brief A voxel containing material.
+   */
+  struct Voxel
+  {
+    G4ThreeVector corner; ///< Corner with the lowest coordinates, in the frame of the logical volume.
+    bool boundary;        ///< True if the voxel may contain points outside the material.
+  };
+
+  /**
+   * @brief Solid of a daughter and the transformation from the frame of the mother to the daughter.
+   */
+  struct Daughter
+  {
+    G4VSolid *solid;
+    G4Transform3D motherToDaughter;
+  };
+
+  G4ThreeVector randomPointInVoxel(const Voxel &pVoxel) const;
+
+  G4LogicalVolume *m_logicalVolume;
+  G4VSolid *m_solid;
+  std::vector<Daughter> m_daughters;
+  std::vector<Voxel> m_voxels; ///< Occupied voxels
+  std::size_t m_numberOfFullVoxels = 0;
+  G4ThreeVector m_voxelSize;
+};
+
+/**
+ * @brief A placed volume with its sampler: samples global decay vertices in one physical volume.
+ * @ingroup radioactive
+ */
+struct OMSimVolumePlacement
+{
+  G4String name;                     ///< Name of the physical volume.
+  const OMSimVolumeSampler *sampler; ///< Sampler of its logical volume, shared by all placements of it.
+  G4Transform3D localToGlobal;       ///< Transformation from the frame of the logical volume to the world.
+
+  G4ThreeVector sample() const;
+};
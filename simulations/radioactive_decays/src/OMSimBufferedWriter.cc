@@ -0,0 +1,114 @@
+#include "OMSimBufferedWriter.hh"
+#include "OMSimLogger.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @brief Opens (truncates) the file and starts the writer thread.
+ * @param p_fileName Name of the output file.
+ * @param p_bufferSize Size in bytes of the buffer handed to the writer thread. Two full buffers can be in memory at once.
+ */
+OMSimBufferedWriter::OMSimBufferedWriter(const G4String &p_fileName, std::size_t p_bufferSize)
+    : m_fileName(p_fileName), m_bufferSize(std::max<std::size_t>(p_bufferSize, 1))
+{
+    m_file.open(m_fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        log_error("Failed to open output file {}", m_fileName);
+        throw std::runtime_error("Failed to open output file " + m_fileName);
+    }
+    m_activeBuffer.reserve(m_bufferSize);
+    m_writerThread = std::thread(&OMSimBufferedWriter::writeBuffers, this);
+    log_trace("Opened buffered output file {} ({} bytes buffer)", m_fileName, m_bufferSize);
+}
+
+OMSimBufferedWriter::~OMSimBufferedWriter()
+{
+    close();
+}
+
+/**
+ * @brief Appends bytes to the file. The bytes reach the disk once the buffer is full or the writer is closed.
+ */
+void OMSimBufferedWriter::write(const char *p_data, std::size_t p_size)
+{
+    if (m_isClosed)
+    {
+        throw std::runtime_error("Writing to closed output file " + m_fileName);
+    }
+    if (!m_activeBuffer.empty() && m_activeBuffer.size() + p_size > m_bufferSize)
+    {
+        submitBuffer();
+    }
+    m_activeBuffer.insert(m_activeBuffer.end(), p_data, p_data + p_size);
+}
+
+/**
+ * @brief Hands the active buffer to the writer thread, waiting if the previous one has not been taken yet.
+ */
+void OMSimBufferedWriter::submitBuffer()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]
+                     { return !m_hasPendingBuffer; });
+    std::swap(m_activeBuffer, m_pendingBuffer);
+    m_hasPendingBuffer = true;
+    lock.unlock();
+    m_condition.notify_all();
+
+    m_activeBuffer.clear();
+    m_activeBuffer.reserve(m_bufferSize);
+}
+
+/**
+ * @brief Loop of the writer thread, writes the pending buffers until the writer is closed.
+ */
+void OMSimBufferedWriter::writeBuffers()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]
+                         { return m_hasPendingBuffer || m_isClosing; });
+        if (!m_hasPendingBuffer)
+        {
+            return;
+        }
+        std::swap(m_pendingBuffer, m_writingBuffer);
+        m_hasPendingBuffer = false;
+        lock.unlock();
+        m_condition.notify_all();
+
+        m_file.write(m_writingBuffer.data(), m_writingBuffer.size());
+        if (!m_file)
+        {
+            log_error("Failed writing {} bytes to {}", m_writingBuffer.size(), m_fileName);
+        }
+        m_writingBuffer.clear();
+    }
+}
+
+/**
+ * @brief Writes the remaining data, stops the writer thread and closes the file. Further calls do nothing.
+ */
+void OMSimBufferedWriter::close()
+{
+    if (m_isClosed)
+    {
+        return;
+    }
+    if (!m_activeBuffer.empty())
+    {
+        submitBuffer();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isClosing = true;
+    }
+    m_condition.notify_all();
+    m_writerThread.join();
+    m_file.close();
+    m_isClosed = true;
+    log_trace("Closed buffered output file {}", m_fileName);
+}
@@ -0,0 +1,321 @@
+#include "OMSimDecayLibrary.hh"
+#include "OMSimCommandArgsTable.hh"
+#include "OMSimDecaysAnalysis.hh"
+#include "OMSimHitManager.hh"
+#include "OMSimLogger.hh"
+
+#include <G4Poisson.hh>
+#include <G4SystemOfUnits.hh>
+#include <Randomize.hh>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+G4Mutex OMSimDecayLibrary::m_mutex = G4Mutex();
+std::vector<std::unique_ptr<DecayLibraryGroup>> OMSimDecayLibrary::m_threadGroups;
+G4ThreadLocal DecayLibraryGroup *OMSimDecayLibrary::m_threadGroup = nullptr;
+
+/**
+ * @brief Columns of the binary file of assembled hits, name (with unit) and numpy type code.
+ */
+static const std::vector<std::pair<G4String, G4String>> g_assembledHitColumns = {
+	{"window", "<i4"}, {"hitTime[s]", "<f8"}, {"PMTnr", "<i4"}, {"energy[eV]", "<f8"}, {"PE", "<f8"}, {"transitTime[ns]", "<f8"}, {"detectionProbability", "<f8"}};
+
+/**
+ * @brief Appends the chains of another group, shifting its offsets.
+ */
+void DecayLibraryGroup::append(const DecayLibraryGroup &p_other)
+{
+	const std::uint64_t segmentOffset = segmentHits.size() - 1;
+	const std::uint64_t hitOffset = hits.size();
+	for (std::size_t i = 1; i < p_other.chainSegments.size(); i++)
+		chainSegments.push_back(p_other.chainSegments[i] + segmentOffset);
+	for (std::size_t i = 1; i < p_other.segmentHits.size(); i++)
+		segmentHits.push_back(p_other.segmentHits[i] + hitOffset);
+	hits.insert(hits.end(), p_other.hits.begin(), p_other.hits.end());
+}
+
+/**
+ * @brief Removes all chains.
+ */
+void DecayLibraryGroup::clear()
+{
+	chainSegments = {0};
+	segmentHits = {0};
+	hits.clear();
+}
+
+OMSimDecayLibrary &OMSimDecayLibrary::getInstance()
+{
+	static OMSimDecayLibrary instance;
+	return instance;
+}
+
+/**
+ * @brief Stores the hits of the current event of the calling thread as one chain. Call at the end of the event, before the data is reset.
+ *
+ * Segments start at the decays moved to a random time of the window and at the earliest decay of the event. Each hit is
+ * assigned to the last segment that started before it. Segments without hits are dropped, chains without hits are kept.
+ */
+void OMSimDecayLibrary::appendEvent()
+{
+	if (!m_threadGroup)
+	{
+		G4AutoLock lock(&m_mutex);
+		m_threadGroups.push_back(std::make_unique<DecayLibraryGroup>());
+		m_threadGroup = m_threadGroups.back().get();
+	}
+
+	std::vector<G4double> segmentStarts;
+	if (const DecayStats *decays = OMSimDecaysAnalysis::getInstance().getThreadDecayStats())
+	{
+		for (std::size_t i = 0; i < decays->decayTime.size(); i++)
+		{
+			if (decays->isTimeRandomised.at(i))
+				segmentStarts.push_back(decays->decayTime.at(i) * s);
+		}
+		if (!decays->decayTime.empty())
+			segmentStarts.push_back(*std::min_element(decays->decayTime.begin(), decays->decayTime.end()) * s);
+	}
+	if (segmentStarts.empty())
+		segmentStarts.push_back(0.);
+	std::sort(segmentStarts.begin(), segmentStarts.end());
+	segmentStarts.erase(std::unique(segmentStarts.begin(), segmentStarts.end()), segmentStarts.end());
+
+	OMSimHitManager &hitManager = OMSimHitManager::getInstance();
+	if (hitManager.areThereHitsInModuleSingleThread())
+	{
+		HitStats hits = hitManager.getSingleThreadHitsOfModule();
+		std::vector<std::vector<DecayLibraryHit>> segments(segmentStarts.size());
+		for (std::size_t i = 0; i < hits.hitTime.size(); i++)
+		{
+			G4double hitTime = hits.hitTime.at(i);
+			std::size_t segment = std::upper_bound(segmentStarts.begin(), segmentStarts.end(), hitTime) - segmentStarts.begin();
+			segment = std::max<std::size_t>(segment, 1) - 1;
+			const OMSimPMTResponse::PMTPulse &response = hits.PMTresponse.at(i);
+			segments[segment].push_back({hitTime - segmentStarts[segment], hits.PMTnr.at(i), hits.energy.at(i),
+										 response.PE, response.transitTime, response.detectionProbability});
+		}
+		for (const auto &segment : segments)
+		{
+			if (segment.empty())
+				continue;
+			m_threadGroup->hits.insert(m_threadGroup->hits.end(), segment.begin(), segment.end());
+			m_threadGroup->segmentHits.push_back(m_threadGroup->hits.size());
+		}
+	}
+	m_threadGroup->chainSegments.push_back(m_threadGroup->segmentHits.size() - 1);
+}
+
+/**
+ * @brief Collects the chains stored by all threads in the last run into a new group. Call on the master after the run.
+ * @param p_isotope Isotope of the run.
+ * @param p_volume Kind of volume of the run.
+ * @param p_rate Chains per second in all volumes of the kind.
+ */
+void OMSimDecayLibrary::closeGroup(const G4String &p_isotope, const G4String &p_volume, G4double p_rate)
+{
+	DecayLibraryGroup group;
+	group.isotope = p_isotope;
+	group.volume = p_volume;
+	group.rate = p_rate;
+	{
+		G4AutoLock lock(&m_mutex);
+		for (auto &threadGroup : m_threadGroups)
+		{
+			group.append(*threadGroup);
+			threadGroup->clear();
+		}
+	}
+	log_info("Decay library: {} chains of {} in {} with {} hits ({:.4g} chains/s)", group.getNumberOfChains(), p_isotope, p_volume, group.hits.size(), p_rate);
+	m_groups.push_back(std::move(group));
+}
+
+/**
+ * @brief Writes the library to a file.
+ *
+ * The file starts with a text header (lines starting with "#", one "# group" line per group with isotope, volume, rate in
+ * 1/s, and numbers of chains, segments and hits), ending with "# end_header". Then, for each group, the chain offsets and
+ * segment offsets (uint64) and the packed hits (time in ns, PMT as int32, energy in eV, PE, transit time in ns, detection
+ * probability, all other values float64) follow, in native byte order.
+ * @param p_fileName Name of the library file.
+ * @param p_numberOfPMTs Number of PMTs of the module.
+ * @param p_timeWindow Time window (in s) of the build runs.
+ */
+void OMSimDecayLibrary::write(const G4String &p_fileName, G4int p_numberOfPMTs, G4double p_timeWindow)
+{
+	std::ofstream file(p_fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open decay library file " + p_fileName);
+
+	file << "# OMSim decay library v1\n";
+	file << "# number_of_PMTs " << p_numberOfPMTs << "\n";
+	file << "# time_window[s] " << p_timeWindow << "\n";
+	for (const auto &group : m_groups)
+	{
+		file << fmt::format("# group {} {} {:.17g} {} {} {}\n", group.isotope, group.volume, group.rate,
+							group.getNumberOfChains(), group.segmentHits.size() - 1, group.hits.size());
+	}
+	file << "# end_header\n";
+
+	for (const auto &group : m_groups)
+	{
+		file.write(reinterpret_cast<const char *>(group.chainSegments.data()), group.chainSegments.size() * sizeof(std::uint64_t));
+		file.write(reinterpret_cast<const char *>(group.segmentHits.data()), group.segmentHits.size() * sizeof(std::uint64_t));
+		for (const auto &hit : group.hits)
+		{
+			file.write(reinterpret_cast<const char *>(&hit.time), sizeof(G4double));
+			file.write(reinterpret_cast<const char *>(&hit.PMT), sizeof(G4int));
+			file.write(reinterpret_cast<const char *>(&hit.energy), sizeof(G4double));
+			file.write(reinterpret_cast<const char *>(&hit.PE), sizeof(G4double));
+			file.write(reinterpret_cast<const char *>(&hit.transitTime), sizeof(G4double));
+			file.write(reinterpret_cast<const char *>(&hit.detectionProbability), sizeof(G4double));
+		}
+	}
+	log_info("Decay library with {} groups written to {}", m_groups.size(), p_fileName);
+}
+
+/**
+ * @brief Reads a library file written by write, replacing the groups in memory.
+ * @param p_fileName Name of the library file.
+ */
+void OMSimDecayLibrary::read(const G4String &p_fileName)
+{
+	std::ifstream file(p_fileName.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open decay library file " + p_fileName);
+
+	struct GroupSizes
+	{
+		std::size_t chains, segments, hits;
+	};
+	std::vector<GroupSizes> sizes;
+	m_groups.clear();
+
+	std::string line;
+	while (std::getline(file, line) && line != "# end_header")
+	{
+		std::istringstream entry(line);
+		std::string hash, key;
+		entry >> hash >> key;
+		if (key == "number_of_PMTs")
+		{
+			entry >> m_numberOfPMTs;
+		}
+		else if (key == "group")
+		{
+			DecayLibraryGroup group;
+			GroupSizes size;
+			entry >> group.isotope >> group.volume >> group.rate >> size.chains >> size.segments >> size.hits;
+			m_groups.push_back(std::move(group));
+			sizes.push_back(size);
+		}
+	}
+	if (line != "# end_header")
+		throw std::runtime_error("Decay library file " + p_fileName + " has no valid header");
+
+	for (std::size_t i = 0; i < m_groups.size(); i++)
+	{
+		DecayLibraryGroup &group = m_groups[i];
+		group.chainSegments.resize(sizes[i].chains + 1);
+		group.segmentHits.resize(sizes[i].segments + 1);
+		group.hits.resize(sizes[i].hits);
+		file.read(reinterpret_cast<char *>(group.chainSegments.data()), group.chainSegments.size() * sizeof(std::uint64_t));
+		file.read(reinterpret_cast<char *>(group.segmentHits.data()), group.segmentHits.size() * sizeof(std::uint64_t));
+		for (auto &hit : group.hits)
+		{
+			file.read(reinterpret_cast<char *>(&hit.time), sizeof(G4double));
+			file.read(reinterpret_cast<char *>(&hit.PMT), sizeof(G4int));
+			file.read(reinterpret_cast<char *>(&hit.energy), sizeof(G4double));
+			file.read(reinterpret_cast<char *>(&hit.PE), sizeof(G4double));
+			file.read(reinterpret_cast<char *>(&hit.transitTime), sizeof(G4double));
+			file.read(reinterpret_cast<char *>(&hit.detectionProbability), sizeof(G4double));
+		}
+		if (!file)
+			throw std::runtime_error("Decay library file " + p_fileName + " is truncated");
+		log_info("Decay library: {} chains of {} in {} with {} hits ({:.4g} chains/s)", group.getNumberOfChains(), group.isotope, group.volume, group.hits.size(), group.rate);
+	}
+}
+
+/**
+ * @brief Assembles the hits of a time window from the library.
+ *
+ * For each group, the Poisson number of chains in the window is drawn from its rate and as many chains are picked at
+ * random from the library. Each segment of a picked chain starts at an independent uniform time of the window.
+ * @param p_timeWindow Length of the window in s.
+ * @return Hits of the window, sorted by time.
+ */
+std::vector<AssembledHit> OMSimDecayLibrary::assembleWindow(G4double p_timeWindow) const
+{
+	std::vector<AssembledHit> hits;
+	for (const auto &group : m_groups)
+	{
+		const std::size_t numberOfChains = group.getNumberOfChains();
+		if (numberOfChains == 0)
+			continue;
+		const G4long decays = G4Poisson(group.rate * p_timeWindow);
+		for (G4long i = 0; i < decays; i++)
+		{
+			const std::size_t chain = std::min(static_cast<std::size_t>(G4UniformRand() * numberOfChains), numberOfChains - 1);
+			for (std::uint64_t segment = group.chainSegments[chain]; segment < group.chainSegments[chain + 1]; segment++)
+			{
+				const G4double segmentStart = G4UniformRand() * p_timeWindow * s;
+				for (std::uint64_t hit = group.segmentHits[segment]; hit < group.segmentHits[segment + 1]; hit++)
+				{
+					hits.push_back({segmentStart + group.hits[hit].time, &group.hits[hit]});
+				}
+			}
+		}
+	}
+	std::sort(hits.begin(), hits.end(), [](const AssembledHit &a, const AssembledHit &b)
+			  { return a.time < b.time; });
+	return hits;
+}
+
+/**
+ * @brief Appends the hits of an assembled window to <output_file>_hits.dat, as text or binary (see --binary_output).
+ * @param p_window Index of the window.
+ * @param p_hits Hits of the window.
+ */
+void OMSimDecayLibrary::writeHits(G4int p_window, const std::vector<AssembledHit> &p_hits)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	const bool binary = args.get<bool>("binary_output");
+	if (!m_hitWriter)
+	{
+		std::size_t bufferSize = static_cast<std::size_t>(args.get<G4double>("output_buffer_size") * 1024 * 1024);
+		m_hitWriter = std::make_unique<OMSimBufferedWriter>(args.get<std::string>("output_file") + "_hits.dat", bufferSize);
+		if (binary)
+			m_hitWriter->write(OMSimDecaysAnalysis::getBinaryHeader(g_assembledHitColumns));
+	}
+
+	for (const auto &assembled : p_hits)
+	{
+		const DecayLibraryHit &hit = *assembled.hit;
+		if (binary)
+		{
+			m_hitWriter->writeValue<std::int32_t>(p_window);
+			m_hitWriter->writeValue<double>(assembled.time / s);
+			m_hitWriter->writeValue<std::int32_t>(hit.PMT);
+			m_hitWriter->writeValue<double>(hit.energy);
+			m_hitWriter->writeValue<double>(hit.PE);
+			m_hitWriter->writeValue<double>(hit.transitTime);
+			m_hitWriter->writeValue<double>(hit.detectionProbability);
+		}
+		else
+		{
+			m_hitWriter->write(fmt::format("{}\t{:.13g}\t{}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t\n", p_window, assembled.time / s, hit.PMT,
+										   hit.energy, hit.PE, hit.transitTime, hit.detectionProbability));
+		}
+	}
+}
+
+/**
+ * @brief Writes the remaining assembled hits and closes the output file.
+ */
+void OMSimDecayLibrary::closeOutput()
+{
+	if (m_hitWriter)
+		m_hitWriter->close();
+}
@@ -5,12 +5,21 @@
 #include "OMSimEventAction.hh"
 #include "OMSimHitManager.hh"
 #include <numeric>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <queue>
+#include <sstream>
 #include "G4AutoLock.hh"
 #include "OMSimTools.hh"
 
 G4Mutex OMSimDecaysAnalysis::m_mutex = G4Mutex();
 OMSimDecaysAnalysis *OMSimDecaysAnalysis::m_instance = nullptr;
 G4ThreadLocal DecayStats *OMSimDecaysAnalysis::m_threadDecayStats = nullptr;
+G4ThreadLocal OMSimBufferedWriter *OMSimDecaysAnalysis::m_threadDecayWriter = nullptr;
+G4ThreadLocal OMSimBufferedWriter *OMSimDecaysAnalysis::m_threadHitWriter = nullptr;
+std::vector<std::unique_ptr<OMSimBufferedWriter>> OMSimDecaysAnalysis::m_writers;
 
 OMSimDecaysAnalysis &OMSimDecaysAnalysis::getInstance()
 {
@@ -32,8 +41,9 @@ OMSimDecaysAnalysis &OMSimDecaysAnalysis::getInstance()
  * @param p_particleName Name of the particle.
  * @param p_decayTime Time of the decay.
  * @param p_decayPosition Global position of the decay.
+ * @param p_isTimeRandomised Whether the decay was moved to a random time of the window.
  */
-void OMSimDecaysAnalysis::appendDecay(G4String p_particleName, G4double p_decayTime, G4ThreeVector p_decayPosition)
+void OMSimDecaysAnalysis::appendDecay(G4String p_particleName, G4double p_decayTime, G4ThreeVector p_decayPosition, bool p_isTimeRandomised)
 {
 	if (!m_threadDecayStats)
 	{
@@ -45,28 +55,258 @@ void OMSimDecaysAnalysis::appendDecay(G4String p_particleName, G4double p_decayT
 	m_threadDecayStats->isotopeName.push_back(p_particleName);
 	m_threadDecayStats->decayTime.push_back(p_decayTime);
 	m_threadDecayStats->decayPosition.push_back(p_decayPosition);
+	m_threadDecayStats->isTimeRandomised.push_back(p_isTimeRandomised);
 }
 
 /**
- * @brief Calls calculateMultiplicity and writes the results to the output file.
+ * @brief Name of the output file of a coincidence window.
+ * @param p_fileEnd Ending of the file name, e.g. "_multiplicity.dat".
+ * @param p_timeWindow Coincidence window.
+ * @param p_severalWindows If true, the window in ns is added to the file name, otherwise the name of a single-window run is kept.
  */
-void OMSimDecaysAnalysis::writeMultiplicity(G4double p_timeWindow)
+G4String OMSimDecaysAnalysis::getWindowFileName(const G4String &p_fileEnd, G4double p_timeWindow, bool p_severalWindows)
 {
 	G4String outputSufix = OMSimCommandArgsTable::getInstance().get<std::string>("output_file");
-	G4String fileName = outputSufix + "_multiplicity.dat";
+	if (!p_severalWindows)
+		return outputSufix + p_fileEnd;
+	return outputSufix + fmt::format("_{:g}ns", p_timeWindow / ns) + p_fileEnd;
+}
+
+/**
+ * @brief Calculates the multiplicity of the merged hits for several coincidence windows and writes one line per window to the output files.
+ * @param p_timeWindows Coincidence windows.
+ * @param p_pairCoincidences Whether to write the PMT-pair coincidences.
+ */
+void OMSimDecaysAnalysis::writeMultiplicity(const std::vector<G4double> &p_timeWindows, bool p_pairCoincidences)
+{
+	OMSimHitManager &hitManager = OMSimHitManager::getInstance();
+	hitManager.mergeThreadData();
+
+	// Only time and PMT are needed, so these are sorted instead of the full HitStats
+	const HitStats &hits = hitManager.m_moduleHits[0];
+	std::vector<std::pair<G4double, G4int>> timePMTHits(hits.hitTime.size());
+	for (std::size_t i = 0; i < timePMTHits.size(); ++i)
+	{
+		timePMTHits[i] = {hits.hitTime.at(i), hits.PMTnr.at(i)};
+	}
+	writeMultiplicity(timePMTHits, hitManager.getNumberOfPMTs(), p_timeWindows, p_pairCoincidences);
+}
+
+/**
+ * @brief Calculates the multiplicity of hits for several coincidence windows and writes one line per window to the output files.
+ *
+ * The hits are sorted by time once and all windows are evaluated in the same pass. As in
+ * OMSimHitManager::calculateMultiplicity, a coincidence starts with the first hit not yet assigned and includes all hits
+ * up to p_timeWindow later; its multiplicity is the number of different PMTs hit.
+ * With several windows, each window is written to its own file (window in ns in the file name).
+ * If p_pairCoincidences is true, the number of coincidences in which each pair of PMTs (i < j) was hit is written too,
+ * in the order (0,1), (0,2), ..., (1,2), ...
+ * @param p_hits Time and PMT of each hit, sorted in place.
+ * @param p_numberOfPMTs Number of PMTs of the module.
+ * @param p_timeWindows Coincidence windows.
+ * @param p_pairCoincidences Whether to write the PMT-pair coincidences.
+ */
+void OMSimDecaysAnalysis::writeMultiplicity(std::vector<std::pair<G4double, G4int>> &p_hits, G4int p_numberOfPMTs, const std::vector<G4double> &p_timeWindows, bool p_pairCoincidences)
+{
+	const std::size_t numberOfWindows = p_timeWindows.size();
+	const bool severalWindows = numberOfWindows > 1;
+	std::sort(p_hits.begin(), p_hits.end());
+	log_trace("Calculating multiplicity of {} hits in {} time windows", p_hits.size(), numberOfWindows);
+
+	struct Coincidence
+	{
+		G4double startTime;
+		std::vector<bool> isPMTHit;
+		std::vector<G4int> hitPMTs;
+	};
+	std::vector<Coincidence> openCoincidences(numberOfWindows, {0, std::vector<bool>(p_numberOfPMTs, false), {}});
+	std::vector<std::vector<int>> multiplicity(numberOfWindows, std::vector<int>(p_numberOfPMTs, 0));
+	std::vector<std::vector<int>> pairCoincidences(numberOfWindows, std::vector<int>(p_pairCoincidences ? p_numberOfPMTs * p_numberOfPMTs : 0, 0));
+
+	auto closeCoincidence = [&](std::size_t w)
+	{
+		Coincidence &coincidence = openCoincidences[w];
+		if (coincidence.hitPMTs.empty())
+			return;
+		multiplicity[w][coincidence.hitPMTs.size() - 1] += 1;
+		if (p_pairCoincidences)
+		{
+			std::sort(coincidence.hitPMTs.begin(), coincidence.hitPMTs.end());
+			for (std::size_t a = 0; a < coincidence.hitPMTs.size(); ++a)
+			{
+				for (std::size_t b = a + 1; b < coincidence.hitPMTs.size(); ++b)
+				{
+					pairCoincidences[w][coincidence.hitPMTs[a] * p_numberOfPMTs + coincidence.hitPMTs[b]] += 1;
+				}
+			}
+		}
+		for (const auto &pmt : coincidence.hitPMTs)
+		{
+			coincidence.isPMTHit[pmt] = false;
+		}
+		coincidence.hitPMTs.clear();
+	};
+
+	for (const auto &[hitTime, pmt] : p_hits)
+	{
+		for (std::size_t w = 0; w < numberOfWindows; ++w)
+		{
+			Coincidence &coincidence = openCoincidences[w];
+			if (!coincidence.hitPMTs.empty() && (hitTime - coincidence.startTime) > p_timeWindows[w])
+			{
+				closeCoincidence(w);
+			}
+			if (coincidence.hitPMTs.empty())
+			{
+				coincidence.startTime = hitTime;
+			}
+			if (!coincidence.isPMTHit[pmt])
+			{
+				coincidence.isPMTHit[pmt] = true;
+				coincidence.hitPMTs.push_back(pmt);
+			}
+		}
+	}
+
+	for (std::size_t w = 0; w < numberOfWindows; ++w)
+	{
+		closeCoincidence(w);
+
+		std::fstream dataFile;
+		dataFile.open(getWindowFileName("_multiplicity.dat", p_timeWindows[w], severalWindows).c_str(), std::ios::out | std::ios::app);
+		for (const auto &value : multiplicity[w])
+		{
+			dataFile << value << "\t";
+		}
+		dataFile << G4endl;
+		dataFile.close();
+
+		if (!p_pairCoincidences)
+			continue;
+
+		dataFile.open(getWindowFileName("_pair_coincidences.dat", p_timeWindows[w], severalWindows).c_str(), std::ios::out | std::ios::app);
+		for (G4int i = 0; i < p_numberOfPMTs; ++i)
+		{
+			for (G4int j = i + 1; j < p_numberOfPMTs; ++j)
+			{
+				dataFile << pairCoincidences[w][i * p_numberOfPMTs + j] << "\t";
+			}
+		}
+		dataFile << G4endl;
+		dataFile.close();
+	}
+}
+
+/**
+ * @brief Columns of the binary decay file, name (with unit) and numpy type code.
+ */
+static const std::vector<std::pair<G4String, G4String>> g_binaryDecayColumns = {
+	{"eventId", "<i8"}, {"decayTime[s]", "<f8"}, {"isotopeName", "S24"}, {"x[mm]", "<f8"}, {"y[mm]", "<f8"}, {"z[mm]", "<f8"}};
+
+/**
+ * @brief Columns of the binary hit file, name (with unit) and numpy type code.
+ */
+static const std::vector<std::pair<G4String, G4String>> g_binaryHitColumns = {
+	{"eventId", "<i8"}, {"hitTime[s]", "<f8"}, {"PMTnr", "<i4"}, {"energy[eV]", "<f8"}, {"x[mm]", "<f8"}, {"y[mm]", "<f8"}, {"z[mm]", "<f8"}, {"PE", "<f8"}, {"transitTime[ns]", "<f8"}, {"detectionProbability", "<f8"}};
 
-	OMSimHitManager::getInstance().mergeThreadData();
-	std::vector<int> multiplicity = OMSimHitManager::getInstance().calculateMultiplicity(p_timeWindow);
+static constexpr std::size_t g_binaryIsotopeNameLength = 24;
 
-	std::fstream dataFile;
-	dataFile.open(fileName.c_str(), std::ios::out | std::ios::app);
+/**
+ * @brief Columns of the binary hit stream of chunked livetimes (see StreamHit), name (with unit) and numpy type code.
+ */
+static const std::vector<std::pair<G4String, G4String>> g_streamHitColumns = {
+	{"window", "<i8"}, {"hitTime[s]", "<f8"}, {"PMTnr", "<i4"}, {"energy[eV]", "<f8"}, {"x[mm]", "<f8"}, {"y[mm]", "<f8"}, {"z[mm]", "<f8"}, {"PE", "<f8"}, {"transitTime[ns]", "<f8"}, {"detectionProbability", "<f8"}};
+
+static constexpr std::size_t g_streamRowBytes = 8 + 8 + 4 + 7 * 8;
 
-	for (const auto &value : multiplicity)
+/**
+ * @brief Writes a hit of the stream as a binary row (see g_streamHitColumns) or a line of text.
+ */
+static void writeStreamHit(OMSimBufferedWriter &p_writer, const StreamHit &p_hit, bool p_binary)
+{
+	if (p_binary)
+	{
+		p_writer.writeValue<std::int64_t>(p_hit.window);
+		p_writer.writeValue<double>(p_hit.time / s);
+		p_writer.writeValue<std::int32_t>(p_hit.PMT);
+		p_writer.writeValue<double>(p_hit.energy);
+		p_writer.writeValue<double>(p_hit.globalPosition.x());
+		p_writer.writeValue<double>(p_hit.globalPosition.y());
+		p_writer.writeValue<double>(p_hit.globalPosition.z());
+		p_writer.writeValue<double>(p_hit.PMTresponse.PE);
+		p_writer.writeValue<double>(p_hit.PMTresponse.transitTime);
+		p_writer.writeValue<double>(p_hit.PMTresponse.detectionProbability);
+	}
+	else
 	{
-		dataFile << value << "\t";
+		p_writer.write(fmt::format("{}\t{:.13g}\t{}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t\n",
+								   p_hit.window, p_hit.time / s, p_hit.PMT, p_hit.energy,
+								   p_hit.globalPosition.x(), p_hit.globalPosition.y(), p_hit.globalPosition.z(),
+								   p_hit.PMTresponse.PE, p_hit.PMTresponse.transitTime, p_hit.PMTresponse.detectionProbability));
 	}
-	dataFile << G4endl;
-	dataFile.close();
+}
+
+/**
+ * @brief Reads a hit of the stream from a binary row (see g_streamHitColumns).
+ */
+static StreamHit readStreamHit(const char *p_row)
+{
+	StreamHit hit;
+	std::int64_t window;
+	std::int32_t pmt;
+	double values[8];
+	std::memcpy(&window, p_row, 8);
+	std::memcpy(&values[0], p_row + 8, 8);
+	std::memcpy(&pmt, p_row + 16, 4);
+	std::memcpy(&values[1], p_row + 20, 7 * 8);
+	hit.window = window;
+	hit.time = values[0] * s;
+	hit.PMT = pmt;
+	hit.energy = values[1];
+	hit.globalPosition = G4ThreeVector(values[2], values[3], values[4]);
+	hit.PMTresponse = {values[5], values[6], values[7]};
+	return hit;
+}
+
+/**
+ * @brief Header of a merged binary file, describing the rows that follow it.
+ *
+ * The header is text, one line per entry starting with "#", and ends with the line "# end_header". The rows are packed
+ * (no padding) in the native byte order, given as "<" (little endian) or ">" in the type codes.
+ */
+G4String OMSimDecaysAnalysis::getBinaryHeader(const std::vector<std::pair<G4String, G4String>> &p_columns)
+{
+	const G4int one = 1;
+	const char byteOrder = *reinterpret_cast<const char *>(&one) == 1 ? '<' : '>';
+
+	std::size_t rowBytes = 0;
+	G4String columns;
+	for (const auto &[name, type] : p_columns)
+	{
+		G4String nativeType = type;
+		if (nativeType[0] == '<')
+			nativeType[0] = byteOrder;
+		rowBytes += std::stoul(type.substr(type[0] == 'S' ? 1 : 2));
+		columns += " " + name + ":" + nativeType;
+	}
+	return fmt::format("# OMSim binary table v1\n# row_bytes {}\n# columns{}\n# end_header\n", rowBytes, columns);
+}
+
+/**
+ * @brief Opens the output file of the calling thread and registers it, so that it can be closed before merging.
+ * @param p_fileEnd Ending of the file name, e.g. "_decays.dat".
+ */
+OMSimBufferedWriter *OMSimDecaysAnalysis::openThreadWriter(const G4String &p_fileEnd)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	G4String fileName = args.get<std::string>("output_file") + "_" + Tools::getThreadIDStr() + p_fileEnd;
+	std::size_t bufferSize = static_cast<std::size_t>(args.get<G4double>("output_buffer_size") * 1024 * 1024);
+
+	auto writer = std::make_unique<OMSimBufferedWriter>(fileName, bufferSize);
+	OMSimBufferedWriter *threadWriter = writer.get();
+	G4AutoLock lock(&m_mutex);
+	m_writers.push_back(std::move(writer));
+	return threadWriter;
 }
 
 /**
@@ -78,28 +318,31 @@ void OMSimDecaysAnalysis::writeThreadDecayInformation()
 		return;
 	log_trace("Writing decay information of {} decays", m_threadDecayStats->eventId.size());
 
-	G4String outputSufix = OMSimCommandArgsTable::getInstance().get<std::string>("output_file");
+	if (!m_threadDecayWriter)
+		m_threadDecayWriter = openThreadWriter("_decays.dat");
 
-	G4String lDecaysFileName = outputSufix + "_" + Tools::getThreadIDStr() + "_decays.dat";
-
-	std::fstream dataFile;
-	dataFile.open(lDecaysFileName.c_str(), std::ios::out | std::ios::app);
-	if (m_threadDecayStats->eventId.size() > 0)
+	const bool binary = OMSimCommandArgsTable::getInstance().get<bool>("binary_output");
+	for (std::size_t i = 0; i < m_threadDecayStats->eventId.size(); i++)
 	{
-		for (int i = 0; i < (int)m_threadDecayStats->eventId.size(); i++)
+		const G4ThreeVector &position = m_threadDecayStats->decayPosition.at(i);
+		if (binary)
 		{
-			dataFile << m_threadDecayStats->eventId.at(i) << "\t";
-			dataFile << std::setprecision(13);
-			dataFile << m_threadDecayStats->decayTime.at(i) << "\t";
-			dataFile << std::setprecision(4);
-			dataFile << m_threadDecayStats->isotopeName.at(i) << "\t";
-			dataFile << m_threadDecayStats->decayPosition.at(i).x() << "\t";
-			dataFile << m_threadDecayStats->decayPosition.at(i).y() << "\t";
-			dataFile << m_threadDecayStats->decayPosition.at(i).z() << "\t";
-			dataFile << G4endl;
+			char isotopeName[g_binaryIsotopeNameLength] = {};
+			m_threadDecayStats->isotopeName.at(i).copy(isotopeName, g_binaryIsotopeNameLength);
+			m_threadDecayWriter->writeValue<std::int64_t>(m_threadDecayStats->eventId.at(i));
+			m_threadDecayWriter->writeValue<double>(m_threadDecayStats->decayTime.at(i));
+			m_threadDecayWriter->write(isotopeName, g_binaryIsotopeNameLength);
+			m_threadDecayWriter->writeValue<double>(position.x());
+			m_threadDecayWriter->writeValue<double>(position.y());
+			m_threadDecayWriter->writeValue<double>(position.z());
+		}
+		else
+		{
+			m_threadDecayWriter->write(fmt::format("{}\t{:.13g}\t{}\t{:.4g}\t{:.4g}\t{:.4g}\t\n",
+												   m_threadDecayStats->eventId.at(i), m_threadDecayStats->decayTime.at(i),
+												   m_threadDecayStats->isotopeName.at(i), position.x(), position.y(), position.z()));
 		}
 	}
-	dataFile.close();
 	log_trace("Finished writing decay information");
 }
 
@@ -113,32 +356,37 @@ void OMSimDecaysAnalysis::writeThreadHitInformation()
 		return;
 
 	HitStats lHits = lHitManager.getSingleThreadHitsOfModule();
-	G4String outputSufix = OMSimCommandArgsTable::getInstance().get<std::string>("output_file");
-	G4String lHitsFileName = outputSufix + "_" + Tools::getThreadIDStr() + "_hits.dat";
 	log_trace("Writing hit information of {} hits", lHits.eventId.size());
 
-	std::fstream dataFile;
-	dataFile.open(lHitsFileName.c_str(), std::ios::out | std::ios::app);
-	if (lHits.eventId.size() > 0)
+	if (!m_threadHitWriter)
+		m_threadHitWriter = openThreadWriter("_hits.dat");
+
+	const bool binary = OMSimCommandArgsTable::getInstance().get<bool>("binary_output");
+	for (std::size_t i = 0; i < lHits.eventId.size(); i++)
 	{
-		for (int i = 0; i < (int)lHits.eventId.size(); i++)
+		const G4ThreeVector &position = lHits.globalPosition.at(i);
+		const OMSimPMTResponse::PMTPulse &response = lHits.PMTresponse.at(i);
+		if (binary)
 		{
-			dataFile << lHits.eventId.at(i) << "\t";
-			dataFile << std::setprecision(13);
-			dataFile << lHits.hitTime.at(i) / s << "\t";
-			dataFile << std::setprecision(4);
-			dataFile << lHits.PMTnr.at(i) << "\t";
-			dataFile << lHits.energy.at(i) << "\t";
-			dataFile << lHits.globalPosition.at(i).x() << "\t";
-			dataFile << lHits.globalPosition.at(i).y() << "\t";
-			dataFile << lHits.globalPosition.at(i).z() << "\t";
-			dataFile << lHits.PMTresponse.at(i).PE << "\t";
-			dataFile << lHits.PMTresponse.at(i).transitTime << "\t";
-			dataFile << lHits.PMTresponse.at(i).detectionProbability << "\t";
-			dataFile << G4endl;
+			m_threadHitWriter->writeValue<std::int64_t>(lHits.eventId.at(i));
+			m_threadHitWriter->writeValue<double>(lHits.hitTime.at(i) / s);
+			m_threadHitWriter->writeValue<std::int32_t>(lHits.PMTnr.at(i));
+			m_threadHitWriter->writeValue<double>(lHits.energy.at(i));
+			m_threadHitWriter->writeValue<double>(position.x());
+			m_threadHitWriter->writeValue<double>(position.y());
+			m_threadHitWriter->writeValue<double>(position.z());
+			m_threadHitWriter->writeValue<double>(response.PE);
+			m_threadHitWriter->writeValue<double>(response.transitTime);
+			m_threadHitWriter->writeValue<double>(response.detectionProbability);
+		}
+		else
+		{
+			m_threadHitWriter->write(fmt::format("{}\t{:.13g}\t{}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t{:.4g}\t\n",
+												 lHits.eventId.at(i), lHits.hitTime.at(i) / s, lHits.PMTnr.at(i), lHits.energy.at(i),
+												 position.x(), position.y(), position.z(),
+												 response.PE, response.transitTime, response.detectionProbability));
 		}
 	}
-	dataFile.close();
 	log_trace("Finished writing detailed hit information");
 }
 
@@ -153,19 +401,223 @@ void OMSimDecaysAnalysis::reset()
 	OMSimHitManager::getInstance().reset();
 }
 
-void OMSimDecaysAnalysis::mergeThreadFiles(G4String p_fileEnd)
+/**
+ * @brief Deletes the decay data of the calling thread, keeping its hits.
+ */
+void OMSimDecaysAnalysis::resetThreadDecays()
+{
+	delete m_threadDecayStats;
+	m_threadDecayStats = nullptr;
+}
+
+/**
+ * @brief Appends the merged hits of a time window to the hit stream of the chunk (<output_file>_chunk<chunk_index>_hits.dat).
+ *
+ * Hit times are given relative to the start of the window, with its global index. Hits after the end of the window
+ * (photons of decays near its end) are carried over to the window they fall into and written with it, so the stream is
+ * ordered by (window, time) and coincidences across window edges are kept. Windows must be written in order.
+ * @param p_window Global index of the window.
+ * @param p_timeWindow Length of the windows in s.
+ */
+void OMSimDecaysAnalysis::writeChunkWindow(G4long p_window, G4double p_timeWindow)
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	if (!m_chunkWriter)
+	{
+		G4int chunk = args.get<G4int>("chunk_index");
+		std::size_t bufferSize = static_cast<std::size_t>(args.get<G4double>("output_buffer_size") * 1024 * 1024);
+		m_chunkWriter = std::make_unique<OMSimBufferedWriter>(args.get<std::string>("output_file") + fmt::format("_chunk{}_hits.dat", chunk), bufferSize);
+		m_chunkWriter->write(fmt::format("# chunk_index {}\n# time_window[s] {:.17g}\n", chunk, p_timeWindow));
+		m_chunkWriter->write(getBinaryHeader(g_streamHitColumns));
+	}
+
+	OMSimHitManager &hitManager = OMSimHitManager::getInstance();
+	hitManager.mergeThreadData();
+	const HitStats &hits = hitManager.m_moduleHits[0];
+	const G4double windowLength = p_timeWindow * s;
+
+	std::vector<StreamHit> windowHits;
+	std::vector<StreamHit> laterHits;
+	for (const auto &hit : m_carriedHits)
+	{
+		(hit.window == p_window ? windowHits : laterHits).push_back(hit);
+	}
+	for (std::size_t i = 0; i < hits.hitTime.size(); i++)
+	{
+		StreamHit hit{p_window, hits.hitTime.at(i), hits.PMTnr.at(i), hits.energy.at(i), hits.globalPosition.at(i), hits.PMTresponse.at(i)};
+		while (hit.time >= windowLength)
+		{
+			hit.window++;
+			hit.time -= windowLength;
+		}
+		(hit.window == p_window ? windowHits : laterHits).push_back(hit);
+	}
+
+	std::sort(windowHits.begin(), windowHits.end(), [](const StreamHit &a, const StreamHit &b)
+			  { return a.time < b.time; });
+	for (const auto &hit : windowHits)
+	{
+		writeStreamHit(*m_chunkWriter, hit, true);
+	}
+	m_carriedHits = std::move(laterHits);
+	log_debug("Window {}: {} hits written to the chunk stream, {} carried over", p_window, windowHits.size(), m_carriedHits.size());
+}
+
+/**
+ * @brief Writes the hits carried over past the last window of the chunk and closes its stream.
+ *
+ * These hits fall into the first window(s) of the next chunk; mergeChunks sorts them in.
+ */
+void OMSimDecaysAnalysis::closeChunk()
+{
+	if (!m_chunkWriter)
+		return;
+	std::sort(m_carriedHits.begin(), m_carriedHits.end(), [](const StreamHit &a, const StreamHit &b)
+			  { return a.window < b.window || (a.window == b.window && a.time < b.time); });
+	for (const auto &hit : m_carriedHits)
+	{
+		writeStreamHit(*m_chunkWriter, hit, true);
+	}
+	m_carriedHits.clear();
+	m_chunkWriter->close();
+}
+
+/**
+ * @brief Merges the hit streams of chunks into one stream ordered by (window, time), written to <output_file>_hits.dat.
+ *
+ * The chunks may be given in any order; all must have the same time window. Missing chunk indices leave gaps in the
+ * stream and are reported. With --binary_output, the rows are copied unchanged after the header, otherwise written as text.
+ * @param p_fileNames Hit stream files of the chunks (<output_file>_chunk<chunk_index>_hits.dat).
+ */
+void OMSimDecaysAnalysis::mergeChunks(const std::vector<std::string> &p_fileNames)
+{
+	struct ChunkStream
+	{
+		std::string fileName;
+		std::unique_ptr<std::ifstream> file;
+		G4int index = -1;
+		G4double timeWindow = 0;
+		std::vector<char> row = std::vector<char>(g_streamRowBytes);
+		StreamHit hit;
+
+		bool next()
+		{
+			if (!file->read(row.data(), g_streamRowBytes))
+				return false;
+			hit = readStreamHit(row.data());
+			return true;
+		}
+	};
+
+	std::vector<ChunkStream> chunks(p_fileNames.size());
+	for (std::size_t i = 0; i < p_fileNames.size(); i++)
+	{
+		ChunkStream &chunk = chunks[i];
+		chunk.fileName = p_fileNames[i];
+		chunk.file = std::make_unique<std::ifstream>(chunk.fileName.c_str(), std::ios::in | std::ios::binary);
+		if (!chunk.file->is_open())
+			throw std::runtime_error("Failed to open chunk file " + chunk.fileName);
+
+		std::string line;
+		std::size_t rowBytes = 0;
+		while (std::getline(*chunk.file, line) && line != "# end_header")
+		{
+			std::istringstream entry(line);
+			std::string hash, key;
+			entry >> hash >> key;
+			if (key == "chunk_index")
+				entry >> chunk.index;
+			else if (key == "time_window[s]")
+				entry >> chunk.timeWindow;
+			else if (key == "row_bytes")
+				entry >> rowBytes;
+		}
+		if (line != "# end_header" || chunk.index < 0 || rowBytes != g_streamRowBytes)
+			throw std::runtime_error("Chunk file " + chunk.fileName + " has no valid header");
+	}
+	if (chunks.empty())
+		return;
+
+	std::sort(chunks.begin(), chunks.end(), [](const ChunkStream &a, const ChunkStream &b)
+			  { return a.index < b.index; });
+	const G4double timeWindow = chunks.front().timeWindow;
+	for (std::size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].timeWindow != timeWindow)
+			throw std::invalid_argument(fmt::format("Chunk {} has a time window of {} s, chunk {} of {} s", chunks[i].index, chunks[i].timeWindow, chunks.front().index, timeWindow));
+		if (i > 0 && chunks[i].index == chunks[i - 1].index)
+			throw std::invalid_argument(fmt::format("Chunk {} is given twice", chunks[i].index));
+		if (i > 0 && chunks[i].index != chunks[i - 1].index + 1)
+			log_warning("Chunks {} to {} are missing, the merged stream has a gap", chunks[i - 1].index + 1, chunks[i].index - 1);
+	}
+
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	const bool binary = args.get<bool>("binary_output");
+	std::size_t bufferSize = static_cast<std::size_t>(args.get<G4double>("output_buffer_size") * 1024 * 1024);
+	OMSimBufferedWriter output(args.get<std::string>("output_file") + "_hits.dat", bufferSize);
+	if (binary)
+	{
+		output.write(fmt::format("# time_window[s] {:.17g}\n", timeWindow));
+		output.write(getBinaryHeader(g_streamHitColumns));
+	}
+
+	// k-way merge; each chunk is ordered and only overlaps the next chunks with its carried-over hits
+	auto isLater = [&chunks](std::size_t a, std::size_t b)
+	{
+		const StreamHit &hitA = chunks[a].hit;
+		const StreamHit &hitB = chunks[b].hit;
+		return hitA.window > hitB.window || (hitA.window == hitB.window && hitA.time > hitB.time);
+	};
+	std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(isLater)> queue(isLater);
+	for (std::size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].next())
+			queue.push(i);
+	}
+
+	std::size_t numberOfHits = 0;
+	while (!queue.empty())
+	{
+		std::size_t i = queue.top();
+		queue.pop();
+		if (binary)
+			output.write(chunks[i].row.data(), g_streamRowBytes);
+		else
+			writeStreamHit(output, chunks[i].hit, false);
+		numberOfHits++;
+		if (chunks[i].next())
+			queue.push(i);
+	}
+	output.close();
+	log_info("Merged {} hits of {} chunks into {}", numberOfHits, chunks.size(), output.getFileName());
+}
+
+/**
+ * @brief Appends the thread files with the given ending to the merged file and deletes them.
+ *
+ * The thread files are concatenated byte by byte; for binary output the schema header is written once at the start of the
+ * merged file.
+ * @param p_fileEnd Ending of the file names, e.g. "_decays.dat".
+ * @param p_binaryHeader Header written if the merged file is new, empty for text output.
+ */
+void OMSimDecaysAnalysis::mergeThreadFiles(G4String p_fileEnd, const G4String &p_binaryHeader)
 {
 	G4String outputSufix = OMSimCommandArgsTable::getInstance().get<std::string>("output_file");
 
 	G4String mergedFileName = outputSufix + p_fileEnd;
+	const bool isNewFile = !std::filesystem::exists(mergedFileName.c_str()) || std::filesystem::file_size(mergedFileName.c_str()) == 0;
 
 	std::ofstream mergedFile;
-	mergedFile.open(mergedFileName.c_str(), std::ios::out | std::ios::app);
+	mergedFile.open(mergedFileName.c_str(), std::ios::out | std::ios::app | std::ios::binary);
 	if (!mergedFile.is_open())
 	{
 		log_error("Failed to open merged decay file: {}", mergedFileName);
 		return;
 	}
+	if (isNewFile)
+	{
+		mergedFile << p_binaryHeader;
+	}
 
 	int numThreads = OMSimCommandArgsTable::getInstance().get<int>("threads");
 
@@ -173,17 +625,16 @@ void OMSimDecaysAnalysis::mergeThreadFiles(G4String p_fileEnd)
 	{
 		G4String threadFileName = outputSufix + "_" + std::to_string(threadID) + p_fileEnd;
 
-		std::ifstream threadFile(threadFileName.c_str(), std::ios::in);
+		std::ifstream threadFile(threadFileName.c_str(), std::ios::in | std::ios::binary);
 		if (!threadFile.is_open())
 		{
 			log_warning("Failed to open thread file: {}", threadFileName);
 			continue;
 		}
 
-		G4String line;
-		while (std::getline(threadFile, line))
+		if (threadFile.peek() != std::ifstream::traits_type::eof())
 		{
-			mergedFile << line << G4endl;
+			mergedFile << threadFile.rdbuf();
 		}
 
 		threadFile.close();
@@ -203,8 +654,19 @@ void OMSimDecaysAnalysis::mergeThreadFiles(G4String p_fileEnd)
 	log_trace("Merged all thread files into: {}", mergedFileName);
 }
 
+/**
+ * @brief Closes the output files of all threads and merges them. Call after the last run.
+ */
 void OMSimDecaysAnalysis::mergeFiles()
 {
-	mergeThreadFiles(G4String("_hits.dat"));
-	mergeThreadFiles(G4String("_decays.dat"));
-}
\ No newline at end of file
+	{
+		G4AutoLock lock(&m_mutex);
+		for (auto &writer : m_writers)
+		{
+			writer->close();
+		}
+	}
+	const bool binary = OMSimCommandArgsTable::getInstance().get<bool>("binary_output");
+	mergeThreadFiles(G4String("_hits.dat"), binary ? getBinaryHeader(g_binaryHitColumns) : "");
+	mergeThreadFiles(G4String("_decays.dat"), binary ? getBinaryHeader(g_binaryDecayColumns) : "");
+}
@@ -3,24 +3,42 @@
 #include "OMSimUIinterface.hh"
 #include <G4SystemOfUnits.hh>
 #include <G4Poisson.hh>
+#include <Randomize.hh>
 #include <G4Navigator.hh>
+#include <G4Event.hh>
+#include <G4EventManager.hh>
+#include <G4IonTable.hh>
 #include "G4TransportationManager.hh"
 
-void OMSimDecaysGPS::setProductionRadius(G4double p_productionRadius)
+/**
+ * @brief Decay chain settings of the event of the calling thread.
+ * @return Information attached by OMSimPrimaryGeneratorAction, nullptr outside of an event.
+ */
+static const DecayChainInformation *getCurrentDecayChain()
 {
-    m_productionRadius = p_productionRadius;
+    const G4Event *event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+    return event ? dynamic_cast<const DecayChainInformation *>(event->GetUserInformation()) : nullptr;
 }
 
-G4String OMSimDecaysGPS::getDecayTerminationNuclide()
+/**
+ * @brief Nuclide at which the decay chain of the current event stops (see OMSimG4RadioactiveDecay).
+ * @return Termination nuclide of the event of the calling thread, "none" if the event has no decay chain information.
+ */
+const G4String &OMSimDecaysGPS::getDecayTerminationNuclide()
 {
-    return m_nuclideStopName;
+    static const G4String none = "none";
+    const DecayChainInformation *chain = getCurrentDecayChain();
+    return chain ? chain->getTerminationNuclide() : none;
 }
+
 /**
- * @brief Configures common GPS commands for the radioactive decays.
+ * @brief Applies the verbosity and process commands of the decay runs. Only done once, before the first run.
  */
-void OMSimDecaysGPS::generalGPS()
+void OMSimDecaysGPS::configureRun()
 {
-    log_trace("Configuring general GPS");
+    if (m_runConfigured)
+        return;
+    log_trace("Configuring decay runs");
     OMSimUIinterface &ui = OMSimUIinterface::getInstance();
     OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
 
@@ -30,15 +48,6 @@ void OMSimDecaysGPS::generalGPS()
     ui.applyCommand("/tracking/verbose 0");
     ui.applyCommand("/process/verbose 0");
     ui.applyCommand("/process/setVerbose 0");
-    ui.applyCommand("/run/initialize");
-    ui.applyCommand("/gps/particle ion");
-    G4ThreeVector position = m_opticalModule->m_placedPositions.at(0);
-    ui.applyCommand("/gps/pos/centre ", position.x() / m, " ", position.y() / m, " ", position.z() / m, " m");
-    ui.applyCommand("/gps/ene/mono 0 eV");
-    ui.applyCommand("/gps/pos/type Volume");
-    ui.applyCommand("/gps/pos/shape Sphere");
-    ui.applyCommand("/gps/pos/radius ", m_productionRadius, " mm");
-    ui.applyCommand("/gps/ang/type iso");
 
     if (args.get<bool>("scint_off"))
     {
@@ -51,28 +60,95 @@ void OMSimDecaysGPS::generalGPS()
         log_trace("Inactivating Cerenkov process");
         ui.applyCommand("/process/inactivate Cerenkov");
     }
+    m_runConfigured = true;
 }
 
 /**
- * @brief Configures GPS for the production and decay of an isotope within a specified location.
- *
- * If the daughter of the configured isotope is unstable, it will also decay in the same position as its mother
+ * @brief Searches a physical volume in the geometry tree below p_volume.
+ * @param p_volume Volume to search from.
+ * @param p_name Name of the physical volume.
+ * @param p_motherToGlobal Transformation from the frame of the mother of p_volume to the world.
+ * @param p_localToGlobal Set to the transformation from the frame of the found volume to the world.
+ * @return The physical volume, nullptr if not found.
+ */
+G4VPhysicalVolume *OMSimDecaysGPS::findPlacement(G4VPhysicalVolume *p_volume, const G4String &p_name, const G4Transform3D &p_motherToGlobal, G4Transform3D &p_localToGlobal)
+{
+    G4Transform3D localToGlobal = p_motherToGlobal * G4Transform3D(p_volume->GetObjectRotationValue(), p_volume->GetObjectTranslation());
+    if (p_volume->GetName() == p_name)
+    {
+        p_localToGlobal = localToGlobal;
+        return p_volume;
+    }
+    G4LogicalVolume *logical = p_volume->GetLogicalVolume();
+    for (std::size_t i = 0; i < logical->GetNoDaughters(); i++)
+    {
+        if (G4VPhysicalVolume *found = findPlacement(logical->GetDaughter(i), p_name, localToGlobal, p_localToGlobal))
+            return found;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Placed volume in which decays are sampled, voxelising its logical volume on first use (see OMSimVolumeSampler).
  *
- * @param p_isotope The isotope which is going to be produced.
- * @param p_volumeName The volume name where the isotope decays.
+ * Decays are confined to the material of the volume itself, not its daughters, as the GPS did with /gps/pos/confine.
+ * @param p_volumeName Name of the physical volume.
+ * @return Placement, valid until the end of the job.
  */
-void OMSimDecaysGPS::configureIsotopeGPS(G4String p_isotope, G4String p_volumeName)
+const OMSimVolumePlacement &OMSimDecaysGPS::getVolumePlacement(const G4String &p_volumeName)
 {
-    log_debug("Configuring GPS for isotope {} in volume {}", p_isotope, p_volumeName);
-    OMSimUIinterface &ui = OMSimUIinterface::getInstance();
+    auto found = m_placements.find(p_volumeName);
+    if (found != m_placements.end())
+        return found->second;
 
-    generalGPS();
+    G4VPhysicalVolume *world = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume();
+    G4Transform3D localToGlobal;
+    G4VPhysicalVolume *volume = findPlacement(world, p_volumeName, G4Transform3D(), localToGlobal);
+    if (!volume)
+        throw std::runtime_error("Volume " + p_volumeName + " for decays not found!");
+
+    G4LogicalVolume *logical = volume->GetLogicalVolume();
+    std::unique_ptr<OMSimVolumeSampler> &sampler = m_samplers[logical];
+    if (!sampler)
+        sampler = std::make_unique<OMSimVolumeSampler>(logical, OMSimCommandArgsTable::getInstance().get<G4int>("sampler_voxels"));
+    return m_placements.emplace(p_volumeName, OMSimVolumePlacement{p_volumeName, sampler.get(), localToGlobal}).first->second;
+}
 
-    if (m_isotopeCommands.find(p_isotope) != m_isotopeCommands.end())
+/**
+ * @brief Validates the samplers of all volumes used so far, logging the results.
+ *
+ * For each volume, p_samples points are sampled and located with the navigator, and all of them should lie in the volume.
+ * The volume of the material estimated by the sampler is compared with the Geant4 estimate (solid minus daughters).
+ * @param p_samples Points per volume.
+ */
+void OMSimDecaysGPS::checkVolumeSamplers(G4int p_samples)
+{
+    G4Navigator navigator;
+    navigator.SetWorldVolume(G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume());
+    for (const auto &[name, placement] : m_placements)
     {
-        ui.applyCommand(m_isotopeCommands[p_isotope]);
+        G4int located = 0;
+        for (G4int i = 0; i < p_samples; i++)
+        {
+            G4VPhysicalVolume *volume = navigator.LocateGlobalPointAndSetup(placement.sample(), nullptr, false, true);
+            if (volume && volume->GetName() == name)
+                located++;
+        }
+
+        G4LogicalVolume *logical = placement.sampler->getLogicalVolume();
+        G4double geant4Volume = logical->GetSolid()->GetCubicVolume();
+        for (std::size_t i = 0; i < logical->GetNoDaughters(); i++)
+            geant4Volume -= logical->GetDaughter(i)->GetLogicalVolume()->GetSolid()->GetCubicVolume();
+        G4double samplerVolume = placement.sampler->estimateVolume(p_samples);
+
+        if (located < p_samples)
+            log_warning("Sampler of {}: only {} of {} points located in the volume", name, located, p_samples);
+        else
+            log_info("Sampler of {}: all {} points located in the volume", name, p_samples);
+        log_info("Sampler of {}: volume {:.4g} cm3 (Geant4 estimate {:.4g} cm3), {} voxels ({} full), occupied volume {:.4g} cm3",
+                 name, samplerVolume / cm3, geant4Volume / cm3, placement.sampler->getNumberOfVoxels(), placement.sampler->getNumberOfFullVoxels(),
+                 placement.sampler->getOccupiedVolume() / cm3);
     }
-    ui.applyCommand("/gps/pos/confine " + p_volumeName);
 }
 
 /**
@@ -86,7 +162,7 @@ std::map<G4String, G4int> OMSimDecaysGPS::calculateNumberOfDecays(G4MaterialProp
 {
     std::map<G4String, G4int> numberDecays;
     log_trace("Calculating number of decays from material isotope activity...");
-    for (auto &pair : m_isotopeCommands)
+    for (auto &pair : m_isotopes)
     {
         G4String isotope = pair.first;
         G4double activity = p_MPT->GetConstProperty(isotope + "_ACTIVITY");
@@ -97,14 +173,30 @@ std::map<G4String, G4int> OMSimDecaysGPS::calculateNumberOfDecays(G4MaterialProp
 }
 
 /**
- * @brief Simulates the decays in the pressure vessel of the optical module.
- * @param p_timeWindow The livetime that should be simulated.
+ * @brief Adds one ScheduledDecay per decay of each isotope in a volume.
+ * @param p_numberDecays Number of decays per isotope.
+ * @param p_volumeName Name of the physical volume in which the isotopes decay.
  */
-void OMSimDecaysGPS::simulateDecaysInPressureVessel(G4double p_timeWindow)
+void OMSimDecaysGPS::scheduleDecays(const std::map<G4String, G4int> &p_numberDecays, const G4String &p_volumeName)
 {
-    log_trace("Simulating radioactive decays in pressure vessel in a time window of {} seconds", p_timeWindow);
+    for (auto &pair : p_numberDecays)
+    {
+        const auto &[atomicNumber, massNumber] = m_isotopes.at(pair.first);
+        G4ParticleDefinition *ion = G4IonTable::GetIonTable()->GetIon(atomicNumber, massNumber, 0.);
+        log_trace("Scheduling {} decays of {} in {}", pair.second, pair.first, p_volumeName);
+        const OMSimVolumePlacement &volume = getVolumePlacement(p_volumeName);
+        for (G4int i = 0; i < pair.second; i++)
+            m_schedule.push_back({ion, volume.sample(), m_terminationIsotopes.at(pair.first), &volume});
+    }
+}
 
-    OMSimUIinterface &ui = OMSimUIinterface::getInstance();
+/**
+ * @brief Schedules the decays in the pressure vessel of the optical module.
+ * @param p_timeWindow The livetime that should be simulated.
+ */
+void OMSimDecaysGPS::scheduleDecaysInPressureVessel(G4double p_timeWindow)
+{
+    log_trace("Scheduling radioactive decays in pressure vessel in a time window of {} seconds", p_timeWindow);
 
     G4double mass = m_opticalModule->getPressureVesselWeight();
     G4String pressureVesselName = "PressureVessel_" + std::to_string(m_opticalModule->m_index);
@@ -112,92 +204,99 @@ void OMSimDecaysGPS::simulateDecaysInPressureVessel(G4double p_timeWindow)
     G4LogicalVolume *pressureVesselLogicalVolume = m_opticalModule->getComponent(pressureVesselName).VLogical;
     G4MaterialPropertiesTable *MPT = pressureVesselLogicalVolume->GetMaterial()->GetMaterialPropertiesTable();
 
-    std::map<G4String, G4int> numberDecays = calculateNumberOfDecays(MPT, p_timeWindow, mass);
-
-    for (auto &pair : numberDecays)
-    {
-        G4String isotope = pair.first;
-        G4int decayCount = pair.second;
-        m_nuclideStopName = m_terminationIsotopes[pair.first];
-        configureIsotopeGPS(isotope, pressureVesselName);
-
-        log_trace("Simulating {} decays of {} in pressure vessel", decayCount, isotope);
-        ui.runBeamOn(decayCount);
-    }
+    scheduleDecays(calculateNumberOfDecays(MPT, p_timeWindow, mass), pressureVesselName);
 }
 
 /**
- * @brief Simulates the decays in the PMTs of the optical module.
+ * @brief Schedules the decays in the PMTs of the optical module.
  * @param p_timeWindow The livetime that should be simulated.
  */
-void OMSimDecaysGPS::simulateDecaysInPMTs(G4double p_timeWindow)
+void OMSimDecaysGPS::scheduleDecaysInPMTs(G4double p_timeWindow)
 {
-    log_trace("Simulating radioactive decays in glass of PMTs in a time window of {} seconds", p_timeWindow);
-    OMSimUIinterface &ui = OMSimUIinterface::getInstance();
+    log_trace("Scheduling radioactive decays in glass of PMTs in a time window of {} seconds", p_timeWindow);
     G4double mass = m_opticalModule->getPMTmanager()->getPMTGlassWeight();
     G4LogicalVolume *pressureVesselLogicalVolume = m_opticalModule->getPMTmanager()->getLogicalVolume();
     G4MaterialPropertiesTable *MPT = pressureVesselLogicalVolume->GetMaterial()->GetMaterialPropertiesTable();
 
     for (int pmt = 0; pmt < (int)m_opticalModule->getNumberOfPMTs(); pmt++)
     {
-        std::map<G4String, G4int> numberDecays = calculateNumberOfDecays(MPT, p_timeWindow, mass);
-
-        for (auto &pair : numberDecays)
-        {
-            G4String isotope = pair.first;
-            G4int decayCount = pair.second;
-            m_nuclideStopName = m_terminationIsotopes[pair.first];
-
-            configureIsotopeGPS(isotope, "PMT_" + std::to_string(pmt));
-
-            log_trace("Simulating {} decays of {} in PMT {}", decayCount, isotope, pmt);
-            ui.runBeamOn(decayCount);
-        }
+        scheduleDecays(calculateNumberOfDecays(MPT, p_timeWindow, mass), "PMT_" + std::to_string(pmt));
     }
 }
 
-G4ThreeVector OMSimDecaysGPS::sampleNextDecayPosition(G4ThreeVector p_currentPosition)
+/**
+ * @brief Decay rate of an isotope in a kind of volume, from the activity of its material and its mass.
+ * @param p_isotope Name of the isotope.
+ * @param p_inPMTs If true, the rate in the glass of all PMTs, otherwise in the pressure vessel.
+ * @return Decays per second.
+ */
+G4double OMSimDecaysGPS::getDecayRate(const G4String &p_isotope, bool p_inPMTs)
 {
-    G4Navigator *navigator = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking();
-    G4VPhysicalVolume *currentVolume = navigator->LocateGlobalPointAndSetup(p_currentPosition, nullptr, true);
-    G4ThreeVector centreOfVolume = currentVolume->GetTranslation();
-
-    if (!currentVolume)
+    if (!p_inPMTs)
     {
-        G4Exception("sampleNextDecayPosition", "NoVolume", FatalException,
-                    "Mother isotope position is not inside any volume.");
+        G4String pressureVesselName = "PressureVessel_" + std::to_string(m_opticalModule->m_index);
+        G4MaterialPropertiesTable *MPT = m_opticalModule->getComponent(pressureVesselName).VLogical->GetMaterial()->GetMaterialPropertiesTable();
+        return MPT->GetConstProperty(p_isotope + "_ACTIVITY") * m_opticalModule->getPressureVesselWeight();
     }
-    int counter = 0;
-    while (true)
+    G4MaterialPropertiesTable *MPT = m_opticalModule->getPMTmanager()->getLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
+    return MPT->GetConstProperty(p_isotope + "_ACTIVITY") * m_opticalModule->getPMTmanager()->getPMTGlassWeight() * m_opticalModule->getNumberOfPMTs();
+}
+
+/**
+ * @brief Schedules a fixed number of decays of an isotope, for the decay library (see OMSimDecayLibrary) and the rate table (see OMSimRateEstimator).
+ * @param p_isotope Name of the isotope.
+ * @param p_decays Number of decays. In the PMTs, each decay is placed in a random PMT.
+ * @param p_inPMTs If true, the decays are in the glass of the PMTs, otherwise in the pressure vessel.
+ * @return Decay rate (per second) of the isotope in all volumes of the kind.
+ */
+G4double OMSimDecaysGPS::scheduleLibraryDecays(const G4String &p_isotope, G4int p_decays, bool p_inPMTs)
+{
+    if (!p_inPMTs)
     {
-        G4double u = G4UniformRand(); // Random value in [0, 1)
-        G4double v = G4UniformRand();
-        G4double w = G4UniformRand();
-
-        // Generate spherical coordinates
-        G4double r = m_productionRadius * std::cbrt(u) * mm; // Scales radius for uniform distribution
-        G4double theta = std::acos(1 - 2 * v);               // Polar angle
-        G4double phi = 2 * CLHEP::pi * w;                    // Azimuthal angle
-
-        // Convert to Cartesian coordinates
-        G4double x = r * std::sin(theta) * std::cos(phi);
-        G4double y = r * std::sin(theta) * std::sin(phi);
-        G4double z = r * std::cos(theta);
-        G4ThreeVector randomPoint = G4ThreeVector(x, y, z) + centreOfVolume;
-        // Check if the random point is inside the same volume
-        G4VPhysicalVolume *locatedVolume = navigator->LocateGlobalPointAndSetup(randomPoint, nullptr, true);
-
-        if (currentVolume == locatedVolume)
-        {
-            if (counter > 100000)
-            {
-                log_error("Could not find next decay position. Exciting...");
-                G4Exception("sampleNextDecayPosition", "NoVolume", FatalException,
-                            "Could not find next decay position!");
-            }
-
-            return randomPoint;
-        }
-        counter++;
+        scheduleDecays({{p_isotope, p_decays}}, "PressureVessel_" + std::to_string(m_opticalModule->m_index));
+        return getDecayRate(p_isotope, false);
     }
+
+    G4int numberOfPMTs = (G4int)m_opticalModule->getNumberOfPMTs();
+    std::vector<G4int> decaysPerPMT(numberOfPMTs, 0);
+    for (G4int i = 0; i < p_decays; i++)
+        decaysPerPMT[std::min(G4int(G4UniformRand() * numberOfPMTs), numberOfPMTs - 1)]++;
+    for (int pmt = 0; pmt < numberOfPMTs; pmt++)
+        scheduleDecays({{p_isotope, decaysPerPMT[pmt]}}, "PMT_" + std::to_string(pmt));
+    return getDecayRate(p_isotope, true);
+}
+
+/**
+ * @brief Names of the simulated isotopes.
+ */
+std::vector<G4String> OMSimDecaysGPS::getIsotopes() const
+{
+    std::vector<G4String> isotopes;
+    for (const auto &pair : m_isotopes)
+        isotopes.push_back(pair.first);
+    return isotopes;
+}
+
+/**
+ * @brief Simulates all scheduled decays in a single run (one event per decay) and clears the schedule.
+ */
+void OMSimDecaysGPS::runScheduledDecays()
+{
+    configureRun();
+    log_debug("Simulating {} scheduled decays in a single run", m_schedule.size());
+    if (!m_schedule.empty())
+        OMSimUIinterface::getInstance().runBeamOn(static_cast<G4int>(m_schedule.size()));
+    m_schedule.clear();
+}
+
+/**
+ * @brief Samples the position of a daughter decay that was moved to a random time in the window, uniformly in the volume of the event's decay.
+ * @return Global position.
+ */
+G4ThreeVector OMSimDecaysGPS::sampleNextDecayPosition()
+{
+    const DecayChainInformation *chain = getCurrentDecayChain();
+    if (!chain)
+        throw std::runtime_error("Event has no decay chain information to place the daughter decay!");
+    return chain->getVolume()->sample();
 }
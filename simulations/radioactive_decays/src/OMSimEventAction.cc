@@ -1,5 +1,7 @@
 #include "OMSimEventAction.hh"
 #include "OMSimDecaysAnalysis.hh"
+#include "OMSimDecayLibrary.hh"
+#include "OMSimRateEstimator.hh"
 #include "OMSimCommandArgsTable.hh"
 #include "OMSimHitManager.hh"
 
@@ -13,12 +15,28 @@ void OMSimEventAction::BeginOfEventAction(const G4Event *evt)
  * @brief Custom actions at the end of the event.
  * 
  * Depending on the arguments set, this function will write hit and decay 
- * information with the analysis manager and reset hit and analysis data for the next event.
+ * information with the analysis manager (or store the event in the decay library or rate table) and reset hit and analysis data for the next event.
  * @param p_event Pointer to the current event.
  */
 void OMSimEventAction::EndOfEventAction(const G4Event *p_event)
 {
-	if (!OMSimCommandArgsTable::getInstance().get<bool>("multiplicity_study"))
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	if (args.keyExists("build_library"))
+	{
+		OMSimDecayLibrary::getInstance().appendEvent();
+		OMSimDecaysAnalysis::getInstance().reset();
+	}
+	else if (args.keyExists("build_rate_table"))
+	{
+		OMSimRateEstimator::getInstance().appendEvent();
+		OMSimDecaysAnalysis::getInstance().reset();
+	}
+	else if (args.get<bool>("multiplicity_study") || args.keyExists("chunk_index"))
+	{
+		// Hits are kept for the whole time window, decays are not written
+		OMSimDecaysAnalysis::getInstance().resetThreadDecays();
+	}
+	else
 	{
 		log_debug("End of event, saving information and reseting (thread {})", G4Threading::G4GetThreadId());
 		OMSimDecaysAnalysis &analysisManager = OMSimDecaysAnalysis::getInstance();
@@ -830,7 +830,7 @@ G4RadioactiveDecay::DecayIt(const G4Track& theTrack, const G4Step&)
     ////OMSIM//////////////////////////////////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////////////////////////////////////
     // Check if the current nucleus is the target stop nucleus
-  if (theParticleDef->GetParticleName() == OMSimDecaysGPS::getInstance().getDecayTerminationNuclide()) {
+  if (theParticleDef->GetParticleName() == OMSimDecaysGPS::getDecayTerminationNuclide()) {
 
 #ifdef G4VERBOSE
     if (GetVerboseLevel() >= 1) {
@@ -329,6 +329,59 @@ void OMSimG4Scintillation::BuildPhysicsTable(const G4ParticleDefinition &)
     fIntegralTable2->insertAt(i, vector2);
     fIntegralTable3->insertAt(i, vector3);
   }
+  BuildMaterialScintillation();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+void OMSimG4Scintillation::BuildMaterialScintillation()
+// Precomputes, per material, the yields, the normalised lifetime components
+// and the normalised scintillation integral (inverse CDF of the photon
+// energy) with a guide table, so that the integral is searched in O(1)
+{
+  constexpr std::size_t guideSize = 256;
+  const G4MaterialTable *materialTable = G4Material::GetMaterialTable();
+  fMaterialScintillation.assign(G4Material::GetNumberOfMaterials(), MaterialScintillation());
+  std::size_t maxComponents = 0;
+
+  for (std::size_t i = 0; i < fMaterialScintillation.size(); ++i)
+  {
+    MaterialScintillation &scint = fMaterialScintillation[i];
+    G4MaterialPropertiesTable *MPT = ((*materialTable)[i])->GetMaterialPropertiesTable();
+    if (!MPT || !MPT->GetProperty(kSCINTILLATIONCOMPONENT1))
+      continue;
+    G4MaterialPropertyVector *components = MPT->GetProperty("FRACTIONLIFETIMES");
+    auto integral = (G4PhysicsFreeVector *)((*fIntegralTable1)(i));
+    if (!components || !integral || integral->GetVectorLength() == 0)
+      continue;
+
+    scint.resolutionScale = MPT->GetConstProperty("RESOLUTIONSCALE");
+    scint.yield = MPT->GetConstProperty("SCINTILLATIONYIELD");
+    scint.yieldElectrons = MPT->GetConstProperty("SCINTILLATIONYIELDELECTRONS");
+
+    G4double fractionNormalization = 0.;
+    for (std::size_t c = 0; c < components->GetVectorLength(); ++c)
+    {
+      // the "energy" of FRACTIONLIFETIMES is the fraction, its value the lifetime
+      G4double fraction = components->Energy(c);
+      fractionNormalization += fraction;
+      scint.fractions.push_back(fraction);
+      scint.lifetimes.push_back(components->Value(fraction));
+    }
+    for (auto &fraction : scint.fractions)
+      fraction /= fractionNormalization;
+    maxComponents = std::max(maxComponents, scint.fractions.size());
+
+    G4double CIImax = integral->GetMaxValue();
+    for (std::size_t j = 0; j < integral->GetVectorLength(); ++j)
+    {
+      scint.spectrum.energies.push_back(integral->Energy(j));
+      scint.spectrum.integral.push_back(CIImax > 0. ? (*integral)[j] / CIImax : 0.);
+    }
+    ScintillationKernels::buildGuide(scint.spectrum, guideSize);
+    scint.isScintillator = true;
+  }
+  fComponentPhotons.reserve(maxComponents);
+  fFractionalParts.reserve(maxComponents);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -354,26 +407,19 @@ G4VParticleChange *OMSimG4Scintillation::PostStepDoIt(const G4Track &aTrack,
   const G4DynamicParticle *aParticle = aTrack.GetDynamicParticle();
   const G4Material *aMaterial = aTrack.GetMaterial();
 
-  G4MaterialPropertiesTable *MPT = aMaterial->GetMaterialPropertiesTable();
-  if (!MPT)
+  std::size_t materialIndex = aMaterial->GetIndex();
+  if (materialIndex >= fMaterialScintillation.size() || !fMaterialScintillation[materialIndex].isScintillator)
     return G4VRestDiscreteProcess::PostStepDoIt(aTrack, aStep);
+  const MaterialScintillation &scint = fMaterialScintillation[materialIndex];
 
-  G4MaterialPropertyVector *lScintSpectrum = MPT->GetProperty(kSCINTILLATIONCOMPONENT1);
-  G4MaterialPropertyVector *lScintComponents = MPT->GetProperty("FRACTIONLIFETIMES");
-
-  if (!lScintSpectrum || !lScintComponents)
-    return G4VRestDiscreteProcess::PostStepDoIt(aTrack, aStep);
-
-  G4int nscnt = lScintComponents->GetVectorLength();
-  G4double ResolutionScale = MPT->GetConstProperty("RESOLUTIONSCALE");
-  G4double ScintillationYield = MPT->GetConstProperty("SCINTILLATIONYIELD");
-
+  G4int nscnt = (G4int)scint.fractions.size();
   G4double TotalEnergyDeposit = aStep.GetTotalEnergyDeposit();
   G4ParticleDefinition *pDef = aParticle->GetDefinition();
 
+  G4double ScintillationYield = scint.yield;
   if (pDef == G4Electron::ElectronDefinition() || pDef == G4Positron::PositronDefinition() || pDef == G4Gamma::GammaDefinition())
   {
-    ScintillationYield = MPT->GetConstProperty("SCINTILLATIONYIELDELECTRONS");
+    ScintillationYield = scint.yieldElectrons;
   }
 
   G4double MeanNumberOfPhotons = ScintillationYield * TotalEnergyDeposit;
@@ -381,7 +427,7 @@ G4VParticleChange *OMSimG4Scintillation::PostStepDoIt(const G4Track &aTrack,
   G4int NumPhotons;
   if (MeanNumberOfPhotons > 10.)
   {
-    NumPhotons = G4int(G4RandGauss::shoot(MeanNumberOfPhotons, ResolutionScale * std::sqrt(MeanNumberOfPhotons)) + 0.5);
+    NumPhotons = G4int(G4RandGauss::shoot(MeanNumberOfPhotons, scint.resolutionScale * std::sqrt(MeanNumberOfPhotons)) + 0.5);
   }
   else
   {
@@ -395,6 +441,7 @@ G4VParticleChange *OMSimG4Scintillation::PostStepDoIt(const G4Track &aTrack,
     return G4VRestDiscreteProcess::PostStepDoIt(aTrack, aStep);
   }
 
+  fNumPhotons = NumPhotons;
   aParticleChange.SetNumberOfSecondaries(NumPhotons);
 
   if (fTrackSecondariesFirst && aTrack.GetTrackStatus() == fAlive)
@@ -402,27 +449,14 @@ G4VParticleChange *OMSimG4Scintillation::PostStepDoIt(const G4Track &aTrack,
     aParticleChange.ProposeTrackStatus(fSuspend);
   }
 
-  G4int materialIndex = (G4int)aMaterial->GetIndex();
-
-  std::vector<G4double> lFractions(nscnt);
-  std::vector<G4double> lTimes(nscnt);
-
-  G4double lFractionNormalization = 0;
-  for (G4int scnt = 0; scnt < nscnt; scnt++)
-  {
-    G4double lCurrentFraction = lScintComponents->Energy(scnt); // don't get confused about the energy here, it is a fraction... I wanted to use the G4 vectors, and this is the nomenclature
-    lFractionNormalization += lCurrentFraction;
-    lTimes[scnt] = lScintComponents->Value(lCurrentFraction);
-    lFractions[scnt] = lCurrentFraction;
-  }
-
-  std::vector<G4int> Nums(nscnt, 0);
+  // Split the photons between the lifetime components
+  std::vector<G4int> &Nums = fComponentPhotons;
+  Nums.assign(nscnt, 0);
   G4int lTotalNr = 0;
 
   for (G4int scnt = 0; scnt < nscnt; scnt++)
   {
-    lFractions[scnt] /= lFractionNormalization;
-    Nums[scnt] = G4int(lFractions[scnt] * NumPhotons);
+    Nums[scnt] = G4int(scint.fractions[scnt] * NumPhotons);
     lTotalNr += Nums[scnt];
   }
 
@@ -431,11 +465,12 @@ G4VParticleChange *OMSimG4Scintillation::PostStepDoIt(const G4Track &aTrack,
   if (difference != 0)
   {
     // Prepare a list of the fractional parts
-    std::vector<std::pair<G4double, G4int>> photonFractions(nscnt);
+    std::vector<std::pair<G4double, G4int>> &photonFractions = fFractionalParts;
+    photonFractions.resize(nscnt);
     G4double totalFractionalSum = 0.0;
     for (G4int scnt = 0; scnt < nscnt; scnt++)
     {
-      G4double fractionalPart = lFractions[scnt] * NumPhotons - Nums[scnt];
+      G4double fractionalPart = scint.fractions[scnt] * NumPhotons - Nums[scnt];
       photonFractions[scnt] = std::make_pair(fractionalPart, scnt);
       totalFractionalSum += fractionalPart;
     }
@@ -463,10 +498,6 @@ G4VParticleChange *OMSimG4Scintillation::PostStepDoIt(const G4Track &aTrack,
     }
   }
 
-  G4PhysicsFreeVector* ScintillationIntegral = (G4PhysicsFreeVector*)((*fIntegralTable1)(materialIndex));
-  if (!ScintillationIntegral) return G4VRestDiscreteProcess::PostStepDoIt(aTrack, aStep);
-
-  G4double CIImax = ScintillationIntegral->GetMaxValue();
   G4StepPoint *pPreStepPoint = aStep.GetPreStepPoint();
   G4StepPoint *pPostStepPoint = aStep.GetPostStepPoint();
 
@@ -494,14 +525,14 @@ G4VParticleChange *OMSimG4Scintillation::PostStepDoIt(const G4Track &aTrack,
     G4int Num = Nums[scnt];
     if (Num == 0) continue;
 
-    G4double ScintillationTime = lTimes[scnt];
+    G4double ScintillationTime = scint.lifetimes[scnt];
     G4double ScintillationRiseTime = 0. * ns;
 
     for (G4int i = 0; i < Num; i++)
     {
 
       // Determine photon energy
-      G4double sampledEnergy = ScintillationIntegral->GetEnergy(G4UniformRand() * CIImax);
+      G4double sampledEnergy = ScintillationKernels::sampleEnergy(scint.spectrum, G4UniformRand());
       // Generate random photon direction
 
       G4double cost = 1. - 2. * G4UniformRand();
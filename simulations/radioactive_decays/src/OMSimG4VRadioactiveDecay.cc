@@ -1036,9 +1036,15 @@ void G4VRadioactiveDecay::DecayAnalog(const G4Track& theTrack,
 
         ////OMSIM//////////////////////////////////////////////////////////////////////////////////////////////
         //////////////////////////////////////////////////////////////////////////////////////////////////
-        G4double timeWindow = OMSimCommandArgsTable::getInstance().get<G4double>("time_window") * s;
-        
-        if (finalGlobalTime > timeWindow)
+        OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+        G4double timeWindow = args.get<G4double>("time_window") * s;
+
+        // In a chunked livetime, daughters decaying shortly after the window (e.g. Po214, Po212) keep their time,
+        // their hits are carried over to the following windows. Primaries and long-lived daughters are re-randomised.
+        G4bool keepDecayTime = args.keyExists("chunk_index") && theTrack.GetParentID() > 0 &&
+                               finalGlobalTime <= timeWindow + args.get<G4double>("decay_time_horizon") * s;
+
+        if (finalGlobalTime > timeWindow && !keepDecayTime)
         {
             randomisePosition = true;
             temptime = G4UniformRand() * timeWindow;
@@ -1056,7 +1062,7 @@ void G4VRadioactiveDecay::DecayAnalog(const G4Track& theTrack,
     //////////////////////////////////////////////////////////////////////////////////////////////////
     OMSimDecaysAnalysis::getInstance().appendDecay(
         theParticleDef->GetParticleName(),
-        finalGlobalTime / s, theTrack.GetPosition());
+        finalGlobalTime / s, theTrack.GetPosition(), randomisePosition);
     //////////////////////////////////////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -1088,7 +1094,7 @@ void G4VRadioactiveDecay::DecayAnalog(const G4Track& theTrack,
 
         if (randomisePosition && nextProduct->GetParticleDefinition()-> GetParticleType() == "nucleus")
         {
-          secondaryPosition = OMSimDecaysGPS::getInstance().sampleNextDecayPosition(theTrack.GetPosition());
+          secondaryPosition = OMSimDecaysGPS::sampleNextDecayPosition();
         }
         G4Track *secondary = new G4Track(nextProduct, finalGlobalTime, secondaryPosition);
 
@@ -1,27 +1,26 @@
 #include "OMSimPrimaryGeneratorAction.hh"
+#include "OMSimDecaysGPS.hh"
 
-#include <G4GeneralParticleSource.hh>
-#include <G4ParticleTypes.hh>
-
-
-
-OMSimPrimaryGeneratorAction::OMSimPrimaryGeneratorAction()
-{
-	m_particleSource = new G4GeneralParticleSource ();
-	m_particleSource->SetParticleDefinition(G4GenericIon::GenericIonDefinition());
-}
-
-OMSimPrimaryGeneratorAction::~OMSimPrimaryGeneratorAction()
-{
-	delete m_particleSource;
-}
+#include <G4Event.hh>
+#include <G4PrimaryParticle.hh>
+#include <G4PrimaryVertex.hh>
+#include <Randomize.hh>
 
 void OMSimPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
-	m_particleSource->GeneratePrimaryVertex(anEvent);
-}
-
-
+	const ScheduledDecay &decay = OMSimDecaysGPS::getInstance().getScheduledDecay(anEvent->GetEventID());
 
+	G4double cosTheta = 1 - 2 * G4UniformRand();
+	G4double sinTheta = std::sqrt(1 - cosTheta * cosTheta);
+	G4double phi = CLHEP::twopi * G4UniformRand();
 
+	G4PrimaryParticle *ion = new G4PrimaryParticle(decay.ion);
+	ion->SetKineticEnergy(0.);
+	ion->SetMomentumDirection(G4ThreeVector(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta));
+	ion->SetCharge(0.); // as /gps/ion Z A 0
 
+	G4PrimaryVertex *vertex = new G4PrimaryVertex(decay.position, 0.);
+	vertex->SetPrimary(ion);
+	anEvent->AddPrimaryVertex(vertex);
+	anEvent->SetUserInformation(new DecayChainInformation(decay.terminationNuclide, decay.volume));
+}
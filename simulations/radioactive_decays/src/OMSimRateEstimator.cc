@@ -0,0 +1,297 @@
+#include "OMSimRateEstimator.hh"
+#include "OMSimCommandArgsTable.hh"
+#include "OMSimDecaysGPS.hh"
+#include "OMSimHitManager.hh"
+#include "OMSimLogger.hh"
+
+#include <G4SystemOfUnits.hh>
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+G4Mutex OMSimRateEstimator::m_mutex = G4Mutex();
+std::vector<std::unique_ptr<DecayYield>> OMSimRateEstimator::m_threadYields;
+G4ThreadLocal DecayYield *OMSimRateEstimator::m_threadYield = nullptr;
+
+/**
+ * @brief Adds the tallies of another yield of the same number of PMTs.
+ */
+void DecayYield::add(const DecayYield &p_other)
+{
+	decays += p_other.decays;
+	coincidences += p_other.coincidences;
+	for (std::size_t i = 0; i < hits.size(); i++)
+	{
+		hits[i] += p_other.hits.at(i);
+		clusters[i] += p_other.clusters.at(i);
+		coincidentClusters[i] += p_other.coincidentClusters.at(i);
+	}
+}
+
+/**
+ * @brief Sets all tallies to zero, keeping the number of PMTs.
+ */
+void DecayYield::clear()
+{
+	decays = 0;
+	coincidences = 0;
+	std::fill(hits.begin(), hits.end(), 0);
+	std::fill(clusters.begin(), clusters.end(), 0);
+	std::fill(coincidentClusters.begin(), coincidentClusters.end(), 0);
+}
+
+OMSimRateEstimator &OMSimRateEstimator::getInstance()
+{
+	static OMSimRateEstimator instance;
+	return instance;
+}
+
+/**
+ * @brief Sets the module and the coincidence window of the calibration. Call on the master before the first calibration run.
+ * @param p_numberOfPMTs Number of PMTs of the module.
+ * @param p_coincidenceWindow Coincidence window.
+ */
+void OMSimRateEstimator::configure(G4int p_numberOfPMTs, G4double p_coincidenceWindow)
+{
+	m_numberOfPMTs = p_numberOfPMTs;
+	m_coincidenceWindow = p_coincidenceWindow;
+	m_yields.clear();
+}
+
+/**
+ * @brief Tallies the hits and coincidences of the current event (one decay chain) of the calling thread. Call at the end of the event, before the data is reset.
+ */
+void OMSimRateEstimator::appendEvent()
+{
+	if (!m_threadYield)
+	{
+		G4AutoLock lock(&m_mutex);
+		auto yield = std::make_unique<DecayYield>();
+		yield->hits.assign(m_numberOfPMTs, 0);
+		yield->clusters.assign(m_numberOfPMTs, 0);
+		yield->coincidentClusters.assign(m_numberOfPMTs, 0);
+		m_threadYields.push_back(std::move(yield));
+		m_threadYield = m_threadYields.back().get();
+	}
+	DecayYield &yield = *m_threadYield;
+	yield.decays++;
+
+	OMSimHitManager &hitManager = OMSimHitManager::getInstance();
+	if (!hitManager.areThereHitsInModuleSingleThread())
+		return;
+
+	HitStats hits = hitManager.getSingleThreadHitsOfModule();
+	std::vector<std::pair<G4double, G4int>> timePMTHits;
+	timePMTHits.reserve(hits.hitTime.size());
+	for (std::size_t i = 0; i < hits.hitTime.size(); i++)
+	{
+		timePMTHits.push_back({hits.hitTime.at(i), hits.PMTnr.at(i)});
+		yield.hits.at(hits.PMTnr.at(i)) += 1;
+	}
+	std::sort(timePMTHits.begin(), timePMTHits.end());
+
+	// Coincidences as in OMSimDecaysAnalysis::writeMultiplicity
+	G4double startTime = 0;
+	std::vector<bool> isPMTHit(m_numberOfPMTs, false);
+	std::vector<G4int> hitPMTs;
+	auto closeCoincidence = [&]()
+	{
+		if (hitPMTs.size() > 1)
+			yield.coincidences++;
+		for (const auto &pmt : hitPMTs)
+		{
+			yield.clusters[pmt]++;
+			if (hitPMTs.size() > 1)
+				yield.coincidentClusters[pmt]++;
+			isPMTHit[pmt] = false;
+		}
+		hitPMTs.clear();
+	};
+
+	for (const auto &[hitTime, pmt] : timePMTHits)
+	{
+		if (!hitPMTs.empty() && (hitTime - startTime) > m_coincidenceWindow)
+			closeCoincidence();
+		if (hitPMTs.empty())
+			startTime = hitTime;
+		if (!isPMTHit[pmt])
+		{
+			isPMTHit[pmt] = true;
+			hitPMTs.push_back(pmt);
+		}
+	}
+	closeCoincidence();
+}
+
+/**
+ * @brief Collects the tallies of all threads in the last run into the yield of a group. Call on the master after the run.
+ * @param p_isotope Isotope of the run.
+ * @param p_volume Kind of volume of the run.
+ */
+void OMSimRateEstimator::closeGroup(const G4String &p_isotope, const G4String &p_volume)
+{
+	DecayYield yield;
+	yield.isotope = p_isotope;
+	yield.volume = p_volume;
+	yield.hits.assign(m_numberOfPMTs, 0);
+	yield.clusters.assign(m_numberOfPMTs, 0);
+	yield.coincidentClusters.assign(m_numberOfPMTs, 0);
+	{
+		G4AutoLock lock(&m_mutex);
+		for (auto &threadYield : m_threadYields)
+		{
+			yield.add(*threadYield);
+			threadYield->clear();
+		}
+	}
+	const G4long hits = std::accumulate(yield.hits.begin(), yield.hits.end(), G4long(0));
+	log_info("Rate table: {} decays of {} in {} with {:.4g} hits and {:.4g} coincidences per decay", yield.decays, p_isotope, p_volume,
+			 yield.decays ? G4double(hits) / yield.decays : 0., yield.decays ? G4double(yield.coincidences) / yield.decays : 0.);
+	m_yields.push_back(std::move(yield));
+}
+
+/**
+ * @brief Writes the yields to a text table.
+ *
+ * A header (lines starting with "#") with the number of PMTs and the coincidence window is followed by one line per
+ * group: isotope, volume, decays, coincidences, then the hits, clusters and coincident clusters of each PMT.
+ * @param p_fileName Name of the table file.
+ */
+void OMSimRateEstimator::write(const G4String &p_fileName) const
+{
+	std::ofstream file(p_fileName.c_str(), std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open rate table file " + p_fileName);
+
+	file << "# OMSim decay rate table v1\n";
+	file << "# number_of_PMTs " << m_numberOfPMTs << "\n";
+	file << "# coincidence_window[ns] " << fmt::format("{:.17g}", m_coincidenceWindow / ns) << "\n";
+	file << "# isotope volume decays coincidences hits[PMT] clusters[PMT] coincidentClusters[PMT]\n";
+	for (const auto &yield : m_yields)
+	{
+		file << yield.isotope << "\t" << yield.volume << "\t" << yield.decays << "\t" << yield.coincidences;
+		for (const auto *values : {&yield.hits, &yield.clusters, &yield.coincidentClusters})
+		{
+			for (const auto &value : *values)
+				file << "\t" << value;
+		}
+		file << "\n";
+	}
+	log_info("Rate table with {} groups written to {}", m_yields.size(), p_fileName);
+}
+
+/**
+ * @brief Reads a table written by write, replacing the yields in memory.
+ * @param p_fileName Name of the table file.
+ */
+void OMSimRateEstimator::read(const G4String &p_fileName)
+{
+	std::ifstream file(p_fileName.c_str());
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open rate table file " + p_fileName);
+
+	m_yields.clear();
+	m_numberOfPMTs = 0;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream entry(line);
+		if (line.rfind("#", 0) == 0)
+		{
+			std::string hash, key;
+			entry >> hash >> key;
+			if (key == "number_of_PMTs")
+			{
+				entry >> m_numberOfPMTs;
+			}
+			else if (key == "coincidence_window[ns]")
+			{
+				entry >> m_coincidenceWindow;
+				m_coincidenceWindow *= ns;
+			}
+			continue;
+		}
+		if (line.empty())
+			continue;
+
+		DecayYield yield;
+		entry >> yield.isotope >> yield.volume >> yield.decays >> yield.coincidences;
+		for (auto *values : {&yield.hits, &yield.clusters, &yield.coincidentClusters})
+		{
+			values->resize(m_numberOfPMTs);
+			for (auto &value : *values)
+				entry >> value;
+		}
+		if (!entry)
+			throw std::runtime_error("Rate table file " + p_fileName + " has an invalid line: " + line);
+		m_yields.push_back(std::move(yield));
+	}
+	log_info("Read rate table {} with {} groups ({} PMTs, coincidence window {} ns)", p_fileName, m_yields.size(), m_numberOfPMTs, m_coincidenceWindow / ns);
+}
+
+/**
+ * @brief Estimates the rates of the module from the yields and the current decay rates, and writes them to a text file.
+ *
+ * The file has one "# group" line per group (isotope, volume, decay rate, hit rate and coincidence rate of its chains)
+ * and one line per PMT with its hit rate, cluster rate, and coincidence rates from single chains (correlated) and
+ * between independent chains (accidental). The last line has the totals of the module. All rates are in 1/s.
+ * Groups of volumes skipped with no_PV_decays or no_PMT_decays are left out.
+ * @param p_fileName Name of the output file.
+ */
+void OMSimRateEstimator::writeEstimate(const G4String &p_fileName) const
+{
+	OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
+	OMSimDecaysGPS &decaysGPS = OMSimDecaysGPS::getInstance();
+
+	std::ofstream file(p_fileName.c_str(), std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open rate estimate file " + p_fileName);
+	file << "# Estimated decay background rates in 1/s\n";
+	file << "# coincidence_window[ns] " << m_coincidenceWindow / ns << "\n";
+	file << "# group isotope volume decayRate hitRate coincidenceRate\n";
+
+	std::vector<G4double> hitRate(m_numberOfPMTs, 0), clusterRate(m_numberOfPMTs, 0), correlatedRate(m_numberOfPMTs, 0);
+	G4double totalCorrelatedRate = 0;
+	for (const auto &yield : m_yields)
+	{
+		const bool inPMTs = yield.volume == "PMTs";
+		if ((inPMTs && args.get<bool>("no_PMT_decays")) || (!inPMTs && args.get<bool>("no_PV_decays")))
+			continue;
+		if (yield.decays == 0)
+		{
+			log_warning("Rate table has no decays of {} in {}, group skipped", yield.isotope, yield.volume);
+			continue;
+		}
+		const G4double decayRate = decaysGPS.getDecayRate(yield.isotope, inPMTs);
+		const G4double ratePerCount = decayRate / yield.decays;
+		G4double groupHitRate = 0;
+		for (G4int pmt = 0; pmt < m_numberOfPMTs; pmt++)
+		{
+			hitRate[pmt] += yield.hits[pmt] * ratePerCount;
+			clusterRate[pmt] += yield.clusters[pmt] * ratePerCount;
+			correlatedRate[pmt] += yield.coincidentClusters[pmt] * ratePerCount;
+			groupHitRate += yield.hits[pmt] * ratePerCount;
+		}
+		totalCorrelatedRate += yield.coincidences * ratePerCount;
+		file << fmt::format("# group {} {} {:.6g} {:.6g} {:.6g}\n", yield.isotope, yield.volume, decayRate, groupHitRate, yield.coincidences * ratePerCount);
+	}
+
+	const G4double window = m_coincidenceWindow / s;
+	const G4double totalClusterRate = std::accumulate(clusterRate.begin(), clusterRate.end(), 0.);
+	G4double totalAccidentalRate = 0;
+	file << "# PMT hitRate clusterRate correlatedCoincidenceRate accidentalCoincidenceRate\n";
+	for (G4int pmt = 0; pmt < m_numberOfPMTs; pmt++)
+	{
+		const G4double accidentalRate = 2 * window * clusterRate[pmt] * (totalClusterRate - clusterRate[pmt]);
+		totalAccidentalRate += accidentalRate / 2; // every pair is counted for both PMTs
+		file << fmt::format("{}\t{:.6g}\t{:.6g}\t{:.6g}\t{:.6g}\n", pmt, hitRate[pmt], clusterRate[pmt], correlatedRate[pmt], accidentalRate);
+	}
+	const G4double totalHitRate = std::accumulate(hitRate.begin(), hitRate.end(), 0.);
+	file << fmt::format("total\t{:.6g}\t{:.6g}\t{:.6g}\t{:.6g}\n", totalHitRate, totalClusterRate, totalCorrelatedRate, totalAccidentalRate);
+
+	log_info("Estimated rates: {:.4g} hits/s ({:.4g} per PMT), {:.4g} coincidences/s from single chains and {:.4g} accidental coincidences/s in {} ns",
+			 totalHitRate, m_numberOfPMTs ? totalHitRate / m_numberOfPMTs : 0., totalCorrelatedRate, totalAccidentalRate, m_coincidenceWindow / ns);
+	log_info("Rate estimate written to {}", p_fileName);
+}
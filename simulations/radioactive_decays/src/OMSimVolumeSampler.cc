@@ -0,0 +1,136 @@
+#include "OMSimVolumeSampler.hh"
+#include "OMSimLogger.hh"
+
+#include <G4VPhysicalVolume.hh>
+#include <Randomize.hh>
+
+#include <cmath>
+
+/**
+ * @brief Voxelises a logical volume. Call before the run (on the master); classifying the voxels costs a few solid calls per voxel.
+ * @param p_logicalVolume Volume whose material (solid minus daughters) is sampled.
+ * @param p_targetVoxels Approximate number of voxels of the bounding box.
+ */
+OMSimVolumeSampler::OMSimVolumeSampler(G4LogicalVolume *p_logicalVolume, G4int p_targetVoxels)
+    : m_logicalVolume(p_logicalVolume), m_solid(p_logicalVolume->GetSolid())
+{
+    for (std::size_t i = 0; i < p_logicalVolume->GetNoDaughters(); i++)
+    {
+        G4VPhysicalVolume *daughter = p_logicalVolume->GetDaughter(i);
+        G4Transform3D daughterToMother(daughter->GetObjectRotationValue(), daughter->GetObjectTranslation());
+        m_daughters.push_back({daughter->GetLogicalVolume()->GetSolid(), daughterToMother.inverse()});
+    }
+
+    G4ThreeVector minimum;
+    G4ThreeVector maximum;
+    m_solid->BoundingLimits(minimum, maximum);
+    G4ThreeVector extent = maximum - minimum;
+    G4double side = std::cbrt(extent.x() * extent.y() * extent.z() / std::max(p_targetVoxels, 1));
+    G4int numberX = std::max(1, static_cast<G4int>(std::ceil(extent.x() / side)));
+    G4int numberY = std::max(1, static_cast<G4int>(std::ceil(extent.y() / side)));
+    G4int numberZ = std::max(1, static_cast<G4int>(std::ceil(extent.z() / side)));
+    m_voxelSize = G4ThreeVector(extent.x() / numberX, extent.y() / numberY, extent.z() / numberZ);
+    G4double halfDiagonal = 0.5 * m_voxelSize.mag();
+
+    for (G4int i = 0; i < numberX; i++)
+        for (G4int j = 0; j < numberY; j++)
+            for (G4int k = 0; k < numberZ; k++)
+            {
+                G4ThreeVector corner = minimum + G4ThreeVector(i * m_voxelSize.x(), j * m_voxelSize.y(), k * m_voxelSize.z());
+                G4ThreeVector centre = corner + 0.5 * m_voxelSize;
+
+                // The safety distances are lower bounds of the distance to the surface, so skipping is always safe
+                EInside inside = m_solid->Inside(centre);
+                if (inside == kOutside && m_solid->DistanceToIn(centre) > halfDiagonal)
+                    continue;
+                bool full = inside == kInside && m_solid->DistanceToOut(centre) > halfDiagonal;
+
+                bool insideDaughter = false;
+                for (const auto &daughter : m_daughters)
+                {
+                    G4ThreeVector daughterCentre = daughter.motherToDaughter * G4Point3D(centre);
+                    EInside insideThis = daughter.solid->Inside(daughterCentre);
+                    if (insideThis == kInside && daughter.solid->DistanceToOut(daughterCentre) > halfDiagonal)
+                    {
+                        insideDaughter = true;
+                        break;
+                    }
+                    if (insideThis != kOutside || daughter.solid->DistanceToIn(daughterCentre) <= halfDiagonal)
+                        full = false;
+                }
+                if (insideDaughter)
+                    continue;
+
+                m_voxels.push_back({corner, !full});
+                if (full)
+                    m_numberOfFullVoxels++;
+            }
+
+    if (m_voxels.empty())
+        throw std::runtime_error("Volume " + p_logicalVolume->GetName() + " has no material to sample decay vertices in!");
+    log_debug("Voxelised {} into {} x {} x {} voxels, {} with material ({} full)", p_logicalVolume->GetName(), numberX, numberY, numberZ,
+              m_voxels.size(), m_numberOfFullVoxels);
+}
+
+/**
+ * @param p_localPoint Point in the frame of the logical volume.
+ * @return True if the point is in the solid and not inside one of the daughters.
+ */
+bool OMSimVolumeSampler::contains(const G4ThreeVector &p_localPoint) const
+{
+    if (m_solid->Inside(p_localPoint) == kOutside)
+        return false;
+    for (const auto &daughter : m_daughters)
+    {
+        if (daughter.solid->Inside(daughter.motherToDaughter * G4Point3D(p_localPoint)) == kInside)
+            return false;
+    }
+    return true;
+}
+
+G4ThreeVector OMSimVolumeSampler::randomPointInVoxel(const Voxel &p_voxel) const
+{
+    return p_voxel.corner + G4ThreeVector(G4UniformRand() * m_voxelSize.x(), G4UniformRand() * m_voxelSize.y(), G4UniformRand() * m_voxelSize.z());
+}
+
+/**
+ * @return Point uniformly distributed in the material, in the frame of the logical volume.
+ */
+G4ThreeVector OMSimVolumeSampler::sample() const
+{
+    std::size_t numberOfVoxels = m_voxels.size();
+    for (G4int tries = 0; tries < 1000000; tries++)
+    {
+        const Voxel &voxel = m_voxels[std::min(static_cast<std::size_t>(G4UniformRand() * numberOfVoxels), numberOfVoxels - 1)];
+        G4ThreeVector point = randomPointInVoxel(voxel);
+        if (!voxel.boundary || contains(point))
+            return point;
+    }
+    throw std::runtime_error("Could not sample a point in volume " + m_logicalVolume->GetName() + "!");
+}
+
+/**
+ * @brief Estimates the volume of the material from the acceptance of points drawn in the occupied voxels.
+ * @param p_samples Number of points to draw.
+ * @return Estimated volume (Geant4 units).
+ */
+G4double OMSimVolumeSampler::estimateVolume(G4int p_samples) const
+{
+    std::size_t numberOfVoxels = m_voxels.size();
+    G4int accepted = 0;
+    for (G4int i = 0; i < p_samples; i++)
+    {
+        const Voxel &voxel = m_voxels[std::min(static_cast<std::size_t>(G4UniformRand() * numberOfVoxels), numberOfVoxels - 1)];
+        if (!voxel.boundary || contains(randomPointInVoxel(voxel)))
+            accepted++;
+    }
+    return getOccupiedVolume() * accepted / std::max(p_samples, 1);
+}
+
+/**
+ * @return Point uniformly distributed in the material of the placed volume, in global coordinates.
+ */
+G4ThreeVector OMSimVolumePlacement::sample() const
+{
+    return localToGlobal * G4Point3D(sampler->sample());
+}
@@ -0,0 +1,181 @@
+/**
+ * @file volume_sampler_test.cc
+ * @brief Validates OMSimVolumeSampler on solids with known volumes.
+ *
+ * For a G4Box, a thin G4Sphere shell (1 mm thick, like the PMT glass) and a G4Tubs with a placed G4Box daughter, it checks that
+ * - OMSimVolumeSampler::contains gives the expected answer for points inside, outside and in the daughter,
+ * - every sampled point is in the material (tested analytically, not with the sampler),
+ * - OMSimVolumeSampler::estimateVolume agrees with the analytic volume,
+ * - the number of samples in each of several sub-regions agrees with the analytic volume fraction of the sub-region.
+ * The return code is non-zero if any check fails.
+ *
+ * Usage: volume_sampler_test [number of samples]
+ * @ingroup radioactive
+ */
+
+#include "OMSimLogger.hh"
+#include "OMSimVolumeSampler.hh"
+
+#include <G4Box.hh>
+#include <G4Material.hh>
+#include <G4PVPlacement.hh>
+#include <G4Sphere.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4Tubs.hh>
+#include <Randomize.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+std::shared_ptr<spdlog::logger> g_logger;
+
+namespace
+{
+  int g_failures = 0;
+
+  void check(bool pCondition, const std::string &pMessage)
+  {
+    if (!pCondition)
+    {
+      std::printf("FAILED: %s\n", pMessage.c_str());
+      g_failures++;
+    }
+  }
+
+  /**
+   * @brief A solid under test with its analytic description.
+   */
+  struct TestCase
+  {
+    std::string name;
+    G4LogicalVolume *volume;
+    G4double analyticVolume;
+    std::function<bool(const G4ThreeVector &)> isInMaterial;        ///< Analytic containment.
+    std::function<std::size_t(const G4ThreeVector &)> subRegion;    ///< Index of the sub-region of a point in the material.
+    std::vector<G4double> regionFractions;                          ///< Analytic volume fraction of each sub-region.
+    std::vector<std::pair<G4ThreeVector, bool>> containmentPoints;  ///< Points with the expected result of contains.
+  };
+
+  std::size_t octant(const G4ThreeVector &pPoint)
+  {
+    return (pPoint.x() > 0) + 2 * (pPoint.y() > 0) + 4 * (pPoint.z() > 0);
+  }
+
+  void runTestCase(const TestCase &pCase, G4int pSamples)
+  {
+    OMSimVolumeSampler sampler(pCase.volume, 200000);
+
+    for (const auto &point : pCase.containmentPoints)
+      check(sampler.contains(point.first) == point.second,
+            pCase.name + ": contains(" + std::to_string(point.first.x()) + ", " + std::to_string(point.first.y()) + ", " +
+                std::to_string(point.first.z()) + ") should be " + (point.second ? "true" : "false"));
+
+    std::vector<G4int> counts(pCase.regionFractions.size(), 0);
+    G4int outside = 0;
+    for (G4int i = 0; i < pSamples; i++)
+    {
+      G4ThreeVector point = sampler.sample();
+      if (!pCase.isInMaterial(point))
+      {
+        outside++;
+        continue;
+      }
+      counts.at(pCase.subRegion(point))++;
+    }
+    check(outside == 0, pCase.name + ": " + std::to_string(outside) + " sampled points outside the material");
+
+    // Binomial counts, 5 standard deviations
+    G4double maxPull = 0;
+    for (std::size_t region = 0; region < counts.size(); region++)
+    {
+      G4double expected = pSamples * pCase.regionFractions[region];
+      G4double sigma = std::sqrt(expected * (1 - pCase.regionFractions[region]));
+      G4double pull = (counts[region] - expected) / sigma;
+      maxPull = std::max(maxPull, std::abs(pull));
+      check(std::abs(pull) < 5, pCase.name + ": sub-region " + std::to_string(region) + " has " + std::to_string(counts[region]) +
+                                    " samples, expected " + std::to_string(expected));
+    }
+
+    // The estimate is the occupied voxel volume times a binomial acceptance, 5 standard deviations
+    G4double estimate = sampler.estimateVolume(pSamples);
+    G4double deviation = estimate / pCase.analyticVolume - 1;
+    G4double acceptance = pCase.analyticVolume / sampler.getOccupiedVolume();
+    G4double tolerance = 5 * std::sqrt((1 - acceptance) / (acceptance * pSamples)) + 1e-9;
+    check(std::abs(deviation) < tolerance, pCase.name + ": estimated volume " + std::to_string(estimate / mm3) + " mm3, analytic " +
+                                          std::to_string(pCase.analyticVolume / mm3) + " mm3");
+
+    std::printf("%-12s %8zu voxels (%zu full), volume deviation %+.2e, max. sub-region pull %.2f\n", pCase.name.c_str(),
+                sampler.getNumberOfVoxels(), sampler.getNumberOfFullVoxels(), deviation, maxPull);
+  }
+}
+
+int main(int pArgumentCount, char *pArgumentVector[])
+{
+  const G4int samples = pArgumentCount > 1 ? std::stoi(pArgumentVector[1]) : 200000;
+  G4Random::setTheSeed(12345);
+  G4Material *material = new G4Material("SamplerTestMaterial", 1., 1.008 * g / mole, 1. * g / cm3);
+
+  // Box 20 x 40 x 60 mm, equal volume in each octant
+  const G4double dx = 10 * mm, dy = 20 * mm, dz = 30 * mm;
+  TestCase box{"box",
+               new G4LogicalVolume(new G4Box("Box", dx, dy, dz), material, "Box"),
+               8 * dx * dy * dz,
+               [=](const G4ThreeVector &p)
+               { return std::abs(p.x()) <= dx && std::abs(p.y()) <= dy && std::abs(p.z()) <= dz; },
+               octant,
+               std::vector<G4double>(8, 1. / 8),
+               {{G4ThreeVector(0, 0, 0), true}, {G4ThreeVector(9, 19, -29), true}, {G4ThreeVector(11, 0, 0), false}, {G4ThreeVector(0, 0, 31), false}}};
+
+  // Spherical shell 99 to 100 mm, octants split at the middle radius
+  const G4double rMin = 99 * mm, rMax = 100 * mm, rMid = 99.5 * mm;
+  const G4double innerFraction = (std::pow(rMid, 3) - std::pow(rMin, 3)) / (std::pow(rMax, 3) - std::pow(rMin, 3));
+  std::vector<G4double> shellFractions;
+  for (std::size_t region = 0; region < 16; region++)
+    shellFractions.push_back((region < 8 ? innerFraction : 1 - innerFraction) / 8);
+  TestCase shell{"sphere shell",
+                 new G4LogicalVolume(new G4Sphere("Shell", rMin, rMax, 0, 360 * deg, 0, 180 * deg), material, "Shell"),
+                 4. / 3. * CLHEP::pi * (std::pow(rMax, 3) - std::pow(rMin, 3)),
+                 [=](const G4ThreeVector &p)
+                 { return p.mag() >= rMin && p.mag() <= rMax; },
+                 [=](const G4ThreeVector &p)
+                 { return octant(p) + (p.mag() > rMid ? 8 : 0); },
+                 shellFractions,
+                 {{G4ThreeVector(0, 0, 99.5), true}, {G4ThreeVector(70.4, 70.4, 0), true}, {G4ThreeVector(0, 0, 0), false}, {G4ThreeVector(98, 0, 0), false}, {G4ThreeVector(0, 101, 0), false}}};
+
+  // Cylinder of radius 50 mm and length 100 mm with a 20 mm cube rotated by 30 deg around z at (20, 0, 10) mm,
+  // which lies completely in the quadrant x > 0, z > 0
+  const G4double tubsRadius = 50 * mm, tubsHalfLength = 50 * mm, cubeHalf = 10 * mm;
+  G4LogicalVolume *tubs = new G4LogicalVolume(new G4Tubs("Tubs", 0, tubsRadius, tubsHalfLength, 0, 360 * deg), material, "Tubs");
+  G4LogicalVolume *cube = new G4LogicalVolume(new G4Box("Cube", cubeHalf, cubeHalf, cubeHalf), material, "Cube");
+  G4RotationMatrix cubeRotation;
+  cubeRotation.rotateZ(30 * deg);
+  const G4ThreeVector cubePosition(20 * mm, 0, 10 * mm);
+  new G4PVPlacement(G4Transform3D(cubeRotation, cubePosition), cube, "Cube_physical", tubs, false, 0);
+  const G4RotationMatrix cubeInverse = cubeRotation.inverse();
+  const G4double quadrantVolume = CLHEP::pi * tubsRadius * tubsRadius * tubsHalfLength / 2;
+  const G4double cubeVolume = 8 * cubeHalf * cubeHalf * cubeHalf;
+  const G4double tubsVolume = 4 * quadrantVolume - cubeVolume;
+  TestCase tubsWithDaughter{"tubs+cube",
+                            tubs,
+                            tubsVolume,
+                            [=](const G4ThreeVector &p)
+                            {
+                              G4ThreeVector inCube = cubeInverse * (p - cubePosition);
+                              bool inDaughter = std::abs(inCube.x()) < cubeHalf && std::abs(inCube.y()) < cubeHalf && std::abs(inCube.z()) < cubeHalf;
+                              return p.perp() <= tubsRadius && std::abs(p.z()) <= tubsHalfLength && !inDaughter;
+                            },
+                            [](const G4ThreeVector &p)
+                            { return std::size_t((p.x() > 0) + 2 * (p.z() > 0)); },
+                            {quadrantVolume / tubsVolume, quadrantVolume / tubsVolume, quadrantVolume / tubsVolume, (quadrantVolume - cubeVolume) / tubsVolume},
+                            {{G4ThreeVector(-20, 0, 0), true}, {G4ThreeVector(20, 0, 10), false}, {G4ThreeVector(20, 12, 10), true}, {G4ThreeVector(0, 0, 51), false}, {G4ThreeVector(36, 36, 0), false}}};
+
+  for (const TestCase &testCase : {box, shell, tubsWithDaughter})
+    runTestCase(testCase, samples);
+
+  std::printf("%s\n", g_failures ? "volume sampler test failed" : "volume sampler test passed");
+  return g_failures ? 1 : 0;
+}
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <G4UserRunAction.hh>
+#include "OMSimBoundaryStatistics.hh"
 #include "OMSimHitManager.hh"
 #include "OMSimLogger.hh"
 #include "Randomize.hh"
@@ -24,5 +25,7 @@ public:
     {
         log_debug("EndOfRunAction called, nr of events {}", run->GetNumberOfEvent());
         OMSimHitManager::getInstance().mergeThreadData();
+        if (OMSimBoundaryStatistics::isEnabled())
+            OMSimBoundaryStatistics::getInstance().endOfRun();
     }
 };
@@ -4,6 +4,7 @@
  */
 
 #include "OMSim.hh"
+#include "OMSimBoundaryStatistics.hh"
 #include "OMSimTools.hh"
 #include "OMSimLogger.hh"
 #include "OMSimActionInitialization.hh"
@@ -38,6 +39,8 @@ void OMSim::setGeneralOptions()
     ("simple_PMT", po::bool_switch(), "if given, simulate simple PMT")
     ("QE_file", po::value<std::string>()->default_value("default"), "file path for custom QE file (file should contain two columns separated by tab, QE should not be in %!)")
     ("efficiency_cut", po::bool_switch(), "if given, the photons will be deleted if they don't pass QE")
+    ("unpolarized_boundary", po::bool_switch(), "if given, optical boundaries use polarisation averaged Fresnel probabilities and skip the polarisation bookkeeping (faster, for unpolarised sources)")
+    ("boundary_stats", po::bool_switch(), "if given, optical boundary interactions are counted per model, material pair and outcome, with sampled cost, and written to <output_file>_boundary_stats.json")
     ("pmt_response", po::bool_switch(), "if given, simulates PMT response using scan data (currently only for mDOM PMT)")
     ("place_harness",po::bool_switch(),"place OM harness (if implemented)")
     ("detector_type", po::value<G4int>()->default_value(2), "module type [custom = 0, Single PMT = 1, mDOM = 2, DOM = 3, LOM16 = 4, LOM18 = 5, DEGG = 6, pDOM (HQE deepcore) = 7]")
@@ -114,6 +117,7 @@ int OMSim::determineNumberOfThreads()
 void OMSim::initialiseSimulation(OMSimDetectorConstruction* p_detectorConstruction)
 {
     OMSimHitManager::init();
+    OMSimBoundaryStatistics::init();
 
     OMSimCommandArgsTable &args = OMSimCommandArgsTable::getInstance();
     Tools::ensureDirectoryExists(args.get<std::string>("output_file"));
@@ -223,6 +227,9 @@ OMSim::~OMSim()
     log_trace("Deleting OMSimHitManager");
     OMSimHitManager::shutdown();
 
+    log_trace("Deleting OMSimBoundaryStatistics");
+    OMSimBoundaryStatistics::shutdown();
+
     log_trace("Deleting OMSimCommandArgsTable");
     OMSimCommandArgsTable::shutdown();
 
@@ -3,6 +3,7 @@
  * @brief Implementation of enhanced tracking action for WavePID.
  */
 #include "OMSimTrackingAction.hh"
+#include "OMSimOpBoundaryProcess.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4VProcess.hh"
 #include "G4OpticalPhoton.hh"
@@ -62,10 +63,13 @@ void OMSimTrackingAction::PreUserTrackingAction(const G4Track* track)
     }
 }
 
-void OMSimTrackingAction::PostUserTrackingAction(const G4Track* /*track*/)
+void OMSimTrackingAction::PostUserTrackingAction(const G4Track* track)
 {
     // Optional: Could clean up maps here for completed tracks
     // Currently keeping data for potential later analysis
+
+    // Give the boundary-process material history back to the per-thread pool
+    PhotonMaterialTrackingPool::release(track);
 }
 
 std::string OMSimTrackingAction::GetParticleType(G4int trackID) const